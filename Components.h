@@ -0,0 +1,472 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "Parallel.h"
+#include "Traversal.h"
+
+namespace graph {
+    /** @defgroup Components Connected components */
+
+    /**
+     * @ingroup Components
+     * @brief Result of a component search, as a dense array indexed by vertex id
+     *
+     * @details Components are numbered in [0, count) in the order of their smallest vertex id, so every algorithm
+     * returns the same numbering for the same graph, serial or parallel.
+     */
+    struct ComponentResult {
+        std::vector<vertex_id> component; /**< @brief The component of every node. */
+        size_t count = 0; /**< @brief The number of components. */
+
+        /** @brief Returns the number of nodes in every component. */
+        std::vector<size_t> sizes() const {
+            std::vector<size_t> result(count, 0);
+            for (auto id: component) ++result[id];
+            return result;
+        }
+    };
+
+    /**
+     * @ingroup Components
+     * @brief Tuning knobs of the parallel component searches
+     */
+    struct ComponentOptions {
+        size_t threads = 0; /**< @brief The number of workers; 0 means default_threads(). */
+        size_t neighbor_rounds = 2; /**< @brief Afforest: the number of edges per node linked before the largest component is sampled. */
+        size_t samples = 1024; /**< @brief Afforest: the number of nodes sampled to find the largest component. */
+        size_t trim_rounds = 3; /**< @brief SCC: the rounds that remove nodes without in-edges or out-edges before the main search. */
+    };
+
+    namespace detail {
+        /** @brief Renumbers representative ids in [0, size) to components in the order of their smallest vertex id. */
+        inline ComponentResult number_components(std::vector<vertex_id> representative) {
+            ComponentResult result{std::move(representative), 0};
+            std::vector<vertex_id> label(result.component.size(), no_vertex);
+            for (auto &id: result.component) {
+                if (label[id] == no_vertex) label[id] = static_cast<vertex_id>(result.count++);
+                id = label[id];
+            }
+            return result;
+        }
+
+        /** @brief Returns the root of the node in a union-find forest, halving the path on the way. */
+        inline vertex_id find_root(std::vector<vertex_id>& parent, vertex_id node) noexcept {
+            while (parent[node] != node) {
+                parent[node] = parent[parent[node]];
+                node = parent[node];
+            }
+            return node;
+        }
+
+        /** @brief Weakly connected components over nodes [0, size) with a union-find forest. */
+        template<typename neighbors_type>
+        ComponentResult serial_wcc(size_t size, neighbors_type&& for_each_neighbor) {
+            std::vector<vertex_id> parent(size);
+            for (size_t node = 0; node < size; ++node) parent[node] = static_cast<vertex_id>(node);
+            for (size_t node = 0; node < size; ++node) {
+                for_each_neighbor(static_cast<vertex_id>(node), [&](vertex_id neighbor) {
+                    vertex_id first = find_root(parent, static_cast<vertex_id>(node));
+                    vertex_id second = find_root(parent, neighbor);
+                    if (first < second) parent[second] = first;
+                    else if (second < first) parent[first] = second;
+                });
+            }
+            for (size_t node = 0; node < size; ++node) parent[node] = find_root(parent, static_cast<vertex_id>(node));
+            return number_components(std::move(parent));
+        }
+
+        /**
+         * @brief Strongly connected components over nodes [0, size) with Tarjan's algorithm
+         *
+         * @details Iterative, so deep graphs cannot overflow the call stack. The neighbors of every node on the DFS
+         * path are buffered in one shared vector, and each frame keeps its range of that vector.
+         */
+        template<typename neighbors_type>
+        ComponentResult serial_scc(size_t size, neighbors_type&& for_each_neighbor) {
+            struct frame {
+                vertex_id node;
+                size_t begin;
+                size_t next;
+                size_t end;
+            };
+            std::vector<vertex_id> index(size, no_vertex);
+            std::vector<vertex_id> low(size, 0);
+            std::vector<std::uint8_t> on_stack(size, 0);
+            std::vector<vertex_id> component(size, no_vertex);
+            std::vector<vertex_id> stack;
+            std::vector<vertex_id> pending;
+            std::vector<frame> frames;
+            vertex_id counter = 0;
+
+            auto enter = [&](vertex_id node) {
+                index[node] = low[node] = counter++;
+                stack.push_back(node);
+                on_stack[node] = 1;
+                size_t begin = pending.size();
+                for_each_neighbor(node, [&](vertex_id neighbor) { pending.push_back(neighbor); });
+                frames.push_back({node, begin, begin, pending.size()});
+            };
+
+            for (size_t root = 0; root < size; ++root) {
+                if (index[root] != no_vertex) continue;
+                enter(static_cast<vertex_id>(root));
+                while (!frames.empty()) {
+                    auto &top = frames.back();
+                    if (top.next < top.end) {
+                        vertex_id neighbor = pending[top.next++];
+                        if (index[neighbor] == no_vertex) enter(neighbor);
+                        else if (on_stack[neighbor]) low[top.node] = std::min(low[top.node], index[neighbor]);
+                        continue;
+                    }
+                    vertex_id node = top.node;
+                    pending.resize(top.begin);
+                    frames.pop_back();
+                    if (low[node] == index[node]) {
+                        vertex_id member;
+                        do {
+                            member = stack.back();
+                            stack.pop_back();
+                            on_stack[member] = 0;
+                            component[member] = node;
+                        } while (member != node);
+                    }
+                    if (!frames.empty()) low[frames.back().node] = std::min(low[frames.back().node], low[node]);
+                }
+            }
+            return number_components(std::move(component));
+        }
+
+        /**
+         * @brief Joins the trees of two nodes in a concurrent union-find forest
+         *
+         * @details Always hangs the larger root under the smaller one with a compare-and-swap, and retries from the
+         * new roots if another worker got there first (the Link step of Afforest).
+         */
+        inline void link(std::vector<std::atomic<vertex_id>>& parent, vertex_id first, vertex_id second) noexcept {
+            vertex_id first_parent = parent[first].load(std::memory_order_relaxed);
+            vertex_id second_parent = parent[second].load(std::memory_order_relaxed);
+            while (first_parent != second_parent) {
+                vertex_id high = std::max(first_parent, second_parent);
+                vertex_id low = std::min(first_parent, second_parent);
+                vertex_id high_parent = parent[high].load(std::memory_order_relaxed);
+                if (high_parent == low) break;
+                if (high_parent == high && parent[high].compare_exchange_strong(high_parent, low, std::memory_order_relaxed)) break;
+                first_parent = parent[parent[high].load(std::memory_order_relaxed)].load(std::memory_order_relaxed);
+                second_parent = parent[low].load(std::memory_order_relaxed);
+            }
+        }
+
+        /** @brief Points every node of a concurrent union-find forest directly at its root. */
+        inline void compress(std::vector<std::atomic<vertex_id>>& parent, size_t threads) {
+            parallel_for(0, parent.size(), [&](size_t first, size_t last, size_t) {
+                for (size_t node = first; node < last; ++node) {
+                    vertex_id root = parent[node].load(std::memory_order_relaxed);
+                    while (parent[root].load(std::memory_order_relaxed) != root) root = parent[root].load(std::memory_order_relaxed);
+                    parent[node].store(root, std::memory_order_relaxed);
+                }
+            }, threads);
+        }
+
+        /**
+         * @brief Marks every live node reachable from source, level by level in parallel
+         * @return The reached nodes, source included
+         */
+        template<typename offsets_type, typename neighbors_type>
+        std::vector<vertex_id> parallel_reach(const offsets_type& offsets, const neighbors_type& neighbors, vertex_id source,
+                                              const std::vector<std::uint8_t>& alive, std::vector<std::atomic<std::uint8_t>>& mark, size_t threads) {
+            std::vector<vertex_id> reached{source};
+            std::vector<std::vector<vertex_id>> buffers(threads);
+            mark[source].store(1, std::memory_order_relaxed);
+            for (size_t begin = 0; begin < reached.size();) {
+                size_t end = reached.size();
+                parallel_for(begin, end, [&](size_t first, size_t last, size_t worker) {
+                    for (size_t index = first; index < last; ++index) {
+                        vertex_id node = reached[index];
+                        for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) {
+                            vertex_id neighbor = neighbors[edge];
+                            if (!alive[neighbor] || mark[neighbor].load(std::memory_order_relaxed)) continue;
+                            if (mark[neighbor].exchange(1, std::memory_order_relaxed) == 0) buffers[worker].push_back(neighbor);
+                        }
+                    }
+                }, threads);
+                begin = end;
+                for (auto &found: buffers) {
+                    reached.insert(reached.end(), found.begin(), found.end());
+                    found.clear();
+                }
+            }
+            return reached;
+        }
+    }
+
+    /**
+     * @ingroup Components
+     * @brief Weakly connected components, with a union-find forest
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    ComponentResult weakly_connected_components(const CsrGraph<key_type, value_type, weight_type>& graph) {
+        return detail::serial_wcc(graph.size(), detail::csr_neighbors(graph));
+    }
+
+    /**
+     * @ingroup Components
+     * @brief Weakly connected components of a Graph; the result is indexed by interned id
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    ComponentResult weakly_connected_components(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph) {
+        return detail::serial_wcc(graph.size(), detail::graph_neighbors(graph));
+    }
+
+    /**
+     * @ingroup Components
+     * @brief Strongly connected components, with an iterative Tarjan's algorithm
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    ComponentResult strongly_connected_components(const CsrGraph<key_type, value_type, weight_type>& graph) {
+        return detail::serial_scc(graph.size(), detail::csr_neighbors(graph));
+    }
+
+    /**
+     * @ingroup Components
+     * @brief Strongly connected components of a Graph; the result is indexed by interned id
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    ComponentResult strongly_connected_components(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph) {
+        return detail::serial_scc(graph.size(), detail::graph_neighbors(graph));
+    }
+
+    /**
+     * @ingroup Components
+     * @brief Parallel weakly connected components with Afforest
+     *
+     * @details
+     * Links every node to its first neighbor_rounds neighbors in a concurrent union-find forest, which is usually
+     * enough to join most of the giant component. It then samples nodes to find the largest component so far and
+     * links the remaining edges of every other node.
+     *
+     * Nodes of the largest component can only be skipped if every edge is also visible from its other endpoint.
+     * The transposed graph provides that: the nodes outside the largest component also link their in-edges. For a
+     * symmetric graph, pass the graph itself as transposed.
+     *
+     * @param[in] graph The graph to search
+     * @param[in] transposed graph.transpose(), or graph itself if it is symmetric
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    ComponentResult parallel_weakly_connected_components(const CsrGraph<key_type, value_type, weight_type>& graph,
+                                                         const CsrGraph<key_type, value_type, weight_type>& transposed,
+                                                         const ComponentOptions& options = {}) {
+        size_t size = graph.size();
+        size_t threads = options.threads == 0 ? default_threads() : options.threads;
+        auto const &offsets = graph.offsets();
+        auto const &neighbors = graph.neighbors();
+        auto const &in_offsets = transposed.offsets();
+        auto const &in_neighbors = transposed.neighbors();
+
+        std::vector<std::atomic<vertex_id>> parent(size);
+        parallel_for(0, size, [&](size_t first, size_t last, size_t) {
+            for (size_t node = first; node < last; ++node) parent[node].store(static_cast<vertex_id>(node), std::memory_order_relaxed);
+        }, threads);
+
+        for (size_t round = 0; round < options.neighbor_rounds; ++round) {
+            parallel_for(0, size, [&](size_t first, size_t last, size_t) {
+                for (size_t node = first; node < last; ++node) {
+                    if (offsets[node] + round < offsets[node + 1]) detail::link(parent, static_cast<vertex_id>(node), neighbors[offsets[node] + round]);
+                }
+            }, threads);
+            detail::compress(parent, threads);
+        }
+
+        vertex_id largest = no_vertex;
+        if (size > 0 && options.samples > 0) {
+            std::mt19937_64 random(size);
+            std::vector<vertex_id> sample(options.samples);
+            for (auto &id: sample) id = parent[random() % size].load(std::memory_order_relaxed);
+            std::sort(sample.begin(), sample.end());
+            size_t best = 0;
+            for (size_t begin = 0, end = 0; begin < sample.size(); begin = end) {
+                while (end < sample.size() && sample[end] == sample[begin]) ++end;
+                if (end - begin > best) {
+                    best = end - begin;
+                    largest = sample[begin];
+                }
+            }
+        }
+
+        parallel_for(0, size, [&](size_t first, size_t last, size_t) {
+            for (size_t node = first; node < last; ++node) {
+                if (parent[node].load(std::memory_order_relaxed) == largest) continue;
+                auto id = static_cast<vertex_id>(node);
+                for (size_t edge = offsets[node] + options.neighbor_rounds; edge < offsets[node + 1]; ++edge) detail::link(parent, id, neighbors[edge]);
+                for (size_t edge = in_offsets[node]; edge < in_offsets[node + 1]; ++edge) detail::link(parent, id, in_neighbors[edge]);
+            }
+        }, threads);
+        detail::compress(parent, threads);
+
+        std::vector<vertex_id> root(size);
+        for (size_t node = 0; node < size; ++node) root[node] = parent[node].load(std::memory_order_relaxed);
+        return detail::number_components(std::move(root));
+    }
+
+    /** @ingroup Components @brief Parallel weakly connected components with Afforest; computes the transposed graph itself. */
+    template<typename key_type, typename value_type, typename weight_type>
+    ComponentResult parallel_weakly_connected_components(const CsrGraph<key_type, value_type, weight_type>& graph, const ComponentOptions& options = {}) {
+        return parallel_weakly_connected_components(graph, graph.transpose(), options);
+    }
+
+    /**
+     * @ingroup Components
+     * @brief Parallel strongly connected components with trimming, forward-backward search and coloring
+     *
+     * @details
+     * Runs in three phases over the nodes that are not yet assigned:
+     * - Trimming: a node with no in-edges or no out-edges from other live nodes is a component on its own.
+     * - Forward-backward: the nodes that are both reachable from and can reach a pivot of high degree form its
+     *   component, which in most real graphs is the giant one. Both searches are parallel BFS.
+     * - Coloring: every live node takes the largest id that can reach it, propagated along the edges until
+     *   nothing changes. A node that keeps its own id is the root of a component: the nodes of its color that
+     *   can reach it. The roots are searched backwards in parallel, and the rest is colored again.
+     *
+     * @param[in] graph The graph to search
+     * @param[in] transposed graph.transpose(), used by the backward searches
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    ComponentResult parallel_strongly_connected_components(const CsrGraph<key_type, value_type, weight_type>& graph,
+                                                           const CsrGraph<key_type, value_type, weight_type>& transposed,
+                                                           const ComponentOptions& options = {}) {
+        size_t size = graph.size();
+        size_t threads = options.threads == 0 ? default_threads() : options.threads;
+        auto const &offsets = graph.offsets();
+        auto const &neighbors = graph.neighbors();
+        auto const &in_offsets = transposed.offsets();
+        auto const &in_neighbors = transposed.neighbors();
+
+        std::vector<vertex_id> component(size, no_vertex);
+        std::vector<std::uint8_t> alive(size, 1);
+        std::vector<vertex_id> remaining(size);
+        for (size_t node = 0; node < size; ++node) remaining[node] = static_cast<vertex_id>(node);
+        std::vector<std::vector<vertex_id>> buffers(threads);
+
+        auto retire = [&]() {
+            for (auto &found: buffers) {
+                for (auto node: found) alive[node] = 0;
+                found.clear();
+            }
+            remaining.erase(std::remove_if(remaining.begin(), remaining.end(), [&](vertex_id node) { return !alive[node]; }), remaining.end());
+        };
+        auto has_live_edge = [&](auto const &row_offsets, auto const &row_neighbors, vertex_id node) {
+            for (size_t edge = row_offsets[node]; edge < row_offsets[node + 1]; ++edge) {
+                if (row_neighbors[edge] != node && alive[row_neighbors[edge]]) return true;
+            }
+            return false;
+        };
+
+        for (size_t round = 0; round < options.trim_rounds && !remaining.empty(); ++round) {
+            size_t before = remaining.size();
+            parallel_for(0, remaining.size(), [&](size_t first, size_t last, size_t worker) {
+                for (size_t index = first; index < last; ++index) {
+                    vertex_id node = remaining[index];
+                    if (has_live_edge(offsets, neighbors, node) && has_live_edge(in_offsets, in_neighbors, node)) continue;
+                    component[node] = node;
+                    buffers[worker].push_back(node);
+                }
+            }, threads);
+            retire();
+            if (remaining.size() == before) break;
+        }
+
+        if (!remaining.empty()) {
+            vertex_id pivot = remaining.front();
+            size_t best = 0;
+            for (auto node: remaining) {
+                size_t degree = (offsets[node + 1] - offsets[node]) * (in_offsets[node + 1] - in_offsets[node]);
+                if (degree > best) {
+                    best = degree;
+                    pivot = node;
+                }
+            }
+            std::vector<std::atomic<std::uint8_t>> forward(size);
+            std::vector<std::atomic<std::uint8_t>> backward(size);
+            for (size_t node = 0; node < size; ++node) {
+                forward[node].store(0, std::memory_order_relaxed);
+                backward[node].store(0, std::memory_order_relaxed);
+            }
+            detail::parallel_reach(offsets, neighbors, pivot, alive, forward, threads);
+            for (auto node: detail::parallel_reach(in_offsets, in_neighbors, pivot, alive, backward, threads)) {
+                if (!forward[node].load(std::memory_order_relaxed)) continue;
+                component[node] = pivot;
+                buffers[0].push_back(node);
+            }
+            retire();
+        }
+
+        std::vector<std::atomic<vertex_id>> color(size);
+        std::vector<vertex_id> roots;
+        while (!remaining.empty()) {
+            for (auto node: remaining) color[node].store(node, std::memory_order_relaxed);
+            std::atomic<bool> changed{true};
+            while (changed.load(std::memory_order_relaxed)) {
+                changed.store(false, std::memory_order_relaxed);
+                parallel_for(0, remaining.size(), [&](size_t first, size_t last, size_t) {
+                    bool updated = false;
+                    for (size_t index = first; index < last; ++index) {
+                        vertex_id node = remaining[index];
+                        vertex_id own = color[node].load(std::memory_order_relaxed);
+                        for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) {
+                            vertex_id neighbor = neighbors[edge];
+                            if (!alive[neighbor]) continue;
+                            vertex_id current = color[neighbor].load(std::memory_order_relaxed);
+                            while (current < own) {
+                                if (color[neighbor].compare_exchange_weak(current, own, std::memory_order_relaxed)) {
+                                    updated = true;
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                    if (updated) changed.store(true, std::memory_order_relaxed);
+                }, threads);
+            }
+
+            roots.clear();
+            for (auto node: remaining) {
+                if (color[node].load(std::memory_order_relaxed) == node) roots.push_back(node);
+            }
+            parallel_for(0, roots.size(), [&](size_t first, size_t last, size_t worker) {
+                auto &found = buffers[worker];
+                for (size_t index = first; index < last; ++index) {
+                    vertex_id root = roots[index];
+                    size_t head = found.size();
+                    component[root] = root;
+                    found.push_back(root);
+                    for (; head < found.size(); ++head) {
+                        vertex_id node = found[head];
+                        for (size_t edge = in_offsets[node]; edge < in_offsets[node + 1]; ++edge) {
+                            vertex_id neighbor = in_neighbors[edge];
+                            // The color check comes first: a search only touches the component entries of its own color.
+                            if (!alive[neighbor] || color[neighbor].load(std::memory_order_relaxed) != root) continue;
+                            if (component[neighbor] != no_vertex) continue;
+                            component[neighbor] = root;
+                            found.push_back(neighbor);
+                        }
+                    }
+                }
+            }, threads);
+            retire();
+        }
+        return detail::number_components(std::move(component));
+    }
+
+    /** @ingroup Components @brief Parallel strongly connected components; computes the transposed graph itself. */
+    template<typename key_type, typename value_type, typename weight_type>
+    ComponentResult parallel_strongly_connected_components(const CsrGraph<key_type, value_type, weight_type>& graph, const ComponentOptions& options = {}) {
+        return parallel_strongly_connected_components(graph, graph.transpose(), options);
+    }
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "Graph.h"
+
+namespace graph {
+    namespace detail {
+        /** @brief Appends value to out as a little-endian base-128 varint: 7 bits per byte, high bit set on all but the last. */
+        inline void write_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<std::uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<std::uint8_t>(value));
+        }
+
+        /** @brief Reads a varint written by write_varint and advances position past it. */
+        inline std::uint64_t read_varint(const std::uint8_t*& position) noexcept {
+            std::uint64_t value = *position & 0x7f;
+            for (unsigned shift = 7; *position++ & 0x80; shift += 7) value |= static_cast<std::uint64_t>(*position & 0x7f) << shift;
+            return value;
+        }
+
+        /** @brief Maps signed differences to unsigned ones, small magnitudes first: 0, -1, 1, -2, ... */
+        inline std::uint64_t zigzag(std::int64_t value) noexcept {
+            return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+        }
+
+        inline std::int64_t unzigzag(std::uint64_t value) noexcept {
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+
+        /**
+         * @brief Encodes one sorted row of distinct neighbor ids
+         * @details The degree, then the first neighbor as a zigzag difference from the source, then every further
+         * neighbor as its gap from the previous one minus one, all as varints.
+         */
+        inline void encode_row(std::vector<std::uint8_t>& out, vertex_id source, const vertex_id* neighbors, size_t count) {
+            write_varint(out, count);
+            if (count == 0) return;
+            write_varint(out, zigzag(static_cast<std::int64_t>(neighbors[0]) - static_cast<std::int64_t>(source)));
+            for (size_t i = 1; i < count; ++i) write_varint(out, neighbors[i] - neighbors[i - 1] - 1);
+        }
+
+        /** @brief Returns a shared default weight, which the rows of unweighted graphs hand out instead of storing any. */
+        template<typename weight_type>
+        const weight_type* shared_weight() noexcept {
+            static const weight_type weight{};
+            return &weight;
+        }
+
+        /**
+         * @brief Iterates one encoded row, decoding a neighbor per step and yielding pairs of its key and a weight.
+         * @details Iterators of the same row compare by the number of edges left, so end() is any iterator with none.
+         */
+        template<typename KeyReference, typename Weight, typename Owner>
+        class compressed_edge_iterator {
+            static constexpr bool weighted = !std::is_same_v<Weight, graph::empty>;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<KeyReference, const Weight&>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+            using pointer = arrow_proxy<value_type>;
+
+            compressed_edge_iterator() = default;
+            compressed_edge_iterator(const Owner* graph, const std::uint8_t* position, vertex_id source, size_t remaining, const Weight* weight) noexcept
+                : m_graph(graph), m_position(position), m_remaining(remaining), m_weight(weight) {
+                if (m_remaining != 0) m_neighbor = static_cast<vertex_id>(static_cast<std::int64_t>(source) + unzigzag(read_varint(m_position)));
+            }
+
+            reference operator*() const noexcept { return {m_graph->key_of(m_neighbor), *m_weight}; }
+            pointer operator->() const noexcept { return {**this}; }
+            vertex_id id() const noexcept { return m_neighbor; } /**< @brief Returns the id of the neighbor. */
+
+            compressed_edge_iterator& operator++() noexcept {
+                if (--m_remaining != 0) m_neighbor += static_cast<vertex_id>(read_varint(m_position) + 1);
+                if constexpr (weighted) ++m_weight;
+                return *this;
+            }
+            compressed_edge_iterator operator++(int) noexcept { auto copy = *this; ++*this; return copy; }
+            bool operator==(const compressed_edge_iterator& other) const noexcept { return m_remaining == other.m_remaining; }
+            bool operator!=(const compressed_edge_iterator& other) const noexcept { return m_remaining != other.m_remaining; }
+        private:
+            const Owner* m_graph = nullptr;
+            const std::uint8_t* m_position = nullptr;
+            vertex_id m_neighbor = 0;
+            size_t m_remaining = 0;
+            const Weight* m_weight = nullptr;
+        };
+    }
+
+    /**
+     * @ingroup Frozen
+     * @brief Read-only snapshot of a Graph with gap-encoded neighbor lists
+     *
+     * @details
+     * Stores the same graph as CsrGraph, but every row is a sorted run of varint gaps (see detail::encode_row), in
+     * the style of Ligra+ byte codes, so a neighbor takes one byte when its id is within 128 of the previous one
+     * instead of four. Ordering the nodes for locality first (see reorder) shrinks the gaps further. Rows are found
+     * through an absolute byte offset per 64 nodes and a 32-bit one per node within them. Weights stay
+     * uncompressed, and are not stored at all if weight_type is graph::empty.
+     *
+     * Iteration mirrors CsrGraph, with the neighbors decoded on the fly by the edge iterators. for_each_neighbor
+     * decodes a row in a tight loop, for kernels that only need the ids.
+     *
+     * @tparam key_type - type of the key of the node
+     * @tparam value_type - type of the value of the node
+     * @tparam weight_type - type of the weight of the edge
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    class CompressedCsrGraph {
+        static constexpr bool weighted = !std::is_same_v<weight_type, graph::empty>;
+    public:
+        class Node;
+
+        using const_iterator = detail::csr_node_iterator<const key_type&, Node, CompressedCsrGraph>;
+        using iterator = const_iterator;
+
+        CompressedCsrGraph() = default;
+        /** @brief Builds a compressed snapshot of the given graph, one row at a time, without a CsrGraph in between. */
+        template<typename graph_type>
+        explicit CompressedCsrGraph(const graph_type& graph);
+        /** @brief Compresses a CsrGraph; nodes keep their ids. */
+        explicit CompressedCsrGraph(const CsrGraph<key_type, value_type, weight_type>& graph);
+
+        bool empty() const noexcept { return m_keys.empty(); } /**< @brief Checks if the snapshot has no nodes. */
+        size_t size() const noexcept { return m_keys.size(); } /**< @brief Counts the number of nodes. */
+        size_t edge_count() const noexcept { return m_edges; } /**< @brief Counts the number of edges. */
+        size_t adjacency_bytes() const noexcept { return m_blocks.size() * sizeof(size_t) + m_rows.size() * sizeof(std::uint32_t) + m_data.size(); } /**< @brief Counts the bytes of the encoded rows and their offsets. */
+
+        const_iterator cbegin() const noexcept { return const_iterator(this, 0); }
+        const_iterator cend() const noexcept { return const_iterator(this, static_cast<vertex_id>(size())); }
+        const_iterator begin() const noexcept { return cbegin(); }
+        const_iterator end() const noexcept { return cend(); }
+
+        Node operator[](vertex_id id) const noexcept { return Node(this, id); } /**< @brief Returns the node with the given id. */
+        Node at(const key_type& key) const;
+        const_iterator find(const key_type& key) const;
+
+        vertex_id id_of(const key_type& key) const;
+        const key_type& key_of(vertex_id id) const noexcept { return m_keys[id]; } /**< @brief Returns the key of the node with the given id. */
+
+        size_t degree_out(const key_type& key) const { return at(key).size(); } /**< @brief Counts the number of edges that start in the node with the given key. */
+        /** @brief Counts the edges that start in the node with the given id; decodes the first varint of its row. */
+        size_t degree_out_by_id(vertex_id id) const noexcept {
+            const std::uint8_t* position = row(id);
+            return static_cast<size_t>(detail::read_varint(position));
+        }
+
+        /** @brief Calls visit(neighbor id) for every edge of the node, in ascending order. */
+        template<typename function_type>
+        void for_each_neighbor(vertex_id id, function_type&& visit) const;
+        /** @brief Decodes the whole snapshot back into a CsrGraph with the same ids. */
+        CsrGraph<key_type, value_type, weight_type> decompress() const;
+    private:
+        template<typename row_source>
+        void build(size_t size, row_source&& source);
+
+        /** @brief Returns the start of the encoded row of the node. */
+        const std::uint8_t* row(vertex_id id) const noexcept { return m_data.data() + m_blocks[id / block_size] + m_rows[id]; }
+
+        static constexpr size_t block_size = 64; /**< @brief The number of rows that share an absolute offset. */
+
+        std::vector<std::uint8_t> m_data; /**< @brief The encoded rows, back to back. */
+        std::vector<size_t> m_blocks; /**< @brief Start in m_data of every block of block_size rows. */
+        std::vector<std::uint32_t> m_rows; /**< @brief Start of every node's row, relative to the start of its block. */
+        std::vector<size_t> m_offsets; /**< @brief Start of every node's weights in m_weights, plus the end; empty if unweighted. */
+        std::vector<weight_type> m_weights; /**< @brief Weights of all edges, row by row; empty if unweighted. */
+        size_t m_edges = 0;
+        std::vector<key_type> m_keys; /**< @brief Key of every node, indexed by id. */
+        std::vector<value_type> m_values; /**< @brief Value of every node, indexed by id. */
+        std::unordered_map<key_type, vertex_id> m_ids; /**< @brief Maps keys back to ids. */
+    };
+
+    /**
+     * @ingroup Frozen
+     * @brief View of a single node of a CompressedCsrGraph
+     *
+     * @details Cheap to copy; it refers into the snapshot and stays valid as long as the snapshot does.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    class CompressedCsrGraph<key_type, value_type, weight_type>::Node {
+    public:
+        using const_iterator = detail::compressed_edge_iterator<const key_type&, weight_type, CompressedCsrGraph>;
+        using iterator = const_iterator;
+
+        Node() = default;
+        Node(const CompressedCsrGraph* graph, vertex_id id) noexcept : m_graph(graph), m_id(id) {}
+
+        bool empty() const noexcept { return size() == 0; } /**< @brief Returns true if the node has no edges, false otherwise. */
+        size_t size() const noexcept { return m_graph->degree_out_by_id(m_id); } /**< @brief Returns the number of edges in the node. */
+        vertex_id id() const noexcept { return m_id; } /**< @brief Returns the id of the node. */
+        const key_type& key() const noexcept { return m_graph->m_keys[m_id]; } /**< @brief Returns the key of the node. */
+        const value_type& value() const noexcept { return m_graph->m_values[m_id]; } /**< @brief Returns the value of the node. */
+        const value_type& getvalue() const noexcept { return value(); }
+
+        const_iterator cbegin() const noexcept {
+            const std::uint8_t* position = m_graph->row(m_id);
+            auto count = static_cast<size_t>(detail::read_varint(position));
+            return const_iterator(m_graph, position, m_id, count, weight_at(0));
+        }
+        const_iterator cend() const noexcept { return const_iterator(m_graph, nullptr, m_id, 0, nullptr); }
+        const_iterator begin() const noexcept { return cbegin(); }
+        const_iterator end() const noexcept { return cend(); }
+
+        /** @brief Returns the ids of the neighbors, sorted ascending, decoded into a vector. */
+        std::vector<vertex_id> neighbors() const {
+            std::vector<vertex_id> result;
+            result.reserve(size());
+            m_graph->for_each_neighbor(m_id, [&](vertex_id neighbor) { result.push_back(neighbor); });
+            return result;
+        }
+    private:
+        const weight_type* weight_at(size_t edge) const noexcept {
+            if constexpr (weighted) return m_graph->m_weights.data() + m_graph->m_offsets[m_id] + edge;
+            else return detail::shared_weight<weight_type>();
+        }
+
+        const CompressedCsrGraph* m_graph = nullptr;
+        vertex_id m_id = 0;
+    };
+
+    /**
+     * @details source(id, ids, weights) fills the sorted ids of the row of every node and their weights.
+     * @throws If the rows of 64 nodes take more than 4 GiB, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    template<typename row_source>
+    void CompressedCsrGraph<key_type, value_type, weight_type>::build(size_t size, row_source&& source) {
+        m_blocks.reserve((size + block_size - 1) / block_size);
+        m_rows.reserve(size);
+        if constexpr (weighted) {
+            m_offsets.assign(1, 0);
+            m_offsets.reserve(size + 1);
+        }
+        std::vector<vertex_id> ids;
+        std::vector<weight_type> weights;
+        for (size_t id = 0; id < size; ++id) {
+            ids.clear();
+            weights.clear();
+            source(id, ids, weights);
+            if (id % block_size == 0) m_blocks.push_back(m_data.size());
+            if (m_data.size() - m_blocks.back() > UINT32_MAX) throw GraphException("Too many edges");
+            m_rows.push_back(static_cast<std::uint32_t>(m_data.size() - m_blocks.back()));
+            detail::encode_row(m_data, static_cast<vertex_id>(id), ids.data(), ids.size());
+            m_edges += ids.size();
+            if constexpr (weighted) {
+                m_weights.insert(m_weights.end(), weights.begin(), weights.end());
+                m_offsets.push_back(m_weights.size());
+            }
+        }
+        m_data.shrink_to_fit();
+        m_weights.shrink_to_fit();
+    }
+
+    /** @details Nodes keep the ids the graph interned them with; each row is sorted and encoded as it is read. */
+    template<typename key_type, typename value_type, typename weight_type>
+    template<typename graph_type>
+    CompressedCsrGraph<key_type, value_type, weight_type>::CompressedCsrGraph(const graph_type& graph) : m_keys(graph.keys().begin(), graph.keys().end()) {
+        std::vector<const typename graph_type::Node*> nodes(m_keys.size());
+        m_ids.reserve(m_keys.size());
+        for (auto const &elem: graph) {
+            nodes[elem.second.id()] = &elem.second;
+            m_ids.emplace(elem.first, elem.second.id());
+        }
+        m_values.reserve(m_keys.size());
+        std::vector<std::pair<vertex_id, weight_type>> edges;
+        build(m_keys.size(), [&](size_t id, std::vector<vertex_id>& ids, std::vector<weight_type>& weights) {
+            m_values.push_back(nodes[id]->getvalue());
+            edges.clear();
+            for (auto const &edge: nodes[id]->getedges()) edges.emplace_back(graph.id_of(edge.first), edge.second);
+            std::sort(edges.begin(), edges.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (auto const &edge: edges) {
+                ids.push_back(edge.first);
+                if constexpr (weighted) weights.push_back(edge.second);
+            }
+        });
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    CompressedCsrGraph<key_type, value_type, weight_type>::CompressedCsrGraph(const CsrGraph<key_type, value_type, weight_type>& graph) {
+        m_keys.reserve(graph.size());
+        m_values.reserve(graph.size());
+        m_ids.reserve(graph.size());
+        for (auto const &elem: graph) {
+            m_keys.push_back(elem.first);
+            m_values.push_back(elem.second.value());
+            m_ids.emplace(elem.first, elem.second.id());
+        }
+        build(graph.size(), [&](size_t id, std::vector<vertex_id>& ids, std::vector<weight_type>& weights) {
+            auto node = graph[static_cast<vertex_id>(id)];
+            ids.assign(node.neighbors().begin(), node.neighbors().end());
+            if constexpr (weighted) weights.assign(node.weights().begin(), node.weights().end());
+        });
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    template<typename function_type>
+    void CompressedCsrGraph<key_type, value_type, weight_type>::for_each_neighbor(vertex_id id, function_type&& visit) const {
+        const std::uint8_t* position = row(id);
+        auto count = static_cast<size_t>(detail::read_varint(position));
+        if (count == 0) return;
+        auto neighbor = static_cast<vertex_id>(static_cast<std::int64_t>(id) + detail::unzigzag(detail::read_varint(position)));
+        visit(neighbor);
+        for (size_t edge = 1; edge < count; ++edge) {
+            neighbor += static_cast<vertex_id>(detail::read_varint(position) + 1);
+            visit(neighbor);
+        }
+    }
+
+    /** @details Decodes the rows into a Graph with the same ids and freezes it. */
+    template<typename key_type, typename value_type, typename weight_type>
+    CsrGraph<key_type, value_type, weight_type> CompressedCsrGraph<key_type, value_type, weight_type>::decompress() const {
+        Graph<key_type, value_type, weight_type> graph;
+        for (size_t id = 0; id < size(); ++id) graph.insert_node(m_keys[id], m_values[id]);
+        for (size_t id = 0; id < size(); ++id) {
+            for (auto const &edge: (*this)[static_cast<vertex_id>(id)]) graph.insert_edge({m_keys[id], edge.first}, edge.second);
+        }
+        return freeze(graph);
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    typename CompressedCsrGraph<key_type, value_type, weight_type>::Node CompressedCsrGraph<key_type, value_type, weight_type>::at(const key_type &key) const {
+        return Node(this, id_of(key));
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    typename CompressedCsrGraph<key_type, value_type, weight_type>::const_iterator CompressedCsrGraph<key_type, value_type, weight_type>::find(const key_type &key) const {
+        auto find = m_ids.find(key);
+        if (find == m_ids.end()) return cend();
+        return const_iterator(this, find->second);
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    vertex_id CompressedCsrGraph<key_type, value_type, weight_type>::id_of(const key_type &key) const {
+        auto find = m_ids.find(key);
+        if (find == m_ids.end()) throw GraphException("Key not found");
+        return find->second;
+    }
+
+    /**
+     * @ingroup Frozen
+     * @brief Builds a CompressedCsrGraph snapshot of the given graph.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    CompressedCsrGraph<key_type, value_type, weight_type> compress(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph) {
+        return CompressedCsrGraph<key_type, value_type, weight_type>(graph);
+    }
+}
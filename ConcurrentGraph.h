@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Graph.h"
+
+namespace graph {
+    /**
+     * @ingroup Graph
+     * @brief Graph that can be read and written from many threads at once
+     *
+     * @details
+     * The nodes are split over shard_count shards by the hash of their key, and every shard has its own
+     * reader-writer lock, so writers to different shards do not contend. Each node also has its own reader-writer
+     * lock around its edges, and the shard lock is released before the node lock is taken. Ingest threads inserting
+     * edges out of different nodes therefore run in parallel, and readers only wait for a writer on the same node.
+     * Nodes are heap-allocated and never move, so a node found under the shard lock stays valid.
+     *
+     * The interface follows Graph, but nothing hands out iterators or references, since they could not be used
+     * safely while other threads write. Lookups return copies; visit runs a function under the node's read lock.
+     * Use to_graph() to get a Graph (and from it a CsrGraph) for the algorithms.
+     *
+     * @tparam key_type - type of the key of the node
+     * @tparam value_type - type of the value of the node
+     * @tparam weight_type - type of the weight of the edge
+     * @tparam shard_count - the number of lock stripes over the nodes
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count = 64>
+    class ConcurrentGraph {
+        static_assert(shard_count > 0, "ConcurrentGraph needs at least one shard");
+    public:
+        class Node;
+
+        ConcurrentGraph() = default;
+        ConcurrentGraph(const ConcurrentGraph&) = delete;
+        ConcurrentGraph& operator=(const ConcurrentGraph&) = delete;
+
+        bool empty() const noexcept { return size() == 0; } /**< @brief Checks if the graph is empty. */
+        size_t size() const noexcept { return m_size.load(std::memory_order_relaxed); } /**< @brief Counts the number of nodes in the graph. */
+
+        bool contains(const key_type& key) const { return locate(key) != nullptr; } /**< @brief Checks if a node with the given key exists. */
+        std::optional<value_type> find(const key_type& key) const;
+        template<typename function_type>
+        bool visit(const key_type& key, function_type&& function) const;
+
+        size_t degree_in(const key_type& key) const; /**< @brief Counts the number of edges that end in the node with the given key. */
+        size_t degree_out(const key_type& key) const; /**< @brief Counts the number of edges that start in the node with the given key. */
+        bool has_edge(const key_type& source, const key_type& target) const;
+        std::optional<weight_type> edge_weight(const key_type& source, const key_type& target) const;
+
+        /** @brief Inserts a node with the given key and value. */
+        bool insert_node(const key_type& key, const value_type& value);
+        /** @brief Inserts or assigns a node with the given key and value. */
+        bool insert_or_assign_node(const key_type& key, const value_type& value);
+        /** @brief Inserts an edge. */
+        bool insert_edge(const std::pair<key_type, key_type>& end_points, const weight_type& weight);
+        /** @brief Inserts or assigns an edge. */
+        bool insert_or_assign_edge(const std::pair<key_type, key_type>& end_points, const weight_type& weight);
+
+        Graph<key_type, value_type, weight_type> to_graph() const;
+    private:
+        /** @brief One lock stripe: a share of the nodes and the lock that guards the map (not the nodes). */
+        struct Shard {
+            mutable std::shared_mutex m_mutex;
+            std::unordered_map<key_type, std::unique_ptr<Node>> m_nodes;
+        };
+
+        Shard& shard_of(const key_type& key) noexcept { return m_shards[std::hash<key_type>{}(key) % shard_count]; }
+        const Shard& shard_of(const key_type& key) const noexcept { return m_shards[std::hash<key_type>{}(key) % shard_count]; }
+        Node* locate(const key_type& key) const;
+        template<bool assign>
+        bool insert_edge_impl(const std::pair<key_type, key_type>& end_points, const weight_type& weight);
+
+        std::array<Shard, shard_count> m_shards;
+        std::atomic<size_t> m_size{0};
+    };
+
+    /**
+     * @ingroup Graph
+     * @brief Node of a ConcurrentGraph
+     *
+     * @details Only reachable through ConcurrentGraph::visit, which holds the node's read lock for the duration.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    class ConcurrentGraph<key_type, value_type, weight_type, shard_count>::Node {
+        friend class ConcurrentGraph;
+    public:
+        explicit Node(value_type value) : m_value(std::move(value)) {}
+
+        size_t size() const noexcept { return m_edge.size(); } /**< @brief Returns the number of edges in the node. */
+        const value_type &getvalue() const noexcept { return m_value; } /**< @brief Returns the value of the node. */
+        const std::unordered_map<key_type, weight_type> &getedges() const noexcept { return m_edge; } /**< @brief Returns the map of edges. */
+    private:
+        mutable std::shared_mutex m_mutex; /**< @brief Guards the value and the edges. */
+        value_type m_value; /**< @brief The value of the node. */
+        std::unordered_map<key_type, weight_type> m_edge; /**< @brief The edges of the node. */
+        std::atomic<size_t> m_in_degree{0}; /**< @brief The number of edges that end in the node. */
+    };
+
+    /** @details Returns nullptr if the key is not found. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    typename ConcurrentGraph<key_type, value_type, weight_type, shard_count>::Node*
+    ConcurrentGraph<key_type, value_type, weight_type, shard_count>::locate(const key_type &key) const {
+        auto const &shard = shard_of(key);
+        std::shared_lock lock(shard.m_mutex);
+        auto find = shard.m_nodes.find(key);
+        return find == shard.m_nodes.end() ? nullptr : find->second.get();
+    }
+
+    /** @brief Returns a copy of the value of the node with the given key, or nothing if it does not exist. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    std::optional<value_type> ConcurrentGraph<key_type, value_type, weight_type, shard_count>::find(const key_type &key) const {
+        Node* node = locate(key);
+        if (node == nullptr) return std::nullopt;
+        std::shared_lock lock(node->m_mutex);
+        return node->m_value;
+    }
+
+    /**
+     * @brief Calls function(const Node&) under the read lock of the node with the given key.
+     * @return False if the node does not exist, true otherwise
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    template<typename function_type>
+    bool ConcurrentGraph<key_type, value_type, weight_type, shard_count>::visit(const key_type &key, function_type&& function) const {
+        Node* node = locate(key);
+        if (node == nullptr) return false;
+        std::shared_lock lock(node->m_mutex);
+        function(static_cast<const Node&>(*node));
+        return true;
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    size_t ConcurrentGraph<key_type, value_type, weight_type, shard_count>::degree_in(const key_type &key) const {
+        Node* node = locate(key);
+        if (node == nullptr) throw GraphException("Key not found");
+        return node->m_in_degree.load(std::memory_order_relaxed);
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    size_t ConcurrentGraph<key_type, value_type, weight_type, shard_count>::degree_out(const key_type &key) const {
+        Node* node = locate(key);
+        if (node == nullptr) throw GraphException("Key not found");
+        std::shared_lock lock(node->m_mutex);
+        return node->m_edge.size();
+    }
+
+    /**
+     * @brief Checks if there is an edge from source to target.
+     * @throws If the source key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool ConcurrentGraph<key_type, value_type, weight_type, shard_count>::has_edge(const key_type &source, const key_type &target) const {
+        Node* node = locate(source);
+        if (node == nullptr) throw GraphException("Key not found");
+        std::shared_lock lock(node->m_mutex);
+        return node->m_edge.find(target) != node->m_edge.end();
+    }
+
+    /**
+     * @brief Returns the weight of the edge from source to target, or nothing if there is no such edge.
+     * @throws If the source key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    std::optional<weight_type> ConcurrentGraph<key_type, value_type, weight_type, shard_count>::edge_weight(const key_type &source, const key_type &target) const {
+        Node* node = locate(source);
+        if (node == nullptr) throw GraphException("Key not found");
+        std::shared_lock lock(node->m_mutex);
+        auto find = node->m_edge.find(target);
+        if (find == node->m_edge.end()) return std::nullopt;
+        return find->second;
+    }
+
+    /** @return True if the node was inserted, false if the key already existed */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool ConcurrentGraph<key_type, value_type, weight_type, shard_count>::insert_node(const key_type &key, const value_type &value) {
+        auto &shard = shard_of(key);
+        std::unique_lock lock(shard.m_mutex);
+        if (shard.m_nodes.find(key) != shard.m_nodes.end()) return false;
+        shard.m_nodes.emplace(key, std::make_unique<Node>(value));
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @details Like Graph::insert_or_assign_node, a replaced node loses its outgoing edges and keeps the incoming ones.
+     * @return True if the node was inserted, false if it was assigned
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool ConcurrentGraph<key_type, value_type, weight_type, shard_count>::insert_or_assign_node(const key_type &key, const value_type &value) {
+        if (insert_node(key, value)) return true;
+        Node* node = locate(key);
+        std::unordered_map<key_type, weight_type> dropped;
+        {
+            std::unique_lock lock(node->m_mutex);
+            node->m_value = value;
+            dropped.swap(node->m_edge);
+        }
+        for (auto const &edge: dropped) locate(edge.first)->m_in_degree.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /** @throws If a key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    template<bool assign>
+    bool ConcurrentGraph<key_type, value_type, weight_type, shard_count>::insert_edge_impl(const std::pair<key_type, key_type> &end_points, const weight_type &weight) {
+        Node* source = locate(end_points.first);
+        Node* target = locate(end_points.second);
+        if (source == nullptr || target == nullptr) throw GraphException("Key not found");
+        bool inserted;
+        {
+            std::unique_lock lock(source->m_mutex);
+            if constexpr (assign) inserted = source->m_edge.insert_or_assign(end_points.second, weight).second;
+            else inserted = source->m_edge.insert({end_points.second, weight}).second;
+        }
+        if (inserted) target->m_in_degree.fetch_add(1, std::memory_order_relaxed);
+        return inserted;
+    }
+
+    /**
+     * @return True if the edge was inserted, false if it already existed
+     * @throws If a key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool ConcurrentGraph<key_type, value_type, weight_type, shard_count>::insert_edge(const std::pair<key_type, key_type> &end_points, const weight_type &weight) {
+        return insert_edge_impl<false>(end_points, weight);
+    }
+
+    /**
+     * @return True if the edge was inserted, false if it was assigned
+     * @throws If a key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool ConcurrentGraph<key_type, value_type, weight_type, shard_count>::insert_or_assign_edge(const std::pair<key_type, key_type> &end_points, const weight_type &weight) {
+        return insert_edge_impl<true>(end_points, weight);
+    }
+
+    /**
+     * @brief Copies the graph into a Graph.
+     * @details Each node is copied under its own read lock, so the copy is consistent per node but not across the
+     * whole graph if writers are running. Edges to nodes inserted after the node pass are dropped.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    Graph<key_type, value_type, weight_type> ConcurrentGraph<key_type, value_type, weight_type, shard_count>::to_graph() const {
+        Graph<key_type, value_type, weight_type> graph;
+        graph.reserve(size());
+        std::vector<std::pair<std::pair<key_type, key_type>, weight_type>> edges;
+        for (auto const &shard: m_shards) {
+            std::shared_lock lock(shard.m_mutex);
+            for (auto const &elem: shard.m_nodes) {
+                std::shared_lock node_lock(elem.second->m_mutex);
+                graph.insert_node(elem.first, elem.second->m_value);
+                for (auto const &edge: elem.second->m_edge) edges.push_back({{elem.first, edge.first}, edge.second});
+            }
+        }
+        graph.insert_edges(edges);
+        return graph;
+    }
+}
@@ -0,0 +1,524 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Graph.h"
+
+namespace graph {
+    namespace detail {
+        /** @brief Fixed-size array of bits. */
+        class bit_vector {
+        public:
+            bit_vector() = default;
+            explicit bit_vector(size_t size) : m_words((size + 63) / 64, 0), m_size(size) {}
+
+            size_t size() const noexcept { return m_size; } /**< @brief Counts the bits, set or not. */
+            bool test(size_t position) const noexcept { return (m_words[position / 64] >> (position % 64)) & 1; }
+            void set(size_t position) noexcept { m_words[position / 64] |= std::uint64_t{1} << (position % 64); }
+            void reset(size_t position) noexcept { m_words[position / 64] &= ~(std::uint64_t{1} << (position % 64)); }
+
+            /** @brief Calls visit(position) for every set bit, in ascending order, skipping empty words. */
+            template<typename function_type>
+            void for_each_set(function_type&& visit) const {
+                for (size_t word = 0; word < m_words.size(); ++word) {
+                    for (std::uint64_t bits = m_words[word]; bits != 0; bits &= bits - 1) visit(word * 64 + lowest_bit(bits));
+                }
+            }
+        private:
+            static size_t lowest_bit(std::uint64_t bits) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+                return static_cast<size_t>(__builtin_ctzll(bits));
+#else
+                size_t position = 0;
+                for (; (bits & 1) == 0; bits >>= 1) ++position;
+                return position;
+#endif
+            }
+
+            std::vector<std::uint64_t> m_words;
+            size_t m_size = 0;
+        };
+
+        /** @brief Edges as EdgeList holds them, between ids. */
+        template<typename weight_type>
+        using id_edge_list = std::vector<std::pair<std::pair<vertex_id, vertex_id>, weight_type>>;
+
+        /**
+         * @brief Non-owning view of a contiguous array
+         *
+         * @details A minimal stand-in for std::span, used to hand out rows of the CSR arrays without copying them.
+         */
+        template<typename T>
+        class array_view {
+        public:
+            using const_iterator = const T*;
+            using iterator = const T*;
+
+            array_view() = default;
+            array_view(const T* first, const T* last) noexcept : m_begin(first), m_end(last) {}
+
+            const T* begin() const noexcept { return m_begin; }
+            const T* end() const noexcept { return m_end; }
+            const T* cbegin() const noexcept { return m_begin; }
+            const T* cend() const noexcept { return m_end; }
+            bool empty() const noexcept { return m_begin == m_end; }
+            size_t size() const noexcept { return static_cast<size_t>(m_end - m_begin); }
+            const T& operator[](size_t index) const noexcept { return m_begin[index]; }
+        private:
+            const T* m_begin = nullptr;
+            const T* m_end = nullptr;
+        };
+
+        /** @brief Holds a temporary so that a proxy iterator can return it from operator->. */
+        template<typename T>
+        struct arrow_proxy {
+            T m_value;
+            const T* operator->() const noexcept { return &m_value; }
+        };
+
+        /**
+         * @brief Iterates one row of a CSR layout, yielding pairs of a neighbor key and a weight.
+         * @details The keys are looked up through Owner::key_of, which returns KeyReference.
+         */
+        template<typename KeyReference, typename Weight, typename Owner>
+        class csr_edge_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<KeyReference, const Weight&>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+            using pointer = arrow_proxy<value_type>;
+
+            csr_edge_iterator() = default;
+            csr_edge_iterator(const Owner* graph, const vertex_id* neighbor, const Weight* weight) noexcept
+                : m_graph(graph), m_neighbor(neighbor), m_weight(weight) {}
+
+            reference operator*() const noexcept { return {m_graph->key_of(*m_neighbor), *m_weight}; }
+            pointer operator->() const noexcept { return {**this}; }
+            vertex_id id() const noexcept { return *m_neighbor; } /**< @brief Returns the id of the neighbor. */
+
+            csr_edge_iterator& operator++() noexcept { ++m_neighbor; ++m_weight; return *this; }
+            csr_edge_iterator operator++(int) noexcept { auto copy = *this; ++*this; return copy; }
+            bool operator==(const csr_edge_iterator& other) const noexcept { return m_neighbor == other.m_neighbor; }
+            bool operator!=(const csr_edge_iterator& other) const noexcept { return m_neighbor != other.m_neighbor; }
+        private:
+            const Owner* m_graph = nullptr;
+            const vertex_id* m_neighbor = nullptr;
+            const Weight* m_weight = nullptr;
+        };
+
+        /** @brief Calls visit(id) for every id in the union of two sorted lists of distinct ids, in ascending order. */
+        template<typename function_type>
+        void for_each_union(const vertex_id* first, size_t first_size, const vertex_id* second, size_t second_size, function_type&& visit) {
+            size_t i = 0;
+            size_t j = 0;
+            while (i < first_size || j < second_size) {
+                if (j == second_size || (i < first_size && first[i] < second[j])) visit(first[i++]);
+                else if (i == first_size || second[j] < first[i]) visit(second[j++]);
+                else {
+                    visit(first[i++]);
+                    ++j;
+                }
+            }
+        }
+
+        /** @brief Iterates the nodes of a frozen graph in id order, yielding pairs of a key and a Node view. */
+        template<typename KeyReference, typename NodeView, typename Owner>
+        class csr_node_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<KeyReference, NodeView>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+            using pointer = arrow_proxy<value_type>;
+
+            csr_node_iterator() = default;
+            csr_node_iterator(const Owner* graph, vertex_id id) noexcept : m_graph(graph), m_id(id) {}
+
+            reference operator*() const noexcept { return {m_graph->key_of(m_id), (*m_graph)[m_id]}; }
+            pointer operator->() const noexcept { return {**this}; }
+            vertex_id id() const noexcept { return m_id; } /**< @brief Returns the id of the node. */
+
+            csr_node_iterator& operator++() noexcept { ++m_id; return *this; }
+            csr_node_iterator operator++(int) noexcept { auto copy = *this; ++m_id; return copy; }
+            bool operator==(const csr_node_iterator& other) const noexcept { return m_id == other.m_id; }
+            bool operator!=(const csr_node_iterator& other) const noexcept { return m_id != other.m_id; }
+        private:
+            const Owner* m_graph = nullptr;
+            vertex_id m_id = 0;
+        };
+    }
+
+    /** @defgroup Frozen Frozen graphs */
+
+    /**
+     * @ingroup Frozen
+     * @brief Compressed Sparse Row snapshot of a Graph
+     *
+     * @details
+     * A read-only copy of a Graph laid out for traversal. Every node keeps its interned id from the Graph, and the edges
+     * of all nodes are stored back to back in two contiguous arrays (neighbor ids and weights), indexed by an
+     * offset array. The neighbors of each node are sorted by id.
+     *
+     * Iteration mirrors Graph: iterating a CsrGraph yields pairs of a key and a Node view, and iterating a Node
+     * yields pairs of a neighbor key and an edge weight. Both are returned by value and refer into the snapshot.
+     *
+     * @tparam key_type - type of the key of the node
+     * @tparam value_type - type of the value of the node
+     * @tparam weight_type - type of the weight of the edge
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    class CsrGraph {
+    public:
+        class Node;
+
+        using const_iterator = detail::csr_node_iterator<const key_type&, Node, CsrGraph>;
+        using iterator = const_iterator;
+
+        CsrGraph() = default;
+        /** @brief Builds a snapshot of the given graph; the graph is not modified. */
+        template<typename graph_type>
+        explicit CsrGraph(const graph_type& graph);
+
+        bool empty() const noexcept { return m_keys.empty(); } /**< @brief Checks if the snapshot has no nodes. */
+        size_t size() const noexcept { return m_keys.size(); } /**< @brief Counts the number of nodes. */
+        size_t edge_count() const noexcept { return m_neighbors.size(); } /**< @brief Counts the number of edges. */
+
+        const_iterator cbegin() const noexcept { return const_iterator(this, 0); }
+        const_iterator cend() const noexcept { return const_iterator(this, static_cast<vertex_id>(size())); }
+        const_iterator begin() const noexcept { return cbegin(); }
+        const_iterator end() const noexcept { return cend(); }
+
+        Node operator[](vertex_id id) const noexcept { return Node(this, id); } /**< @brief Returns the node with the given id. */
+        Node at(const key_type& key) const;
+        const_iterator find(const key_type& key) const;
+
+        vertex_id id_of(const key_type& key) const;
+        const key_type& key_of(vertex_id id) const noexcept { return m_keys[id]; } /**< @brief Returns the key of the node with the given id. */
+
+        size_t degree_out(const key_type& key) const { return at(key).size(); } /**< @brief Counts the number of edges that start in the node with the given key. */
+        size_t degree_out_by_id(vertex_id id) const noexcept { return m_offsets[id + 1] - m_offsets[id]; } /**< @brief Counts the edges that start in the node with the given id. */
+
+        CsrGraph transpose() const; /**< @brief Returns the snapshot with every edge reversed. */
+        CsrGraph permute(const std::vector<vertex_id>& order) const;
+        /** @brief Returns the snapshot with only the edges whose position in neighbors() satisfies keep. */
+        template<typename predicate_type>
+        CsrGraph filter_edges(predicate_type&& keep) const;
+        /** @brief Returns the snapshot with only the nodes whose id satisfies keep and the edges between them, renumbered in id order. */
+        template<typename predicate_type>
+        CsrGraph filter_nodes(predicate_type&& keep) const;
+        /** @brief Returns the snapshot with only the edges that satisfy keep, as filter_edges, then new nodes and edges added and values replaced. */
+        template<typename predicate_type>
+        CsrGraph merge(predicate_type&& keep, std::vector<std::pair<key_type, value_type>> nodes, const detail::id_edge_list<weight_type>& edges,
+                       std::vector<std::pair<vertex_id, value_type>> values = {}) const;
+
+        /** @brief Returns the offset array; the edges of node i occupy [offsets()[i], offsets()[i + 1]). */
+        const std::vector<size_t>& offsets() const noexcept { return m_offsets; }
+        const std::vector<vertex_id>& neighbors() const noexcept { return m_neighbors; } /**< @brief Returns the neighbor ids of all edges. */
+        const std::vector<weight_type>& weights() const noexcept { return m_weights; } /**< @brief Returns the weights of all edges. */
+    private:
+        std::vector<size_t> m_offsets{0}; /**< @brief Start of every node's row in the edge arrays, plus the end. */
+        std::vector<vertex_id> m_neighbors; /**< @brief Target ids of all edges, row by row. */
+        std::vector<weight_type> m_weights; /**< @brief Weights of all edges, parallel to m_neighbors. */
+        std::vector<key_type> m_keys; /**< @brief Key of every node, indexed by id. */
+        std::vector<value_type> m_values; /**< @brief Value of every node, indexed by id. */
+        std::unordered_map<key_type, vertex_id> m_ids; /**< @brief Maps keys back to ids. */
+    };
+
+    /**
+     * @ingroup Frozen
+     * @brief View of a single node of a CsrGraph
+     *
+     * @details Cheap to copy; it refers into the snapshot and stays valid as long as the snapshot does.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    class CsrGraph<key_type, value_type, weight_type>::Node {
+    public:
+        using const_iterator = detail::csr_edge_iterator<const key_type&, weight_type, CsrGraph>;
+        using iterator = const_iterator;
+
+        Node() = default;
+        Node(const CsrGraph* graph, vertex_id id) noexcept : m_graph(graph), m_id(id) {}
+
+        bool empty() const noexcept { return size() == 0; } /**< @brief Returns true if the node has no edges, false otherwise. */
+        size_t size() const noexcept { return m_graph->degree_out_by_id(m_id); } /**< @brief Returns the number of edges in the node. */
+        vertex_id id() const noexcept { return m_id; } /**< @brief Returns the id of the node. */
+        const key_type& key() const noexcept { return m_graph->m_keys[m_id]; } /**< @brief Returns the key of the node. */
+        const value_type& value() const noexcept { return m_graph->m_values[m_id]; } /**< @brief Returns the value of the node. */
+        const value_type& getvalue() const noexcept { return value(); }
+
+        const_iterator cbegin() const noexcept { return edge_iterator(m_graph->m_offsets[m_id]); }
+        const_iterator cend() const noexcept { return edge_iterator(m_graph->m_offsets[m_id + 1]); }
+        const_iterator begin() const noexcept { return cbegin(); }
+        const_iterator end() const noexcept { return cend(); }
+
+        /** @brief Returns the ids of the neighbors, sorted ascending. */
+        detail::array_view<vertex_id> neighbors() const noexcept {
+            return {m_graph->m_neighbors.data() + m_graph->m_offsets[m_id], m_graph->m_neighbors.data() + m_graph->m_offsets[m_id + 1]};
+        }
+        /** @brief Returns the weights of the edges, parallel to neighbors(). */
+        detail::array_view<weight_type> weights() const noexcept {
+            return {m_graph->m_weights.data() + m_graph->m_offsets[m_id], m_graph->m_weights.data() + m_graph->m_offsets[m_id + 1]};
+        }
+    private:
+        const_iterator edge_iterator(size_t offset) const noexcept {
+            return const_iterator(m_graph, m_graph->m_neighbors.data() + offset, m_graph->m_weights.data() + offset);
+        }
+
+        const CsrGraph* m_graph = nullptr;
+        vertex_id m_id = 0;
+    };
+
+    /**
+     * @details Nodes keep the ids the graph interned them with. Two passes: the first collects the nodes by id and
+     * computes the offsets, the second fills each row and sorts it by neighbor id.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    template<typename graph_type>
+    CsrGraph<key_type, value_type, weight_type>::CsrGraph(const graph_type& graph) : m_keys(graph.keys().begin(), graph.keys().end()) {
+        std::vector<const typename graph_type::Node*> nodes(m_keys.size());
+        m_offsets.resize(m_keys.size() + 1, 0);
+        m_ids.reserve(m_keys.size());
+        for (auto const &elem: graph) {
+            nodes[elem.second.id()] = &elem.second;
+            m_offsets[elem.second.id() + 1] = elem.second.getedges().size();
+            m_ids.emplace(elem.first, elem.second.id());
+        }
+        for (size_t id = 0; id < m_keys.size(); ++id) m_offsets[id + 1] += m_offsets[id];
+        m_neighbors.resize(m_offsets.back());
+        m_weights.resize(m_offsets.back());
+        m_values.reserve(m_keys.size());
+
+        std::vector<std::pair<vertex_id, weight_type>> row;
+        for (size_t id = 0; id < m_keys.size(); ++id) {
+            m_values.push_back(nodes[id]->getvalue());
+            row.clear();
+            for (auto const &edge: nodes[id]->getedges()) row.emplace_back(graph.id_of(edge.first), edge.second);
+            std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            size_t offset = m_offsets[id];
+            for (auto const &edge: row) {
+                m_neighbors[offset] = edge.first;
+                m_weights[offset] = edge.second;
+                ++offset;
+            }
+        }
+    }
+
+    /**
+     * @details Returns a snapshot with the same nodes and ids and every edge reversed, so the rows list the
+     * incoming edges of each node. The rows stay sorted because the sources are visited in id order.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    CsrGraph<key_type, value_type, weight_type> CsrGraph<key_type, value_type, weight_type>::transpose() const {
+        CsrGraph result;
+        result.m_keys = m_keys;
+        result.m_values = m_values;
+        result.m_ids = m_ids;
+        result.m_offsets.assign(size() + 1, 0);
+        for (auto target: m_neighbors) ++result.m_offsets[target + 1];
+        for (size_t id = 0; id < size(); ++id) result.m_offsets[id + 1] += result.m_offsets[id];
+        result.m_neighbors.resize(edge_count());
+        result.m_weights.resize(edge_count());
+
+        std::vector<size_t> next(result.m_offsets.begin(), result.m_offsets.end() - 1);
+        for (size_t source = 0; source < size(); ++source) {
+            for (size_t edge = m_offsets[source]; edge < m_offsets[source + 1]; ++edge) {
+                size_t position = next[m_neighbors[edge]]++;
+                result.m_neighbors[position] = static_cast<vertex_id>(source);
+                result.m_weights[position] = m_weights[edge];
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @details Keeps every node and its id. keep(position) is called once per edge, in order, with its index
+     * into neighbors() and weights(); the rows stay sorted.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    template<typename predicate_type>
+    CsrGraph<key_type, value_type, weight_type> CsrGraph<key_type, value_type, weight_type>::filter_edges(predicate_type&& keep) const {
+        CsrGraph result;
+        result.m_keys = m_keys;
+        result.m_values = m_values;
+        result.m_ids = m_ids;
+        result.m_offsets.assign(size() + 1, 0);
+        result.m_neighbors.reserve(edge_count());
+        result.m_weights.reserve(edge_count());
+        for (size_t source = 0; source < size(); ++source) {
+            for (size_t edge = m_offsets[source]; edge < m_offsets[source + 1]; ++edge) {
+                if (!keep(edge)) continue;
+                result.m_neighbors.push_back(m_neighbors[edge]);
+                result.m_weights.push_back(m_weights[edge]);
+            }
+            result.m_offsets[source + 1] = result.m_neighbors.size();
+        }
+        result.m_neighbors.shrink_to_fit();
+        result.m_weights.shrink_to_fit();
+        return result;
+    }
+
+    /**
+     * @details keep(id) is called once per node, in id order. The kept nodes get the ids 0, 1, and so on, in their
+     * old order, so the rows stay sorted; edges that start or end in a dropped node are dropped.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    template<typename predicate_type>
+    CsrGraph<key_type, value_type, weight_type> CsrGraph<key_type, value_type, weight_type>::filter_nodes(predicate_type&& keep) const {
+        std::vector<vertex_id> rank(size(), no_vertex);
+        CsrGraph result;
+        for (size_t id = 0; id < size(); ++id) {
+            if (!keep(static_cast<vertex_id>(id))) continue;
+            rank[id] = static_cast<vertex_id>(result.m_keys.size());
+            result.m_ids.emplace(m_keys[id], rank[id]);
+            result.m_keys.push_back(m_keys[id]);
+            result.m_values.push_back(m_values[id]);
+        }
+        result.m_offsets.reserve(result.m_keys.size() + 1);
+        for (size_t id = 0; id < size(); ++id) {
+            if (rank[id] == no_vertex) continue;
+            for (size_t edge = m_offsets[id]; edge < m_offsets[id + 1]; ++edge) {
+                if (rank[m_neighbors[edge]] == no_vertex) continue;
+                result.m_neighbors.push_back(rank[m_neighbors[edge]]);
+                result.m_weights.push_back(m_weights[edge]);
+            }
+            result.m_offsets.push_back(result.m_neighbors.size());
+        }
+        return result;
+    }
+
+    /**
+     * @details The new nodes get the ids size(), size() + 1, and so on, in order, and their keys must not be present
+     * yet. The edges must be sorted by source and then target, may refer to the new nodes, and must not repeat an
+     * edge that is kept. Every row is a merge of its kept and its added edges, so the rows stay sorted. Then every
+     * (id, value) of values, in order, replaces the value of its node, so a later entry for an id wins.
+     * @throws If an edge or a value refers to an id out of range, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    template<typename predicate_type>
+    CsrGraph<key_type, value_type, weight_type> CsrGraph<key_type, value_type, weight_type>::merge(predicate_type&& keep, std::vector<std::pair<key_type, value_type>> nodes,
+                                                                                               const detail::id_edge_list<weight_type>& edges,
+                                                                                               std::vector<std::pair<vertex_id, value_type>> values) const {
+        size_t count = size() + nodes.size();
+        for (auto const &edge: edges) {
+            if (edge.first.first >= count || edge.first.second >= count) throw GraphException("Vertex not found");
+        }
+        for (auto const &value: values) {
+            if (value.first >= count) throw GraphException("Vertex not found");
+        }
+        CsrGraph result;
+        result.m_keys = m_keys;
+        result.m_values = m_values;
+        result.m_ids = m_ids;
+        result.m_keys.reserve(count);
+        result.m_values.reserve(count);
+        for (auto &node: nodes) {
+            result.m_ids.emplace(node.first, static_cast<vertex_id>(result.m_keys.size()));
+            result.m_keys.push_back(std::move(node.first));
+            result.m_values.push_back(std::move(node.second));
+        }
+        for (auto &value: values) result.m_values[value.first] = std::move(value.second);
+        result.m_offsets.assign(count + 1, 0);
+        result.m_neighbors.reserve(edge_count() + edges.size());
+        result.m_weights.reserve(edge_count() + edges.size());
+        auto added = edges.begin();
+        for (size_t source = 0; source < count; ++source) {
+            size_t edge = source < size() ? m_offsets[source] : 0;
+            size_t end = source < size() ? m_offsets[source + 1] : 0;
+            for (;;) {
+                while (edge < end && !keep(edge)) ++edge;
+                bool more_added = added != edges.end() && added->first.first == source;
+                if (edge == end && !more_added) break;
+                if (edge < end && (!more_added || m_neighbors[edge] < added->first.second)) {
+                    result.m_neighbors.push_back(m_neighbors[edge]);
+                    result.m_weights.push_back(m_weights[edge]);
+                    ++edge;
+                } else {
+                    result.m_neighbors.push_back(added->first.second);
+                    result.m_weights.push_back(added->second);
+                    ++added;
+                }
+            }
+            result.m_offsets[source + 1] = result.m_neighbors.size();
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the snapshot with the nodes renumbered: new id i is the node with old id order[i].
+     * @details Keys and values move with their nodes, so key_of maps ids of the new snapshot back to keys. The
+     * rows are sorted again by the new ids.
+     * @throws If order is not a permutation of the ids, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    CsrGraph<key_type, value_type, weight_type> CsrGraph<key_type, value_type, weight_type>::permute(const std::vector<vertex_id>& order) const {
+        if (order.size() != size()) throw GraphException("Size mismatch");
+        std::vector<vertex_id> rank(size(), no_vertex);
+        for (size_t id = 0; id < size(); ++id) {
+            if (order[id] >= size() || rank[order[id]] != no_vertex) throw GraphException("Invalid permutation");
+            rank[order[id]] = static_cast<vertex_id>(id);
+        }
+
+        CsrGraph result;
+        result.m_keys.reserve(size());
+        result.m_values.reserve(size());
+        result.m_ids.reserve(size());
+        result.m_offsets.assign(size() + 1, 0);
+        for (size_t id = 0; id < size(); ++id) {
+            result.m_keys.push_back(m_keys[order[id]]);
+            result.m_values.push_back(m_values[order[id]]);
+            result.m_ids.emplace(m_keys[order[id]], static_cast<vertex_id>(id));
+            result.m_offsets[id + 1] = result.m_offsets[id] + degree_out_by_id(order[id]);
+        }
+        result.m_neighbors.resize(edge_count());
+        result.m_weights.resize(edge_count());
+
+        std::vector<std::pair<vertex_id, size_t>> row;
+        for (size_t id = 0; id < size(); ++id) {
+            row.clear();
+            for (size_t edge = m_offsets[order[id]]; edge < m_offsets[order[id] + 1]; ++edge) row.emplace_back(rank[m_neighbors[edge]], edge);
+            std::sort(row.begin(), row.end());
+            size_t position = result.m_offsets[id];
+            for (auto const &edge: row) {
+                result.m_neighbors[position] = edge.first;
+                result.m_weights[position] = m_weights[edge.second];
+                ++position;
+            }
+        }
+        return result;
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    typename CsrGraph<key_type, value_type, weight_type>::Node CsrGraph<key_type, value_type, weight_type>::at(const key_type &key) const {
+        return Node(this, id_of(key));
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    typename CsrGraph<key_type, value_type, weight_type>::const_iterator CsrGraph<key_type, value_type, weight_type>::find(const key_type &key) const {
+        auto find = m_ids.find(key);
+        if (find == m_ids.end()) return cend();
+        return const_iterator(this, find->second);
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    vertex_id CsrGraph<key_type, value_type, weight_type>::id_of(const key_type &key) const {
+        auto find = m_ids.find(key);
+        if (find == m_ids.end()) throw GraphException("Key not found");
+        return find->second;
+    }
+
+    /**
+     * @ingroup Frozen
+     * @brief Builds a CsrGraph snapshot of the given graph.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    CsrGraph<key_type, value_type, weight_type> freeze(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph) {
+        return CsrGraph<key_type, value_type, weight_type>(graph);
+    }
+}
@@ -0,0 +1,578 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "Storage.h"
+
+namespace graph {
+    /**
+     * @ingroup Frozen
+     * @brief When a DeltaCsrGraph merges its tombstones and inserts into a new base, and on which thread
+     */
+    struct DeltaOptions {
+        double compact_ratio = 0.05; /**< @brief Compact once this fraction of the base edges are tombstones; 0 only compacts on request. */
+        double merge_ratio = 0.05; /**< @brief Merge once the inserted nodes and edges reach this fraction of the base edges; 0 only merges on request. */
+        bool background = true; /**< @brief Merge on a background thread instead of inside the call that triggers it. */
+    };
+
+    namespace detail {
+        /** @brief The sources of the incoming edges of every node of a CsrGraph; the edges of node i occupy [offsets[i], offsets[i + 1]). */
+        struct in_edge_rows {
+            std::vector<size_t> offsets{0};
+            std::vector<vertex_id> sources;
+        };
+
+        /** @brief Builds the incoming rows of a snapshot with a counting sort, as CsrGraph::transpose does, without the weights. */
+        template<typename csr_type>
+        in_edge_rows build_in_edge_rows(const csr_type& graph) {
+            in_edge_rows rows;
+            auto const &offsets = graph.offsets();
+            auto const &neighbors = graph.neighbors();
+            rows.offsets.assign(graph.size() + 1, 0);
+            for (auto target: neighbors) ++rows.offsets[target + 1];
+            for (size_t id = 0; id < graph.size(); ++id) rows.offsets[id + 1] += rows.offsets[id];
+            rows.sources.resize(neighbors.size());
+            std::vector<size_t> next(rows.offsets.begin(), rows.offsets.end() - 1);
+            for (size_t source = 0; source < graph.size(); ++source) {
+                for (size_t edge = offsets[source]; edge < offsets[source + 1]; ++edge) rows.sources[next[neighbors[edge]]++] = static_cast<vertex_id>(source);
+            }
+            return rows;
+        }
+
+        /**
+         * @brief Edges inserted into a DeltaCsrGraph: a hash map of targets and weights per source, as a Graph node
+         * keeps its edges, and the sources of every target for erase_node
+         */
+        template<typename weight_type>
+        struct edge_delta {
+            flat_hash_map<vertex_id, flat_hash_map<vertex_id, weight_type>> out;
+            flat_hash_map<vertex_id, flat_hash_set<vertex_id>> in;
+            size_t edges = 0;
+
+            /** @brief Returns the weight of the edge, or nullptr if it is not in the delta. */
+            const weight_type* find(vertex_id source, vertex_id target) const noexcept {
+                auto row = out.find(source);
+                if (row == out.end()) return nullptr;
+                auto edge = row->second.find(target);
+                return edge == row->second.end() ? nullptr : &edge->second;
+            }
+
+            bool insert(vertex_id source, vertex_id target, weight_type weight) {
+                if (!out[source].try_emplace(target, std::move(weight)).second) return false;
+                in[target].insert(source);
+                ++edges;
+                return true;
+            }
+
+            bool erase(vertex_id source, vertex_id target) {
+                auto row = out.find(source);
+                if (row == out.end() || row->second.erase(target) == 0) return false;
+                if (row->second.empty()) out.erase(row);
+                auto sources = in.find(target);
+                sources->second.erase(source);
+                if (sources->second.empty()) in.erase(sources);
+                --edges;
+                return true;
+            }
+
+            /** @brief Appends the edges to list, unsorted. */
+            void append_to(id_edge_list<weight_type>& list) const {
+                for (auto const &row: out) {
+                    for (auto const &edge: row.second) list.emplace_back(std::make_pair(row.first, edge.first), edge.second);
+                }
+            }
+        };
+
+        /** @brief Sorts an id_edge_list by source and then target. */
+        template<typename weight_type>
+        void sort_edges(id_edge_list<weight_type>& list) {
+            std::sort(list.begin(), list.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        }
+
+        /** @brief A compacted base snapshot and its incoming rows, as produced by a compaction. */
+        template<typename csr_type>
+        struct compacted_base {
+            std::shared_ptr<const csr_type> base;
+            in_edge_rows in;
+        };
+    }
+
+    /**
+     * @ingroup Frozen
+     * @brief CsrGraph with cheap inserts and deletions, merged into a new base in batches
+     *
+     * @details
+     * The base is an immutable CsrGraph. Erasing an edge finds it in its sorted row and sets its bit in a tombstone
+     * array; nothing is moved, and every read skips the tombstones. Erasing a node tombstones its outgoing edges
+     * and, through an index of incoming edges, the edges that end in it. Inserted edges go to a delta of hash maps
+     * per source, and inserted nodes get the next ids after the base; reads merge the delta with the base, so a
+     * node's edges still come out in target id order. Node ids never change: an erased node stays in the base as
+     * an empty row that contains() reports as gone, until insert_node revives it with the same id. snapshot()
+     * leaves the erased nodes out. The writes take keys; their _by_id forms take ids, so an integer key is never
+     * read as an id.
+     *
+     * Once the tombstones pass DeltaOptions::compact_ratio of the base edges, or the delta passes
+     * DeltaOptions::merge_ratio, a merge builds a new base with the delta and without the tombstones. In the
+     * background mode it runs on its own thread from copies of the tombstones and the delta, while reads and
+     * writes continue: new inserts go to a fresh delta, and erases of edges the merge copies are also written to a
+     * log. The next write, wait() or compact() after the merge finishes installs the new base and replays the log
+     * onto it. A merge that fails leaves the graph as it was before the merge; the error is kept, no merge starts
+     * until wait() or compact() rethrows it, and a write never throws it.
+     *
+     * As with CsrGraph, reads may run concurrently with each other, but not with a write or merge call on the same
+     * object; the background thread only touches its own copies.
+     *
+     * @tparam key_type - type of the key of the node
+     * @tparam value_type - type of the value of the node
+     * @tparam weight_type - type of the weight of the edge
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    class DeltaCsrGraph {
+    public:
+        using base_type = CsrGraph<key_type, value_type, weight_type>;
+
+        /** @brief Takes over a snapshot as the base. */
+        explicit DeltaCsrGraph(base_type base, const DeltaOptions& options = {});
+        DeltaCsrGraph(DeltaCsrGraph&&) = default;
+        DeltaCsrGraph& operator=(DeltaCsrGraph&&) = default;
+        DeltaCsrGraph(const DeltaCsrGraph&) = delete;
+        DeltaCsrGraph& operator=(const DeltaCsrGraph&) = delete;
+
+        size_t size() const noexcept { return m_base->size() + m_nodes.size(); } /**< @brief Counts the ids, erased nodes included. */
+        size_t node_count() const noexcept { return m_live_nodes; } /**< @brief Counts the nodes that were not erased. */
+        /** @brief Counts the edges that were not erased. */
+        size_t edge_count() const noexcept { return m_base->edge_count() - m_tombstones + m_delta.edges + m_merging.edges; }
+        size_t tombstones() const noexcept { return m_tombstones; } /**< @brief Counts the erased edges still stored in the base. */
+        size_t delta_edges() const noexcept { return m_delta.edges + m_merging.edges; } /**< @brief Counts the inserted edges not in the base yet. */
+        size_t delta_nodes() const noexcept { return m_nodes.size(); } /**< @brief Counts the inserted nodes not in the base yet. */
+        bool contains(vertex_id id) const noexcept { return id < size() && !m_erased[id]; } /**< @brief Checks if the node with the given id exists. */
+        bool compacting() const noexcept { return m_pending.valid(); } /**< @brief Checks if a background merge is running. */
+        const base_type& base() const noexcept { return *m_base; } /**< @brief Returns the current base, tombstoned edges included. */
+
+        vertex_id id_of(const key_type& key) const;
+        /** @brief Returns the key of the node with the given id. */
+        const key_type& key_of(vertex_id id) const noexcept { return id < m_base->size() ? m_base->key_of(id) : m_nodes[id - m_base->size()].first; }
+        size_t degree_out_by_id(vertex_id id) const noexcept { return m_degree[id]; } /**< @brief Counts the edges of the node that were not erased. */
+        bool has_edge(vertex_id source, vertex_id target) const noexcept;
+        /** @brief Calls visit(target, weight) for every edge of the node that was not erased, in target id order. */
+        template<typename function_type>
+        void for_each_edge(vertex_id source, function_type&& visit) const;
+        /**
+         * @brief Returns a snapshot of the nodes and edges that were not erased, inserts included; the base is not modified.
+         * @details The ids are the ones of this graph if no node is erased; otherwise the remaining nodes are
+         * renumbered in id order, and id_of on the snapshot maps keys to its ids.
+         */
+        base_type snapshot() const;
+
+        std::pair<vertex_id, bool> insert_node(key_type key, value_type value = {});
+        bool insert_edge_by_id(vertex_id source, vertex_id target, weight_type weight = {});
+        bool insert_edge(const key_type& source, const key_type& target, weight_type weight = {});
+        bool erase_edge_by_id(vertex_id source, vertex_id target);
+        bool erase_edge(const key_type& source, const key_type& target);
+        bool erase_node_by_id(vertex_id id);
+        bool erase_node(const key_type& key);
+
+        /** @brief Waits for a background merge, then merges the remaining tombstones and inserts on this thread. */
+        void compact();
+        /** @brief Waits for a background merge, if one is running, and installs its result; rethrows the error of a failed merge. */
+        void wait();
+    private:
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        vertex_id find_id(const key_type& key) const noexcept;
+        size_t find_edge(vertex_id source, vertex_id target) const noexcept;
+        void tombstone(size_t position, vertex_id source, vertex_id target);
+        bool erase_inserted(vertex_id source, vertex_id target);
+        void after_write();
+        detail::id_edge_list<weight_type> inserted_edges() const;
+        base_type merged() const;
+        void merge_now();
+        void finish();
+        void install(detail::compacted_base<base_type>&& result, size_t nodes, size_t values);
+
+        std::shared_ptr<const base_type> m_base; /**< @brief The snapshot the tombstones refer to. */
+        detail::in_edge_rows m_in; /**< @brief The incoming edges of every node of the base. */
+        detail::bit_vector m_dead; /**< @brief One bit per edge of the base, set if the edge was erased. */
+        std::vector<std::uint8_t> m_erased; /**< @brief One flag per id, set if the node was erased. */
+        std::vector<size_t> m_degree; /**< @brief The number of edges of every node that were not erased. */
+        size_t m_tombstones = 0; /**< @brief The number of bits set in m_dead. */
+        size_t m_live_nodes = 0; /**< @brief The number of nodes that were not erased. */
+        std::vector<std::pair<key_type, value_type>> m_nodes; /**< @brief The inserted nodes, with the ids after the base. */
+        std::unordered_map<key_type, vertex_id> m_node_ids; /**< @brief Maps the keys of the inserted nodes to their ids. */
+        detail::edge_delta<weight_type> m_delta; /**< @brief The inserted edges that no merge has copied yet. */
+        detail::edge_delta<weight_type> m_merging; /**< @brief The inserted edges the running merge copies into its base. */
+        size_t m_merging_nodes = 0; /**< @brief The number of inserted nodes the running merge copies into its base. */
+        std::vector<std::pair<vertex_id, value_type>> m_values; /**< @brief The values of revived nodes, in order, not in the base yet. */
+        size_t m_merging_values = 0; /**< @brief The number of entries of m_values the running merge copies into its base. */
+        std::vector<std::pair<vertex_id, vertex_id>> m_log; /**< @brief The copied edges erased since the running merge took its copy. */
+        std::future<detail::compacted_base<base_type>> m_pending; /**< @brief The running background merge, if any. */
+        std::exception_ptr m_error; /**< @brief The error of a failed merge that wait() has not rethrown yet. */
+        DeltaOptions m_options;
+    };
+
+    template<typename key_type, typename value_type, typename weight_type>
+    DeltaCsrGraph<key_type, value_type, weight_type>::DeltaCsrGraph(base_type base, const DeltaOptions& options)
+        : m_base(std::make_shared<const base_type>(std::move(base))), m_options(options) {
+        m_in = detail::build_in_edge_rows(*m_base);
+        m_dead = detail::bit_vector(m_base->edge_count());
+        m_erased.assign(size(), 0);
+        m_degree.resize(size());
+        for (size_t id = 0; id < size(); ++id) m_degree[id] = m_base->degree_out_by_id(static_cast<vertex_id>(id));
+        m_live_nodes = size();
+    }
+
+    /** @details The id of the key in the base or among the inserted nodes, erased or not; no_vertex if there is none. */
+    template<typename key_type, typename value_type, typename weight_type>
+    vertex_id DeltaCsrGraph<key_type, value_type, weight_type>::find_id(const key_type &key) const noexcept {
+        auto found = m_base->find(key);
+        if (found != m_base->end()) return found.id();
+        auto inserted = m_node_ids.find(key);
+        return inserted == m_node_ids.end() ? no_vertex : inserted->second;
+    }
+
+    /** @throws If the key is not found or its node was erased, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    vertex_id DeltaCsrGraph<key_type, value_type, weight_type>::id_of(const key_type &key) const {
+        vertex_id id = find_id(key);
+        if (id == no_vertex || m_erased[id]) throw GraphException("Key not found");
+        return id;
+    }
+
+    /** @details Binary search in the sorted row of the source; the position of the edge in the base, or npos. */
+    template<typename key_type, typename value_type, typename weight_type>
+    size_t DeltaCsrGraph<key_type, value_type, weight_type>::find_edge(vertex_id source, vertex_id target) const noexcept {
+        if (source >= m_base->size()) return npos;
+        auto const &neighbors = m_base->neighbors();
+        auto first = neighbors.begin() + static_cast<std::ptrdiff_t>(m_base->offsets()[source]);
+        auto last = neighbors.begin() + static_cast<std::ptrdiff_t>(m_base->offsets()[source + 1]);
+        auto found = std::lower_bound(first, last, target);
+        if (found == last || *found != target) return npos;
+        return static_cast<size_t>(found - neighbors.begin());
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    bool DeltaCsrGraph<key_type, value_type, weight_type>::has_edge(vertex_id source, vertex_id target) const noexcept {
+        size_t position = find_edge(source, target);
+        if (position != npos && !m_dead.test(position)) return true;
+        return m_delta.find(source, target) != nullptr || m_merging.find(source, target) != nullptr;
+    }
+
+    /** @details Without inserted edges at the source, a scan of its base row; otherwise a merge of the row with them. */
+    template<typename key_type, typename value_type, typename weight_type>
+    template<typename function_type>
+    void DeltaCsrGraph<key_type, value_type, weight_type>::for_each_edge(vertex_id source, function_type&& visit) const {
+        auto const &offsets = m_base->offsets();
+        auto const &neighbors = m_base->neighbors();
+        auto const &weights = m_base->weights();
+        size_t edge = source < m_base->size() ? offsets[source] : 0;
+        size_t end = source < m_base->size() ? offsets[source + 1] : 0;
+        auto fresh = m_delta.out.find(source);
+        auto merging = m_merging.out.find(source);
+        if (fresh == m_delta.out.end() && merging == m_merging.out.end()) {
+            for (; edge < end; ++edge) {
+                if (!m_dead.test(edge)) visit(neighbors[edge], weights[edge]);
+            }
+            return;
+        }
+        std::vector<std::pair<vertex_id, const weight_type*>> inserted;
+        if (fresh != m_delta.out.end()) {
+            for (auto const &target: fresh->second) inserted.emplace_back(target.first, &target.second);
+        }
+        if (merging != m_merging.out.end()) {
+            for (auto const &target: merging->second) inserted.emplace_back(target.first, &target.second);
+        }
+        std::sort(inserted.begin(), inserted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        auto next = inserted.begin();
+        for (; edge < end; ++edge) {
+            if (m_dead.test(edge)) continue;
+            for (; next != inserted.end() && next->first < neighbors[edge]; ++next) visit(next->first, *next->second);
+            visit(neighbors[edge], weights[edge]);
+        }
+        for (; next != inserted.end(); ++next) visit(next->first, *next->second);
+    }
+
+    /** @details Both deltas, sorted. */
+    template<typename key_type, typename value_type, typename weight_type>
+    detail::id_edge_list<weight_type> DeltaCsrGraph<key_type, value_type, weight_type>::inserted_edges() const {
+        detail::id_edge_list<weight_type> edges;
+        edges.reserve(delta_edges());
+        m_merging.append_to(edges);
+        m_delta.append_to(edges);
+        detail::sort_edges(edges);
+        return edges;
+    }
+
+    /** @details Every id of this graph, the erased nodes as empty rows. */
+    template<typename key_type, typename value_type, typename weight_type>
+    typename DeltaCsrGraph<key_type, value_type, weight_type>::base_type DeltaCsrGraph<key_type, value_type, weight_type>::merged() const {
+        return m_base->merge([this](size_t position) { return !m_dead.test(position); }, m_nodes, inserted_edges(), m_values);
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    typename DeltaCsrGraph<key_type, value_type, weight_type>::base_type DeltaCsrGraph<key_type, value_type, weight_type>::snapshot() const {
+        auto result = merged();
+        if (m_live_nodes == size()) return result;
+        return result.filter_nodes([this](vertex_id id) { return !m_erased[id]; });
+    }
+
+    /**
+     * @details A new key gets the next id, size() before the call. The key of an erased node revives it, without
+     * edges, with its old id and the new value; the value reaches the base with the next merge.
+     * @return The id of the node with the key, and true if it was inserted or revived; false if the node exists
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    std::pair<vertex_id, bool> DeltaCsrGraph<key_type, value_type, weight_type>::insert_node(key_type key, value_type value) {
+        vertex_id id = find_id(key);
+        if (id != no_vertex) {
+            if (!m_erased[id]) return {id, false};
+            m_erased[id] = 0;
+            ++m_live_nodes;
+            m_values.emplace_back(id, std::move(value));
+            after_write();
+            return {id, true};
+        }
+        if (size() >= no_vertex) throw GraphException("Too many nodes");
+        id = static_cast<vertex_id>(size());
+        m_node_ids.emplace(key, id);
+        m_nodes.emplace_back(std::move(key), std::move(value));
+        m_erased.push_back(0);
+        m_degree.push_back(0);
+        ++m_live_nodes;
+        after_write();
+        return {id, true};
+    }
+
+    /**
+     * @details O(log degree) to check the base, O(1) to insert into the delta. An edge that was erased from the
+     * base can be inserted again, with a new weight.
+     * @return True if the edge was inserted; false if it is present
+     * @throws If a node does not exist, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    bool DeltaCsrGraph<key_type, value_type, weight_type>::insert_edge_by_id(vertex_id source, vertex_id target, weight_type weight) {
+        if (!contains(source) || !contains(target)) throw GraphException("Vertex not found");
+        if (has_edge(source, target)) return false;
+        m_delta.insert(source, target, std::move(weight));
+        ++m_degree[source];
+        after_write();
+        return true;
+    }
+
+    /** @throws If a key is not found or its node was erased, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    bool DeltaCsrGraph<key_type, value_type, weight_type>::insert_edge(const key_type &source, const key_type &target, weight_type weight) {
+        return insert_edge_by_id(id_of(source), id_of(target), std::move(weight));
+    }
+
+    /** @details Sets the tombstone and, while a background merge runs, logs the edge so it can be replayed. */
+    template<typename key_type, typename value_type, typename weight_type>
+    void DeltaCsrGraph<key_type, value_type, weight_type>::tombstone(size_t position, vertex_id source, vertex_id target) {
+        if (m_pending.valid()) m_log.emplace_back(source, target);
+        m_dead.set(position);
+        ++m_tombstones;
+        --m_degree[source];
+    }
+
+    /** @details Removes an inserted edge from the deltas; one the running merge copies is logged to be replayed. */
+    template<typename key_type, typename value_type, typename weight_type>
+    bool DeltaCsrGraph<key_type, value_type, weight_type>::erase_inserted(vertex_id source, vertex_id target) {
+        if (m_delta.erase(source, target)) {
+            --m_degree[source];
+            return true;
+        }
+        if (!m_merging.erase(source, target)) return false;
+        m_log.emplace_back(source, target);
+        --m_degree[source];
+        return true;
+    }
+
+    /**
+     * @details O(log degree) to find the edge, O(1) to remove it.
+     * @return True if an edge was removed
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    bool DeltaCsrGraph<key_type, value_type, weight_type>::erase_edge_by_id(vertex_id source, vertex_id target) {
+        if (source >= size()) return false;
+        if (!erase_inserted(source, target)) {
+            size_t position = find_edge(source, target);
+            if (position == npos || m_dead.test(position)) return false;
+            tombstone(position, source, target);
+        }
+        after_write();
+        return true;
+    }
+
+    /** @return True if an edge was removed; false if there is none, or a key is not found. */
+    template<typename key_type, typename value_type, typename weight_type>
+    bool DeltaCsrGraph<key_type, value_type, weight_type>::erase_edge(const key_type &source, const key_type &target) {
+        vertex_id first = find_id(source);
+        vertex_id second = find_id(target);
+        if (first == no_vertex || second == no_vertex) return false;
+        return erase_edge_by_id(first, second);
+    }
+
+    /**
+     * @details O(degree) for the outgoing edges, and O(log degree) per incoming edge of the base.
+     * @return True if a node was removed
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    bool DeltaCsrGraph<key_type, value_type, weight_type>::erase_node_by_id(vertex_id id) {
+        if (!contains(id)) return false;
+        std::vector<std::pair<vertex_id, vertex_id>> inserted;
+        for (auto delta: {&m_delta, &m_merging}) {
+            auto row = delta->out.find(id);
+            if (row != delta->out.end()) {
+                for (auto const &edge: row->second) inserted.emplace_back(id, edge.first);
+            }
+            auto sources = delta->in.find(id);
+            if (sources != delta->in.end()) {
+                for (auto source: sources->second) inserted.emplace_back(source, id);
+            }
+        }
+        for (auto const &edge: inserted) erase_inserted(edge.first, edge.second);
+        if (id < m_base->size()) {
+            auto const &offsets = m_base->offsets();
+            auto const &neighbors = m_base->neighbors();
+            for (size_t edge = offsets[id]; edge < offsets[id + 1]; ++edge) {
+                if (!m_dead.test(edge)) tombstone(edge, id, neighbors[edge]);
+            }
+            for (size_t edge = m_in.offsets[id]; edge < m_in.offsets[id + 1]; ++edge) {
+                vertex_id source = m_in.sources[edge];
+                size_t position = find_edge(source, id);
+                if (!m_dead.test(position)) tombstone(position, source, id);
+            }
+        }
+        m_erased[id] = 1;
+        --m_live_nodes;
+        after_write();
+        return true;
+    }
+
+    /** @return True if a node was removed; false if the key is not found or its node was already erased. */
+    template<typename key_type, typename value_type, typename weight_type>
+    bool DeltaCsrGraph<key_type, value_type, weight_type>::erase_node(const key_type &key) {
+        vertex_id id = find_id(key);
+        if (id == no_vertex) return false;
+        return erase_node_by_id(id);
+    }
+
+    /**
+     * @details Installs a finished background merge, then starts a new one if the tombstones or the delta passed
+     * their ratio. Does not block on a merge that is still running. The write has already taken effect, so a
+     * failed merge is kept for wait() instead of being thrown.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    void DeltaCsrGraph<key_type, value_type, weight_type>::after_write() {
+        if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) finish();
+        if (m_pending.valid() || m_error) return;
+        auto edges = static_cast<double>(m_base->edge_count());
+        bool compact = m_options.compact_ratio > 0 && static_cast<double>(m_tombstones) >= m_options.compact_ratio * std::max(edges, 1.0);
+        bool merge = m_options.merge_ratio > 0 && static_cast<double>(m_delta.edges + m_nodes.size() + m_values.size()) >= m_options.merge_ratio * std::max(edges, 1.0);
+        if (!compact && !merge) return;
+        try {
+            if (!m_options.background) {
+                merge_now();
+                return;
+            }
+            auto base = m_base;
+            auto dead = m_dead;
+            auto nodes = m_nodes;
+            auto values = m_values;
+            auto inserted = inserted_edges();
+            auto pending = std::async(std::launch::async, [base = std::move(base), dead = std::move(dead), nodes = std::move(nodes),
+                                                           values = std::move(values), inserted = std::move(inserted)]() mutable {
+                auto keep = [&dead](size_t position) { return !dead.test(position); };
+                auto merged = std::make_shared<const base_type>(base->merge(keep, std::move(nodes), inserted, std::move(values)));
+                auto in = detail::build_in_edge_rows(*merged);
+                return detail::compacted_base<base_type>{std::move(merged), std::move(in)};
+            });
+            m_pending = std::move(pending);
+        } catch (...) {
+            m_error = std::current_exception();
+            return;
+        }
+        m_merging = std::move(m_delta);
+        m_delta = {};
+        m_merging_nodes = m_nodes.size();
+        m_merging_values = m_values.size();
+    }
+
+    /** @details Builds the merged base on this thread and installs it with every inserted node and edge. */
+    template<typename key_type, typename value_type, typename weight_type>
+    void DeltaCsrGraph<key_type, value_type, weight_type>::merge_now() {
+        auto base = std::make_shared<const base_type>(merged());
+        auto in = detail::build_in_edge_rows(*base);
+        install({std::move(base), std::move(in)}, m_nodes.size(), m_values.size());
+        m_delta = {};
+    }
+
+    /**
+     * @details Swaps in the merged base, which holds the first nodes inserted nodes, the first values entries of
+     * m_values and all edges of m_merging, and replays onto it the copied edges erased while it was built.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    void DeltaCsrGraph<key_type, value_type, weight_type>::install(detail::compacted_base<base_type>&& result, size_t nodes, size_t values) {
+        detail::bit_vector dead(result.base->edge_count());
+        m_base = std::move(result.base);
+        m_in = std::move(result.in);
+        m_dead = std::move(dead);
+        m_tombstones = 0;
+        for (auto const &edge: m_log) {
+            m_dead.set(find_edge(edge.first, edge.second));
+            ++m_tombstones;
+        }
+        m_log.clear();
+        for (size_t node = 0; node < nodes; ++node) m_node_ids.erase(m_nodes[node].first);
+        m_nodes.erase(m_nodes.begin(), m_nodes.begin() + static_cast<std::ptrdiff_t>(nodes));
+        m_values.erase(m_values.begin(), m_values.begin() + static_cast<std::ptrdiff_t>(values));
+        m_merging = {};
+        m_merging_nodes = 0;
+        m_merging_values = 0;
+    }
+
+    /**
+     * @details Blocks until the background merge is done. If it failed, the old base stays, already carrying every
+     * tombstone, the copied edges go back to the delta, and the exception is kept for wait().
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    void DeltaCsrGraph<key_type, value_type, weight_type>::finish() {
+        auto pending = std::move(m_pending);
+        detail::compacted_base<base_type> result;
+        try {
+            result = pending.get();
+        } catch (...) {
+            for (auto const &row: m_merging.out) {
+                for (auto const &edge: row.second) m_delta.insert(row.first, edge.first, edge.second);
+            }
+            m_merging = {};
+            m_merging_nodes = 0;
+            m_merging_values = 0;
+            m_log.clear();
+            m_error = std::current_exception();
+            return;
+        }
+        install(std::move(result), m_merging_nodes, m_merging_values);
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    void DeltaCsrGraph<key_type, value_type, weight_type>::wait() {
+        if (m_pending.valid()) finish();
+        if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    void DeltaCsrGraph<key_type, value_type, weight_type>::compact() {
+        wait();
+        if (m_tombstones > 0 || m_delta.edges > 0 || !m_nodes.empty() || !m_values.empty()) merge_now();
+    }
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "ShortestPaths.h"
+
+namespace graph {
+    /** @defgroup Flows Flows and cuts */
+
+    /**
+     * @ingroup Flows
+     * @brief Result of a maximum flow search, between interned ids
+     */
+    template<typename capacity_type>
+    struct FlowResult {
+        capacity_type value{}; /**< @brief The value of the maximum flow. */
+        detail::id_edge_list<capacity_type> flows; /**< @brief The edges that carry flow and their flow, in the order of the graph's edges. */
+        std::vector<std::uint8_t> source_side; /**< @brief One flag per node, set on the source side of a minimum cut. */
+        std::vector<std::pair<vertex_id, vertex_id>> cut; /**< @brief The edges of the minimum cut; all saturated, their capacities add up to value. */
+    };
+
+    namespace detail {
+        /**
+         * @brief The residual network of a flow problem, as a CSR of arcs
+         *
+         * @details Every edge u -> v becomes an arc u -> v with its capacity and a paired arc v -> u with none;
+         * pushing along an arc moves residual capacity to its pair. Arcs of both kinds share the rows of their
+         * tail, so one scan sees every way out of a node.
+         */
+        template<typename capacity_type>
+        struct residual_network {
+            std::vector<size_t> offsets; /**< @brief The arcs of node u occupy [offsets[u], offsets[u + 1]). */
+            std::vector<vertex_id> heads; /**< @brief The node every arc points to. */
+            std::vector<size_t> pairs; /**< @brief The reverse arc of every arc. */
+            std::vector<capacity_type> residual; /**< @brief The capacity left on every arc. */
+            std::vector<size_t> arc_of; /**< @brief The forward arc of every edge, or npos for self-loops and empty edges. */
+        };
+
+        template<typename capacity_type>
+        residual_network<capacity_type> build_residual(size_t size, const id_edge_list<capacity_type>& edges) {
+            constexpr size_t npos = static_cast<size_t>(-1);
+            residual_network<capacity_type> network;
+            network.offsets.assign(size + 1, 0);
+            for (auto const &edge: edges) {
+                check_weight(edge.second);
+                if (edge.first.first == edge.first.second || !(capacity_type{} < edge.second)) continue;
+                ++network.offsets[edge.first.first + 1];
+                ++network.offsets[edge.first.second + 1];
+            }
+            for (size_t node = 0; node < size; ++node) network.offsets[node + 1] += network.offsets[node];
+            size_t arcs = network.offsets[size];
+            network.heads.resize(arcs);
+            network.pairs.resize(arcs);
+            network.residual.assign(arcs, capacity_type{});
+            network.arc_of.assign(edges.size(), npos);
+            std::vector<size_t> next(network.offsets.begin(), network.offsets.end() - 1);
+            for (size_t index = 0; index < edges.size(); ++index) {
+                auto [source, target] = edges[index].first;
+                if (source == target || !(capacity_type{} < edges[index].second)) continue;
+                size_t forward = next[source]++;
+                size_t backward = next[target]++;
+                network.heads[forward] = target;
+                network.heads[backward] = source;
+                network.pairs[forward] = backward;
+                network.pairs[backward] = forward;
+                network.residual[forward] = edges[index].second;
+                network.arc_of[index] = forward;
+            }
+            return network;
+        }
+
+        /**
+         * @brief Highest-label push-relabel over a residual network
+         *
+         * @details
+         * run(target, other) moves every excess it can to target: the active node with the highest label pushes
+         * along admissible arcs, which lead one label down, and is relabeled when it has none left. Nodes whose
+         * label reaches size() cannot reach target and are set aside.
+         *
+         * Two heuristics keep the labels close to the true distances. The global relabel sets every label to the
+         * BFS distance to target in the residual network, at the start and again after about 6 * size + arcs / 2
+         * units of relabel work. The gap heuristic notices a label that no node has any more: nodes above it can no
+         * longer reach target, and are set aside at once. For that, the nodes below size() are kept in one
+         * doubly-linked list per label, next to the stacks of active nodes.
+         */
+        template<typename capacity_type>
+        class push_relabel {
+        public:
+            explicit push_relabel(residual_network<capacity_type>& network)
+                : m_network(network), m_size(network.offsets.size() - 1), m_label(m_size), m_excess(m_size, capacity_type{}),
+                  m_current(m_size), m_active(m_size + 1, no_vertex), m_next_active(m_size), m_nodes(m_size + 1, no_vertex),
+                  m_next(m_size), m_previous(m_size) {}
+
+            const std::vector<capacity_type>& excess() const noexcept { return m_excess; }
+
+            /** @brief Saturates every arc out of source. */
+            void saturate(vertex_id source) {
+                for (size_t arc = m_network.offsets[source]; arc < m_network.offsets[source + 1]; ++arc) {
+                    capacity_type amount = m_network.residual[arc];
+                    if (!(capacity_type{} < amount)) continue;
+                    m_network.residual[arc] = capacity_type{};
+                    m_network.residual[m_network.pairs[arc]] += amount;
+                    m_excess[m_network.heads[arc]] += amount;
+                    m_excess[source] -= amount;
+                }
+            }
+
+            /** @brief Pushes all excess that can reach target to it; other keeps its excess and takes none. */
+            void run(vertex_id target, vertex_id other) {
+                m_target = target;
+                m_other = other;
+                global_relabel();
+                for (;;) {
+                    while (m_highest > 0 && m_active[m_highest] == no_vertex) --m_highest;
+                    vertex_id node = m_active[m_highest];
+                    if (node == no_vertex) break;
+                    m_active[m_highest] = m_next_active[node];
+                    discharge(node);
+                    if (m_work > 6 * m_size + m_network.heads.size() / 2) global_relabel();
+                }
+            }
+        private:
+            void link(vertex_id node) {
+                size_t label = m_label[node];
+                m_previous[node] = no_vertex;
+                m_next[node] = m_nodes[label];
+                if (m_nodes[label] != no_vertex) m_previous[m_nodes[label]] = node;
+                m_nodes[label] = node;
+                m_top = std::max(m_top, label);
+            }
+
+            void unlink(vertex_id node) {
+                if (m_previous[node] != no_vertex) m_next[m_previous[node]] = m_next[node];
+                else m_nodes[m_label[node]] = m_next[node];
+                if (m_next[node] != no_vertex) m_previous[m_next[node]] = m_previous[node];
+            }
+
+            void activate(vertex_id node) {
+                size_t label = m_label[node];
+                m_next_active[node] = m_active[label];
+                m_active[label] = node;
+                m_highest = std::max(m_highest, label);
+            }
+
+            /** @details Breadth-first search backwards from target over the arcs with capacity left. */
+            void global_relabel() {
+                m_work = 0;
+                std::fill(m_label.begin(), m_label.end(), m_size);
+                std::fill(m_active.begin(), m_active.end(), no_vertex);
+                std::fill(m_nodes.begin(), m_nodes.end(), no_vertex);
+                m_highest = m_top = 0;
+                m_label[m_target] = 0;
+                m_queue.assign(1, m_target);
+                for (size_t head = 0; head < m_queue.size(); ++head) {
+                    vertex_id node = m_queue[head];
+                    for (size_t arc = m_network.offsets[node]; arc < m_network.offsets[node + 1]; ++arc) {
+                        vertex_id tail = m_network.heads[arc];
+                        if (m_label[tail] != m_size || tail == m_other || !(capacity_type{} < m_network.residual[m_network.pairs[arc]])) continue;
+                        m_label[tail] = m_label[node] + 1;
+                        m_queue.push_back(tail);
+                    }
+                }
+                for (size_t index = 1; index < m_queue.size(); ++index) {
+                    vertex_id node = m_queue[index];
+                    m_current[node] = m_network.offsets[node];
+                    link(node);
+                    if (capacity_type{} < m_excess[node]) activate(node);
+                }
+            }
+
+            void discharge(vertex_id node) {
+                size_t end = m_network.offsets[node + 1];
+                while (capacity_type{} < m_excess[node]) {
+                    size_t &arc = m_current[node];
+                    if (arc == end) {
+                        relabel(node);
+                        if (m_label[node] >= m_size) return;
+                        continue;
+                    }
+                    vertex_id head = m_network.heads[arc];
+                    if (!(capacity_type{} < m_network.residual[arc]) || m_label[node] != m_label[head] + 1) {
+                        ++arc;
+                        continue;
+                    }
+                    capacity_type amount = std::min(m_excess[node], m_network.residual[arc]);
+                    m_network.residual[arc] -= amount;
+                    m_network.residual[m_network.pairs[arc]] += amount;
+                    m_excess[node] -= amount;
+                    if (head != m_target && !(capacity_type{} < m_excess[head])) activate(head);
+                    m_excess[head] += amount;
+                }
+            }
+
+            /** @details Moves the node one above its lowest neighbor with capacity left, or applies the gap heuristic. */
+            void relabel(vertex_id node) {
+                size_t old = m_label[node];
+                unlink(node);
+                size_t first = m_network.offsets[node];
+                size_t last = m_network.offsets[node + 1];
+                m_work += last - first + 12;
+                if (m_nodes[old] == no_vertex) {
+                    for (size_t label = old + 1; label <= m_top; ++label) {
+                        for (vertex_id member = m_nodes[label]; member != no_vertex; member = m_next[member]) m_label[member] = m_size;
+                        m_nodes[label] = no_vertex;
+                    }
+                    m_top = old - 1;
+                    m_label[node] = m_size;
+                    return;
+                }
+                size_t lowest = m_size;
+                size_t choice = first;
+                for (size_t arc = first; arc < last; ++arc) {
+                    if (!(capacity_type{} < m_network.residual[arc])) continue;
+                    size_t label = m_label[m_network.heads[arc]] + 1;
+                    if (label < lowest) {
+                        lowest = label;
+                        choice = arc;
+                    }
+                }
+                m_label[node] = lowest;
+                m_current[node] = choice;
+                if (lowest < m_size) link(node);
+            }
+
+            residual_network<capacity_type>& m_network;
+            size_t m_size;
+            std::vector<size_t> m_label; /**< @brief The label of every node; size() for nodes set aside. */
+            std::vector<capacity_type> m_excess; /**< @brief The flow into every node minus the flow out of it. */
+            std::vector<size_t> m_current; /**< @brief The next arc every node tries to push along. */
+            std::vector<vertex_id> m_active; /**< @brief The top of the stack of active nodes of every label. */
+            std::vector<vertex_id> m_next_active; /**< @brief The link of every node in its stack of active nodes. */
+            std::vector<vertex_id> m_nodes; /**< @brief The first node of the list of every label. */
+            std::vector<vertex_id> m_next; /**< @brief The next node in the list of the label. */
+            std::vector<vertex_id> m_previous; /**< @brief The previous node in the list of the label. */
+            std::vector<vertex_id> m_queue; /**< @brief The queue of the global relabel. */
+            size_t m_highest = 0; /**< @brief No stack of active nodes above this label is used. */
+            size_t m_top = 0; /**< @brief No list above this label is used. */
+            size_t m_work = 0; /**< @brief The relabel work since the last global relabel. */
+            vertex_id m_target = 0;
+            vertex_id m_other = 0;
+        };
+
+        /**
+         * @brief Maximum flow over nodes [0, size) in two push-relabel phases
+         *
+         * @details The first phase pushes everything it can to sink, which gives the value. The second returns the
+         * excess that sink could not take to source, which turns the preflow into a flow. The minimum cut is the set
+         * of nodes source still reaches through arcs with capacity left.
+         */
+        template<typename capacity_type>
+        FlowResult<capacity_type> max_flow(size_t size, const id_edge_list<capacity_type>& edges, vertex_id source, vertex_id sink) {
+            if (source >= size || sink >= size) throw GraphException("Vertex not found");
+            if (source == sink) throw GraphException("Source is the sink");
+            auto network = build_residual(size, edges);
+            push_relabel<capacity_type> solver(network);
+            solver.saturate(source);
+            solver.run(sink, source);
+            solver.run(source, sink);
+
+            FlowResult<capacity_type> result;
+            result.value = solver.excess()[sink];
+            for (size_t index = 0; index < edges.size(); ++index) {
+                size_t arc = network.arc_of[index];
+                if (arc == static_cast<size_t>(-1)) continue;
+                capacity_type flow = edges[index].second - network.residual[arc];
+                if (capacity_type{} < flow) result.flows.emplace_back(edges[index].first, flow);
+            }
+            result.source_side.assign(size, 0);
+            result.source_side[source] = 1;
+            std::vector<vertex_id> queue{source};
+            for (size_t head = 0; head < queue.size(); ++head) {
+                vertex_id node = queue[head];
+                for (size_t arc = network.offsets[node]; arc < network.offsets[node + 1]; ++arc) {
+                    vertex_id next = network.heads[arc];
+                    if (result.source_side[next] || !(capacity_type{} < network.residual[arc])) continue;
+                    result.source_side[next] = 1;
+                    queue.push_back(next);
+                }
+            }
+            for (size_t index = 0; index < edges.size(); ++index) {
+                auto [tail, head] = edges[index].first;
+                if (network.arc_of[index] != static_cast<size_t>(-1) && result.source_side[tail] && !result.source_side[head]) result.cut.emplace_back(tail, head);
+            }
+            return result;
+        }
+    }
+
+    /**
+     * @ingroup Flows
+     * @brief Maximum flow and minimum cut from source to sink, with the edge weights as capacities
+     *
+     * @details Highest-label push-relabel with the global relabel and gap heuristics; O(size^2 sqrt(edges)) in the
+     * worst case, and usually close to linear. Capacities must be finite; self-loops and edges of capacity zero are
+     * ignored. For integer capacities the flow is integral.
+     *
+     * @throws If an id is out of range, source is sink, or a capacity is negative, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    FlowResult<weight_type> max_flow(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id source, vertex_id sink) {
+        auto const &offsets = graph.offsets();
+        detail::id_edge_list<weight_type> edges;
+        edges.reserve(graph.edge_count());
+        for (size_t node = 0; node < graph.size(); ++node) {
+            for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) {
+                edges.emplace_back(std::make_pair(static_cast<vertex_id>(node), graph.neighbors()[edge]), graph.weights()[edge]);
+            }
+        }
+        return detail::max_flow(graph.size(), edges, source, sink);
+    }
+
+    /**
+     * @ingroup Flows
+     * @brief Maximum flow and minimum cut between the nodes with the given keys; the result is between interned ids
+     * @throws If a key is not found, source is sink, or a capacity is negative, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    FlowResult<weight_type> max_flow(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, const key_type& source, const key_type& sink) {
+        detail::id_edge_list<weight_type> edges;
+        edges.reserve(graph.edge_count());
+        auto for_each_edge = detail::graph_weighted_neighbors(graph);
+        for (size_t node = 0; node < graph.size(); ++node) {
+            for_each_edge(static_cast<vertex_id>(node), [&](vertex_id target, const weight_type& weight) {
+                edges.emplace_back(std::make_pair(static_cast<vertex_id>(node), target), weight);
+            });
+        }
+        return detail::max_flow(graph.size(), edges, graph.id_of(source), graph.id_of(sink));
+    }
+}
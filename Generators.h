@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Storage.h"
+
+namespace graph {
+    /**
+     * @defgroup Generators Generators
+     *
+     * @brief Seeded synthetic graphs
+     *
+     * @details
+     * Every generator returns a list of ((source, target), weight) pairs over the keys [0, nodes), ready for
+     * Graph::insert_edges. The output depends only on the arguments: numbers come straight from std::mt19937_64,
+     * whose sequence is fixed by the standard, instead of from the implementation-defined std distributions.
+     * Weights are integers in [1, 100] converted to weight_type; with graph::empty weights the number is still
+     * drawn, so the edges are the same for every weight_type. With no nodes there are no edges to draw, and the
+     * list is empty.
+     */
+
+    /** @ingroup Generators @brief A generated edge list. */
+    template<typename key_type, typename weight_type>
+    using EdgeList = std::vector<std::pair<std::pair<key_type, key_type>, weight_type>>;
+
+    namespace detail {
+        /** @brief Draws the weight of a generated edge, an integer in [1, 100]. */
+        template<typename weight_type>
+        weight_type random_weight(std::mt19937_64& random) {
+            auto draw = random() % 100 + 1;
+            if constexpr (std::is_same_v<weight_type, empty>) return {};
+            else return static_cast<weight_type>(draw);
+        }
+    }
+
+    /**
+     * @ingroup Generators
+     * @brief Erdős–Rényi G(n, m) graph: every edge joins two nodes chosen uniformly at random
+     */
+    template<typename key_type = std::uint32_t, typename weight_type = double>
+    EdgeList<key_type, weight_type> erdos_renyi(size_t nodes, size_t edges, std::uint64_t seed = 1) {
+        if (nodes == 0) return {};
+        std::mt19937_64 random(seed);
+        EdgeList<key_type, weight_type> result;
+        result.reserve(edges);
+        for (size_t edge = 0; edge < edges; ++edge) {
+            auto source = static_cast<key_type>(random() % nodes);
+            auto target = static_cast<key_type>(random() % nodes);
+            result.push_back({{source, target}, detail::random_weight<weight_type>(random)});
+        }
+        return result;
+    }
+
+    /**
+     * @ingroup Generators
+     * @brief R-MAT (Kronecker) graph with a power-law degree distribution
+     *
+     * @details Every edge picks one quadrant of the adjacency matrix per bit of the node ids, with probabilities
+     * a, b, c and 1 - a - b - c. The defaults are the Graph500 parameters. The number of nodes is rounded up to a
+     * power of two.
+     */
+    template<typename key_type = std::uint32_t, typename weight_type = double>
+    EdgeList<key_type, weight_type> rmat(size_t nodes, size_t edges, std::uint64_t seed = 1,
+                                         double a = 0.57, double b = 0.19, double c = 0.19) {
+        if (nodes == 0) return {};
+        std::mt19937_64 random(seed);
+        unsigned scale = 0;
+        while ((size_t{1} << scale) < nodes) ++scale;
+        auto uniform = [&random]() { return static_cast<double>(random() >> 11) * (1.0 / 9007199254740992.0); };
+
+        EdgeList<key_type, weight_type> result;
+        result.reserve(edges);
+        for (size_t edge = 0; edge < edges; ++edge) {
+            std::uint64_t source = 0;
+            std::uint64_t target = 0;
+            for (unsigned bit = 0; bit < scale; ++bit) {
+                double draw = uniform();
+                source <<= 1;
+                target <<= 1;
+                if (draw < a) continue;
+                if (draw < a + b) target |= 1;
+                else if (draw < a + b + c) source |= 1;
+                else {
+                    source |= 1;
+                    target |= 1;
+                }
+            }
+            result.push_back({{static_cast<key_type>(source), static_cast<key_type>(target)}, detail::random_weight<weight_type>(random)});
+        }
+        return result;
+    }
+
+    /**
+     * @ingroup Generators
+     * @brief Two-dimensional grid of rows x columns nodes, with edges in both directions between 4-neighbors
+     */
+    template<typename key_type = std::uint32_t, typename weight_type = double>
+    EdgeList<key_type, weight_type> grid(size_t rows, size_t columns, std::uint64_t seed = 1) {
+        if (rows == 0 || columns == 0) return {};
+        std::mt19937_64 random(seed);
+        EdgeList<key_type, weight_type> result;
+        result.reserve(4 * rows * columns);
+        auto add = [&](size_t source, size_t target) {
+            auto weight = detail::random_weight<weight_type>(random);
+            result.push_back({{static_cast<key_type>(source), static_cast<key_type>(target)}, weight});
+            result.push_back({{static_cast<key_type>(target), static_cast<key_type>(source)}, weight});
+        };
+        for (size_t row = 0; row < rows; ++row) {
+            for (size_t column = 0; column < columns; ++column) {
+                size_t node = row * columns + column;
+                if (column + 1 < columns) add(node, node + 1);
+                if (row + 1 < rows) add(node, node + columns);
+            }
+        }
+        return result;
+    }
+}
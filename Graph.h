@@ -1,5 +1,18 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
-#include <unordered_map>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Storage.h"
 
 /** @brief Graph namespace */
 namespace graph {
@@ -20,37 +33,270 @@ namespace graph {
         const char* m_message;
     };
 
+    /** @brief Dense integer id of a node, assigned when the node is inserted. */
+    using vertex_id = std::uint32_t;
+    /** @brief Marks the absence of a vertex, for example the parent of a node that was not reached. */
+    constexpr vertex_id no_vertex = std::numeric_limits<vertex_id>::max();
+
+    /** @brief Implementation details, not part of the public interface. */
+    namespace detail {
+        /**
+         * @brief Incoming-edge index of a node
+         *
+         * @details Stores the keys of the nodes that have an edge ending in this node. Specialized to an empty type
+         * when the index is disabled, so a Node pays nothing for it. The allocator_arg_t constructors build the index
+         * with the allocator of the node.
+         */
+        template<typename key_set, bool enabled>
+        struct in_edge_index {
+            in_edge_index() = default;
+            template<typename allocator_type>
+            in_edge_index(std::allocator_arg_t, const allocator_type&) noexcept {}
+            template<typename allocator_type>
+            in_edge_index(std::allocator_arg_t, const allocator_type&, const in_edge_index&) noexcept {}
+        };
+
+        template<typename key_set>
+        struct in_edge_index<key_set, true> {
+            in_edge_index() = default;
+            template<typename allocator_type>
+            in_edge_index(std::allocator_arg_t, const allocator_type& allocator) : m_in_edge(allocator) {}
+            template<typename allocator_type>
+            in_edge_index(std::allocator_arg_t, const allocator_type& allocator, const in_edge_index& other) : m_in_edge(other.m_in_edge, allocator) {}
+            template<typename allocator_type>
+            in_edge_index(std::allocator_arg_t, const allocator_type& allocator, in_edge_index&& other) : m_in_edge(std::move(other.m_in_edge), allocator) {}
+
+            key_set m_in_edge; /**< @brief The keys of the nodes with an edge into this node. */
+        };
+
+        /**
+         * @brief Counters that a Graph keeps up to date as it is modified
+         *
+         * @details The maxima only grow on insertion; removing edges marks them stale, and they are recomputed by
+         * the next query that needs them.
+         */
+        struct graph_counters {
+            size_t edges = 0; /**< @brief The number of edges. */
+            size_t loops = 0; /**< @brief The number of self-loops. */
+            size_t max_out = 0; /**< @brief The largest out-degree, or an upper bound of it if stale. */
+            size_t max_in = 0; /**< @brief The largest in-degree, or an upper bound of it if stale. Needs the reverse index. */
+            bool max_stale = false; /**< @brief Whether the maxima must be recomputed. */
+            std::uint64_t epoch = 0; /**< @brief Incremented by every change of the nodes or edges. */
+        };
+    }
+
+    /**
+     * @ingroup Graph
+     * @brief Operation counts of a graph, as returned by Graph::operations
+     * @details All zero unless the storage policy is an instrumented_storage. They count what this graph object
+     * did; a copy or a moved-to graph starts from zero.
+     */
+    struct OperationStats {
+        std::uint64_t node_lookups = 0; /**< @brief Lookups of a node by key: find, at, operator[] and the queries built on them. */
+        std::uint64_t edge_lookups = 0; /**< @brief Lookups of an edge in the edge map of its source: has_edge and edge_weight. */
+        std::uint64_t node_inserts = 0; /**< @brief Nodes inserted. */
+        std::uint64_t edge_inserts = 0; /**< @brief Edges inserted. */
+        std::uint64_t node_erases = 0; /**< @brief Nodes erased. */
+        std::uint64_t edge_erases = 0; /**< @brief Edges erased, by erase_edge or with their node. */
+        std::uint64_t node_rehashes = 0; /**< @brief Insertions that made the node map rehash or grow. */
+        std::uint64_t edge_rehashes = 0; /**< @brief Insertions of edges that made the edge map of the source rehash or grow. */
+    };
+
+    namespace detail {
+        /** @brief The number of lookups the batched queries of Graph keep in flight at a time. */
+        constexpr size_t batch_width = 16;
+
+        /**
+         * @brief The counters behind Graph::operations; empty, and every call a no-op, unless enabled
+         * @details slots(table) returns the size of a table before an insertion, so that the insertion can be
+         * recorded as a rehash if it changed. Disabled, it returns 0 without looking at the table.
+         */
+        template<bool enabled>
+        struct operation_counters {
+            template<typename table>
+            size_t slots(const table&) const noexcept { return 0; }
+            void node_lookup(std::uint64_t = 1) const noexcept {}
+            void edge_lookup(std::uint64_t = 1) const noexcept {}
+            template<typename table>
+            void node_insert(bool, size_t, const table&) noexcept {}
+            template<typename table>
+            void edge_insert(bool, size_t, const table&) noexcept {}
+            void node_erase(size_t) noexcept {}
+            void edge_erase(size_t) noexcept {}
+            OperationStats read() const noexcept { return {}; }
+        };
+
+        template<>
+        struct operation_counters<true> {
+            operation_counters() = default;
+            operation_counters(const operation_counters&) noexcept {}
+            operation_counters& operator=(const operation_counters&) noexcept { return *this; }
+
+            template<typename table>
+            size_t slots(const table& container) const noexcept { return table_slots(container); }
+            void node_lookup(std::uint64_t count = 1) const noexcept { add(m_node_lookups, count); }
+            void edge_lookup(std::uint64_t count = 1) const noexcept { add(m_edge_lookups, count); }
+            template<typename table>
+            void node_insert(bool inserted, size_t slots, const table& container) noexcept {
+                if (inserted) add(m_node_inserts, 1);
+                if (table_slots(container) != slots) add(m_node_rehashes, 1);
+            }
+            template<typename table>
+            void edge_insert(bool inserted, size_t slots, const table& container) noexcept {
+                if (inserted) add(m_edge_inserts, 1);
+                if (table_slots(container) != slots) add(m_edge_rehashes, 1);
+            }
+            void node_erase(size_t edges) noexcept { add(m_node_erases, 1); add(m_edge_erases, edges); }
+            void edge_erase(size_t edges) noexcept { add(m_edge_erases, edges); }
+            OperationStats read() const noexcept {
+                return {get(m_node_lookups), get(m_edge_lookups), get(m_node_inserts), get(m_edge_inserts),
+                        get(m_node_erases), get(m_edge_erases), get(m_node_rehashes), get(m_edge_rehashes)};
+            }
+        private:
+            static void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept { counter.fetch_add(value, std::memory_order_relaxed); }
+            static std::uint64_t get(const std::atomic<std::uint64_t>& counter) noexcept { return counter.load(std::memory_order_relaxed); }
+
+            mutable std::atomic<std::uint64_t> m_node_lookups{0};
+            mutable std::atomic<std::uint64_t> m_edge_lookups{0};
+            std::atomic<std::uint64_t> m_node_inserts{0};
+            std::atomic<std::uint64_t> m_edge_inserts{0};
+            std::atomic<std::uint64_t> m_node_erases{0};
+            std::atomic<std::uint64_t> m_edge_erases{0};
+            std::atomic<std::uint64_t> m_node_rehashes{0};
+            std::atomic<std::uint64_t> m_edge_rehashes{0};
+        };
+    }
+
     /** @defgroup Graph Graph */
 
+    /**
+     * @ingroup Graph
+     * @brief Outcome of a bulk insertion
+     *
+     * @details Bulk insertion does not throw on a bad entry; it skips it and records its position instead.
+     */
+    struct BulkInsertResult {
+        size_t inserted = 0; /**< @brief The number of entries that were inserted. */
+        std::vector<size_t> failed; /**< @brief The positions in the input of the entries whose endpoints were not found. */
+    };
+
+    /**
+     * @ingroup Graph
+     * @brief Summary of a graph, as returned by Graph::stats
+     */
+    struct GraphStats {
+        size_t nodes = 0; /**< @brief The number of nodes. */
+        size_t edges = 0; /**< @brief The number of edges. */
+        size_t self_loops = 0; /**< @brief The number of edges that start and end in the same node. */
+        size_t max_degree_out = 0; /**< @brief The largest out-degree of a node. */
+        size_t max_degree_in = 0; /**< @brief The largest in-degree of a node; zero if the graph has no reverse index. */
+        std::uint64_t epoch = 0; /**< @brief The epoch of the graph when the summary was taken. */
+    };
+
+    /**
+     * @ingroup Graph
+     * @brief Degree distribution of a graph, as returned by Graph::degree_histogram
+     *
+     * @details out[d] and in[d] are the numbers of nodes with out-degree and in-degree d. Both vectors end at
+     * the largest degree, so they are empty only for an empty graph.
+     */
+    struct DegreeHistogram {
+        std::vector<size_t> out; /**< @brief The number of nodes of every out-degree. */
+        std::vector<size_t> in; /**< @brief The number of nodes of every in-degree. */
+        std::uint64_t epoch = 0; /**< @brief The epoch of the graph the histogram was computed at. */
+    };
+
+    /**
+     * @ingroup Graph
+     * @brief Bytes held by the parts of a graph, as returned by Graph::memory_usage
+     * @details Estimated from the sizes and capacities of the containers (see detail::table_bytes); memory that
+     * keys, values and weights allocate themselves, such as long strings, is not included. For the exact heap
+     * usage, build the graph on a counting_resource (see Instrumentation.h).
+     */
+    struct MemoryUsage {
+        size_t nodes = 0; /**< @brief The node map, including the Node objects but not their edge maps. */
+        size_t edges = 0; /**< @brief The edge maps of all nodes. */
+        size_t reverse_index = 0; /**< @brief The reverse indices of all nodes. */
+        size_t keys = 0; /**< @brief The key table indexed by id. */
+
+        size_t total() const noexcept { return nodes + edges + reverse_index + keys; } /**< @brief Sums all parts. */
+    };
+
+    /**
+     * @ingroup Graph
+     * @brief Occupancy of the hash tables of a graph, as returned by Graph::table_stats
+     * @details The probe histograms are as in detail::add_probe_lengths: probes[i] counts the entries a lookup
+     * finds with i + 1 probes. A long tail in edge_probes points to skewed buckets in the edge maps.
+     */
+    struct TableStats {
+        size_t node_slots = 0; /**< @brief Buckets or slots of the node map. */
+        double node_load_factor = 0; /**< @brief Nodes per slot of the node map. */
+        size_t edge_slots = 0; /**< @brief Buckets or slots of all edge maps. */
+        double edge_load_factor = 0; /**< @brief Edges per slot, over all edge maps. */
+        size_t max_edge_slots = 0; /**< @brief Buckets or slots of the largest edge map. */
+        std::vector<size_t> node_probes; /**< @brief Probe lengths of the nodes in the node map. */
+        std::vector<size_t> edge_probes; /**< @brief Probe lengths of the edges in the edge maps of their sources. */
+    };
+
     /**
      * @ingroup Graph
      * @brief Graph class
      *
      * @details
      * A class that represents a graph. Contains a map of nodes, each of which contains a map of edges.
+     * Every node is also interned: it gets a vertex_id in [0, size()) when it is inserted, so algorithms can keep
+     * their per-node state in plain vectors indexed by id. Erasing a node keeps the ids dense: the node with the
+     * largest id takes over the id of the erased one.
+     *
+     * The graph keeps its edge count, self-loop count and maximum degrees up to date as it is modified, so
+     * stats() is O(1) in the common case. Every change of the nodes or edges increments epoch(); the degree
+     * histogram is computed on demand and cached until the epoch changes. Edges changed through a Node directly
+     * (Node::insert_edge, getedges) bypass these counters, as they bypass the reverse index. The cached queries
+     * (max_degree_out, max_degree_in, stats and degree_histogram) may update the cache, so unlike the other const
+     * members they must not run concurrently with each other.
      *
      * @tparam key_type - type of the key of the node
-     * @tparam value_type - type of the value of the node
-     * @tparam weight_type - type of the weight of the edge
+     * @tparam value_type - type of the value of the node; graph::empty for nodes without values
+     * @tparam weight_type - type of the weight of the edge; graph::empty for unweighted graphs, whose flat and
+     * sorted vector edge maps store only the neighbor keys
+     * @tparam reverse_index - if true, every node keeps an index of its incoming edges, which makes degree_in O(1)
+     * and enables in_edges
+     * @tparam storage - storage policy that chooses the containers for nodes, edges and the reverse index, and
+     * optionally their allocator (see @ref Storage)
      */
-    template<typename key_type, typename value_type, typename weight_type>
-    class Graph {
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index = true, typename storage = hash_storage>
+    class Graph : private detail::operation_counters<detail::storage_instrumented<storage>::value> {
     public:
         class Node;
 
-        using const_iterator = typename std::unordered_map<key_type, Node>::const_iterator;
-        using iterator = typename std::unordered_map<key_type, Node>::iterator;
+        using node_map = typename storage::template node_map<key_type, Node>; /**< @brief The container of the nodes. */
+        using edge_map = typename storage::template edge_map<key_type, weight_type>; /**< @brief The container of the edges of a node. */
+        using key_set = typename storage::template key_set<key_type>; /**< @brief The container of the reverse index of a node. */
+        using allocator_type = typename detail::storage_allocator<storage>::type; /**< @brief The allocator of the storage policy. */
+        using key_vector = std::vector<key_type, detail::rebind_alloc<allocator_type, key_type>>; /**< @brief The keys of all nodes, indexed by id. */
+
+        using const_iterator = typename node_map::const_iterator;
+        using iterator = typename node_map::iterator;
+
+        static constexpr bool instrumented = detail::storage_instrumented<storage>::value; /**< @brief Whether operations() counts anything. */
 
         Graph() = default;
-        Graph(const Graph& graph) noexcept;
+        /** @brief Creates an empty graph whose nodes, edges and reverse index allocate from the given allocator. */
+        explicit Graph(const allocator_type& allocator) : m_umap(allocator), m_keys(allocator) {}
+        Graph(const Graph& graph);
+        /** @brief Copies the graph into storage from the given allocator. */
+        Graph(const Graph& graph, const allocator_type& allocator)
+            : operation_base(), m_umap(graph.m_umap, allocator), m_keys(graph.m_keys, allocator), m_counters(graph.m_counters) {}
         Graph(Graph&& graph) noexcept;
 
-        Graph& operator=(const Graph& graph) noexcept;
-        Graph& operator=(Graph&& graph) noexcept ;
+        Graph& operator=(const Graph& graph);
+        Graph& operator=(Graph&& graph) noexcept(std::is_nothrow_move_assignable_v<node_map>);
 
-        bool empty() noexcept { return m_umap.empty(); } /**< @brief Checks  if the graph is empty. */
-        size_t size() noexcept { return m_umap.size(); } /**< @brief Counts the number of nodes in the graph. */
-        void clear() noexcept { return m_umap.clear(); } /**< @brief Removes all nodes from the graph. */
+        bool empty() const noexcept { return m_umap.empty(); } /**< @brief Checks  if the graph is empty. */
+        size_t size() const noexcept { return m_umap.size(); } /**< @brief Counts the number of nodes in the graph. */
+        void clear() noexcept; /**< @brief Removes all nodes from the graph. */
+        void reserve(size_t nodes) { m_umap.reserve(nodes); m_keys.reserve(nodes); } /**< @brief Reserves space for the given number of nodes. */
+        allocator_type get_allocator() const noexcept { return allocator_type(m_umap.get_allocator()); } /**< @brief Returns the allocator of the graph. */
 
         const_iterator cbegin() const noexcept { return m_umap.cbegin(); }
         const_iterator cend() const noexcept { return m_umap.cend(); }
@@ -59,36 +305,111 @@ namespace graph {
         const_iterator begin() const noexcept { return m_umap.cbegin(); }
         const_iterator end() const noexcept { return m_umap.cend(); }
 
-        Node& operator[](const key_type& key) { return m_umap.operator[](key); }
+        Node& operator[](const key_type& key);
         const Node& operator[](const key_type& key) const { return m_umap.operator[](key); }
         Node& at(const key_type& key);
         const Node& at(const key_type& key) const;
 
-        iterator find(const key_type& key) { return m_umap.find(key); } /**< @brief Finds a node with the given key. */
-        const_iterator find(const key_type& key) const { return m_umap.find(key); }
+        iterator find(const key_type& key) { operation_log().node_lookup(); return m_umap.find(key); } /**< @brief Finds a node with the given key. */
+        const_iterator find(const key_type& key) const { operation_log().node_lookup(); return m_umap.find(key); }
+
+        vertex_id id_of(const key_type& key) const { return at(key).id(); } /**< @brief Returns the id of the node with the given key. */
+        const key_type& key_of(vertex_id id) const noexcept { return m_keys[id]; } /**< @brief Returns the key of the node with the given id. */
+        const key_vector& keys() const noexcept { return m_keys; } /**< @brief Returns the keys of all nodes, indexed by id. */
 
-        size_t degree_in(const key_type& key); /**< @brief Counts the number of edges that end in the node with the given key. */
-        size_t degree_out(const key_type& key); /**< @brief Counts the number of edges that start in the node with the given key. */
-        bool loop(const key_type& key); /**< @brief Checks if the node with the given key has a loop. */
+        size_t degree_in(const key_type& key) const; /**< @brief Counts the number of edges that end in the node with the given key. */
+        /** @brief Returns the keys of the nodes that have an edge ending in the node with the given key. */
+        const key_set& in_edges(const key_type& key) const;
+        size_t degree_out(const key_type& key) const { return at(key).size(); } /**< @brief Counts the number of edges that start in the node with the given key. */
+        bool loop(const key_type& key) const { return has_edge(key, key); } /**< @brief Checks if the node with the given key has a loop. */
+        /** @brief Checks if there is an edge from source to target. */
+        bool has_edge(const key_type& source, const key_type& target) const;
+        /** @brief Returns the weight of the edge from source to target. */
+        const weight_type& edge_weight(const key_type& source, const key_type& target) const;
+        /**
+         * @brief Finds the nodes with the given keys, many lookups in flight at a time; null for missing keys.
+         * @details Prefetching pays most with flat_storage. With the default hash_storage a batch is at best about
+         * 1.1x faster than a loop of find, and only once the nodes no longer fit in the cache.
+         */
+        template<typename range_type>
+        std::vector<const Node*> find_batch(const range_type& keys) const;
+        /** @brief Checks for every (source, target) pair of the range if there is an edge from source to target; gains as find_batch. */
+        template<typename range_type>
+        std::vector<bool> has_edge_batch(const range_type& edges) const;
+        /** @brief Counts the outgoing edges of the nodes with the given keys. */
+        template<typename range_type>
+        std::vector<size_t> degree_out_batch(const range_type& keys) const;
 
+        size_t edge_count() const noexcept { return m_counters.edges; } /**< @brief Counts the number of edges, in O(1). */
+        size_t self_loops() const noexcept { return m_counters.loops; } /**< @brief Counts the edges that start and end in the same node, in O(1). */
+        /** @brief Returns the largest out-degree of a node. */
+        size_t max_degree_out() const;
+        /** @brief Returns the largest in-degree of a node. Requires the reverse index. */
+        size_t max_degree_in() const;
+        /** @brief Returns a counter that changes whenever a node or edge is inserted or removed. */
+        std::uint64_t epoch() const noexcept { return m_counters.epoch; }
+        /** @brief Returns the number of nodes and edges, the self-loop count and the maximum degrees. */
+        GraphStats stats() const;
+        /** @brief Returns the out-degree and in-degree distributions, recomputed only if the graph has changed. */
+        const DegreeHistogram& degree_histogram() const;
+        /** @brief Returns the counts of lookups, insertions, erasures and rehashes; all zero unless instrumented. */
+        OperationStats operations() const noexcept { return operation_log().read(); }
+        /** @brief Estimates the bytes held by the nodes, the edges, the reverse index and the key table, in O(size()). */
+        MemoryUsage memory_usage() const;
+        /** @brief Returns the load factors and probe length histograms of the node map and the edge maps, in O(size() + edges). */
+        TableStats table_stats() const;
 
         /** @brief Inserts a node with the given key and value. */
-        std::pair<iterator, bool> insert_node(const key_type& key, const value_type& value) { return m_umap.insert({key, Node{value}}); }
+        std::pair<iterator, bool> insert_node(const key_type& key, const value_type& value) { return emplace_node(key, value); }
+        std::pair<iterator, bool> insert_node(const key_type& key, value_type&& value) { return emplace_node(key, std::move(value)); }
+        std::pair<iterator, bool> insert_node(key_type&& key, value_type&& value) { return emplace_node(std::move(key), std::move(value)); }
+        /** @brief Inserts a node whose value is constructed in place from args, if the key is not present. */
+        template<typename... Args>
+        std::pair<iterator, bool> emplace_node(const key_type& key, Args&&... args) { return try_emplace_node(key, std::forward<Args>(args)...); }
+        template<typename... Args>
+        std::pair<iterator, bool> emplace_node(key_type&& key, Args&&... args) { return try_emplace_node(std::move(key), std::forward<Args>(args)...); }
         /** @brief Inserts or assigns a node with the given key and value. */
-        std::pair<iterator, bool> insert_or_assign_node(key_type key, value_type value) { return m_umap.insert_or_assign(key, Node{value}); }
+        std::pair<iterator, bool> insert_or_assign_node(key_type key, value_type value);
         /** @brief Inserts an edge. */
         std::pair<typename Node::iterator, bool> insert_edge(std::pair<key_type, key_type> end_points, weight_type weight);
+        /** @brief Inserts an edge whose weight is constructed in place from args, if the edge is not present. */
+        template<typename... Args>
+        std::pair<typename Node::iterator, bool> emplace_edge(std::pair<key_type, key_type> end_points, Args&&... args);
         /** @brief Inserts or assigns an edge. */
         std::pair<typename Node::iterator, bool> insert_or_assign_edge(std::pair<key_type, key_type> end_points, weight_type weight);
+        /** @brief Inserts a range of (key, value) pairs. */
+        template<typename range_type>
+        size_t insert_nodes(const range_type& nodes);
+        /** @brief Inserts a range of ((source, target), weight) pairs. */
+        template<typename range_type>
+        BulkInsertResult insert_edges(const range_type& edges);
+        /** @brief Removes the edge from source to target, if there is one. */
+        bool erase_edge(const key_type& source, const key_type& target);
+        /** @brief Removes the node with the given key and every edge that starts or ends in it, if there is one. */
+        bool erase_node(const key_type& key);
 
-        void swap(Graph& graph) noexcept { m_umap.swap(graph.m_umap); } /**< @brief Swaps the contents of the graph. */
+        /** @brief Swaps the contents of the graph; as with the standard containers, the allocators must be equal. */
+        void swap(Graph& graph) noexcept;
     private:
-        std::unordered_map<key_type, Node> m_umap; /**< @brief The unordered map that stores the nodes of the graph. */
+        template<typename key_arg, typename... Args>
+        std::pair<iterator, bool> try_emplace_node(key_arg&& key, Args&&... args);
+        void intern(iterator node);
+        void count_edge(const Node& source, const Node& target) noexcept;
+        void refresh_max_degrees() const;
+        /** @brief The operation counters; a base rather than a member, so that they take no space when disabled. */
+        using operation_base = detail::operation_counters<detail::storage_instrumented<storage>::value>;
+        operation_base& operation_log() noexcept { return *this; }
+        const operation_base& operation_log() const noexcept { return *this; }
+
+        node_map m_umap; /**< @brief The map that stores the nodes of the graph. */
+        key_vector m_keys; /**< @brief The key of every node, indexed by its id. */
+        mutable detail::graph_counters m_counters; /**< @brief Mutable so that const queries can refresh stale maxima. */
+        mutable DegreeHistogram m_histogram; /**< @brief Cached degree_histogram(); valid if non-empty and of the current epoch. */
     };
 
     /** @brief Swaps the contents of the graph. */
-    template<typename key_type, typename value_type, typename weight_type>
-    void swap(Graph<key_type, value_type, weight_type> graph1, Graph<key_type, value_type, weight_type> graph2) {
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    void swap(Graph<key_type, value_type, weight_type, reverse_index, storage>& graph1, Graph<key_type, value_type, weight_type, reverse_index, storage>& graph2) noexcept {
         graph1.swap(graph2);
     }
 
@@ -96,25 +417,50 @@ namespace graph {
      * @ingroup Graph
      * @brief Node class
      *
-     * @details Node class is a template class that represents a node in a graph. Uses an unordered map to store the edges.
+     * @details Node class is a template class that represents a node in a graph. Uses the edge_map of the storage
+     * policy (an unordered map by default) to store the edges.
+     * If the graph keeps a reverse index, the node also stores the keys of the nodes whose edges end in it.
+     *
+     * Nodes are allocator-aware: the allocator-extended constructors build the edge map and the reverse index with
+     * the given allocator, so a node map with a std::pmr allocator hands it down to every node it constructs.
      *
      * @tparam key_type
      * @tparam value_type
      * @tparam weight_type
      */
-    template<typename key_type, typename value_type, typename weight_type>
-    class Graph<key_type, value_type, weight_type>::Node {
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    class Graph<key_type, value_type, weight_type, reverse_index, storage>::Node : private detail::in_edge_index<key_set, reverse_index> {
+        friend class Graph;
     public:
+        using allocator_type = typename Graph::allocator_type;
+
         Node() = default;
-        explicit Node(value_type value) : m_value(value) {};
+        explicit Node(value_type value) : m_value(std::move(value)) {};
+        explicit Node(const allocator_type& allocator) : in_index(std::allocator_arg, allocator), m_value(), m_edge(allocator) {}
+        Node(value_type value, const allocator_type& allocator) : in_index(std::allocator_arg, allocator), m_value(std::move(value)), m_edge(allocator) {}
+        /** @brief Constructs the value of the node from args. */
+        template<typename... Args>
+        explicit Node(std::in_place_t, Args&&... args) : m_value(std::forward<Args>(args)...) {}
+        template<typename... Args>
+        Node(std::allocator_arg_t, const allocator_type& allocator, std::in_place_t, Args&&... args)
+            : in_index(std::allocator_arg, allocator), m_value(std::forward<Args>(args)...), m_edge(allocator) {}
+        Node(const Node& node) = default;
+        Node(Node&& node) = default;
+        Node(const Node& node, const allocator_type& allocator)
+            : in_index(std::allocator_arg, allocator, node), m_value(node.m_value), m_id(node.m_id), m_edge(node.m_edge, allocator) {}
+        Node(Node&& node, const allocator_type& allocator)
+            : in_index(std::allocator_arg, allocator, std::move(node)), m_value(std::move(node.m_value)), m_id(node.m_id), m_edge(std::move(node.m_edge), allocator) {}
+        Node& operator=(const Node& node) = default;
+        Node& operator=(Node&& node) = default;
 
-        using const_iterator = typename std::unordered_map<key_type, weight_type>::const_iterator;
-        using iterator = typename std::unordered_map<key_type, weight_type>::iterator;
+        using const_iterator = typename edge_map::const_iterator;
+        using iterator = typename edge_map::iterator;
 
-        bool empty() noexcept { return m_edge.empty(); } /**< @brief Returns true if the node has no edges, false otherwise. */
-        size_t size() noexcept { return m_edge.size(); } /**< @brief Returns the number of edges in the node. */
+        bool empty() const noexcept { return m_edge.empty(); } /**< @brief Returns true if the node has no edges, false otherwise. */
+        size_t size() const noexcept { return m_edge.size(); } /**< @brief Returns the number of edges in the node. */
         value_type& value() noexcept { return m_value; } /**< @brief Returns the value of the node. */
         void clear() noexcept { m_edge.clear(); } /**< @brief Removes all edges from the node. */
+        void reserve_edges(size_t edges) { m_edge.reserve(edges); } /**< @brief Reserves space for the given number of edges. */
 
         const_iterator cbegin() const noexcept { return m_edge.begin(); }
         const_iterator cend() const noexcept { return m_edge.cend(); }
@@ -123,93 +469,452 @@ namespace graph {
         const_iterator begin() const noexcept { return m_edge.begin(); }
         const_iterator end() const noexcept { return m_edge.cend(); }
 
-        std::unordered_map<key_type, weight_type> &getedges() noexcept { return m_edge; }
-        /** @brief Returns an unordered map of edges */
-        const std::unordered_map<key_type, weight_type> &getedges() const noexcept { return m_edge; }
+        edge_map &getedges() noexcept { return m_edge; }
+        /** @brief Returns the map of edges */
+        const edge_map &getedges() const noexcept { return m_edge; }
         value_type &getvalue() noexcept { return m_value; } /**< @brief Returns the value of the node. */
         const value_type &getvalue() const noexcept { return m_value; }
+        vertex_id id() const noexcept { return m_id; } /**< @brief Returns the interned id of the node. */
+
+        /** @brief Returns the number of edges that end in the node. Requires the reverse index. */
+        size_t in_size() const noexcept;
+        /** @brief Returns the keys of the nodes that have an edge ending in the node. Requires the reverse index. */
+        const key_set &in_edges() const noexcept;
 
-        /** @brief Returns the weight of the edge with the given key. */
-        std::pair<Node::iterator, bool> insert_edge(key_type key, weight_type weight);
-        /** @brief Returns or assigns the weight of the edge with the given key. */
-        std::pair<Node::iterator, bool> insert_or_assign_edge(key_type key, weight_type weight);
+        /**
+         * @brief Inserts an edge to the node with the given key, if there is none yet.
+         * @note Does not update the reverse index of the target node or the counters of the graph; use
+         * Graph::insert_edge to keep them consistent.
+         */
+        std::pair<Node::iterator, bool> insert_edge(key_type key, weight_type weight) { return emplace_edge(std::move(key), std::move(weight)); }
+        /** @brief Inserts an edge whose weight is constructed in place from args, if there is none yet. See the note on insert_edge. */
+        template<typename... Args>
+        std::pair<Node::iterator, bool> emplace_edge(const key_type& key, Args&&... args) { return m_edge.try_emplace(key, std::forward<Args>(args)...); }
+        template<typename... Args>
+        std::pair<Node::iterator, bool> emplace_edge(key_type&& key, Args&&... args) { return m_edge.try_emplace(std::move(key), std::forward<Args>(args)...); }
+        /** @brief Inserts an edge or assigns its weight. See the note on insert_edge. */
+        std::pair<Node::iterator, bool> insert_or_assign_edge(key_type key, weight_type weight) { return m_edge.insert_or_assign(std::move(key), std::move(weight)); }
     private:
+        using in_index = detail::in_edge_index<key_set, reverse_index>;
+
         value_type m_value; /**< @brief The value of the node. */
-        std::unordered_map<key_type, weight_type> m_edge; /**< @brief The unordered map that stores the edges of the node. */
+        vertex_id m_id = 0; /**< @brief The interned id of the node, assigned by the graph. */
+        edge_map m_edge; /**< @brief The map that stores the edges of the node. */
     };
 
-    template<typename key_type, typename value_type, typename weight_type>
-    Graph<key_type, value_type, weight_type>::Graph(const Graph& graph) noexcept {
-        m_umap = graph.m_umap;
-    }
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::Graph(const Graph& graph)
+        : operation_base(), m_umap(graph.m_umap), m_keys(graph.m_keys), m_counters(graph.m_counters) {}
 
-    template<typename key_type, typename value_type, typename weight_type>
-    Graph<key_type, value_type, weight_type>::Graph(Graph<key_type, value_type, weight_type>&& graph) noexcept {
-        swap(graph);
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::Graph(Graph<key_type, value_type, weight_type, reverse_index, storage>&& graph) noexcept
+        : m_umap(std::move(graph.m_umap)), m_keys(std::move(graph.m_keys)), m_counters(graph.m_counters), m_histogram(std::move(graph.m_histogram)) {
+        graph.clear();
     }
 
-    template<typename key_type, typename value_type, typename weight_type>
-    Graph<key_type, value_type, weight_type>& Graph<key_type, value_type, weight_type>::operator=(const Graph& graph) noexcept {
-        m_umap = graph.m_umap;
+    /**
+     * @details Copies every node and edge, so this allocates. The key table is copied first; if copying the nodes
+     * throws, the graph is left empty.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>& Graph<key_type, value_type, weight_type, reverse_index, storage>::operator=(const Graph& graph) {
+        if (this == &graph) return *this;
+        key_vector keys(graph.m_keys, m_keys.get_allocator());
+        try {
+            m_umap = graph.m_umap;
+        } catch (...) {
+            clear();
+            throw;
+        }
+        m_keys.swap(keys);
+        m_counters = graph.m_counters;
+        m_histogram.out.clear();
         return *this;
     }
 
-    template<typename key_type, typename value_type, typename weight_type>
-    Graph<key_type, value_type, weight_type> &Graph<key_type, value_type, weight_type>::operator=(Graph&& graph) noexcept {
-        swap(graph);
+    /**
+     * @details Moves the nodes as the node map does: with a std::pmr allocator that differs from the other graph's,
+     * every node is moved into this graph's storage, which allocates.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    Graph<key_type, value_type, weight_type, reverse_index, storage> &Graph<key_type, value_type, weight_type, reverse_index, storage>::operator=(Graph&& graph)
+        noexcept(std::is_nothrow_move_assignable_v<node_map>) {
+        if (this == &graph) return *this;
+        m_umap = std::move(graph.m_umap);
+        m_keys = std::move(graph.m_keys);
+        m_counters = graph.m_counters;
+        m_histogram = std::move(graph.m_histogram);
+        graph.clear();
         return *this;
     }
 
-    template<typename key_type, typename value_type, typename weight_type>
-    typename Graph<key_type, value_type, weight_type>::Node& Graph<key_type, value_type, weight_type>::at(const key_type &key) {
+    /** @details Resets the counters and starts a new epoch. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    void Graph<key_type, value_type, weight_type, reverse_index, storage>::clear() noexcept {
+        m_umap.clear();
+        m_keys.clear();
+        m_counters = {0, 0, 0, 0, false, m_counters.epoch + 1};
+    }
+
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    void Graph<key_type, value_type, weight_type, reverse_index, storage>::swap(Graph& graph) noexcept {
+        m_umap.swap(graph.m_umap);
+        m_keys.swap(graph.m_keys);
+        std::swap(m_counters, graph.m_counters);
+        m_histogram.out.swap(graph.m_histogram.out);
+        m_histogram.in.swap(graph.m_histogram.in);
+        std::swap(m_histogram.epoch, graph.m_histogram.epoch);
+    }
+
+    /** @details Inserts a node with a default value if the key is not present. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    typename Graph<key_type, value_type, weight_type, reverse_index, storage>::Node& Graph<key_type, value_type, weight_type, reverse_index, storage>::operator[](const key_type &key) {
+        operation_log().node_lookup();
+        auto find = m_umap.find(key);
+        if (find != m_umap.end()) return find->second;
+        return insert_node(key, value_type{}).first->second;
+    }
+
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    typename Graph<key_type, value_type, weight_type, reverse_index, storage>::Node& Graph<key_type, value_type, weight_type, reverse_index, storage>::at(const key_type &key) {
+        operation_log().node_lookup();
         auto find = m_umap.find(key);
         if (find == m_umap.end()) throw GraphException("Key not found");
         return find->second;
     }
 
-    template<typename key_type, typename value_type, typename weight_type>
-    const typename Graph<key_type, value_type, weight_type>::Node& Graph<key_type, value_type, weight_type>::at(const key_type& key) const {
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    const typename Graph<key_type, value_type, weight_type, reverse_index, storage>::Node& Graph<key_type, value_type, weight_type, reverse_index, storage>::at(const key_type& key) const {
+        operation_log().node_lookup();
         auto find = m_umap.find(key);
         if (find == m_umap.end()) throw GraphException("Key not found");
         return find->second;
     }
 
+    /**
+     * @details With the reverse index this is a single lookup; without it every node's edges are scanned.
+     * @throws If the key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    size_t Graph<key_type, value_type, weight_type, reverse_index, storage>::degree_in(const key_type &key) const {
+        if constexpr (reverse_index) {
+            return at(key).in_size();
+        } else {
+            if (m_umap.find(key) == m_umap.end()) throw GraphException("Key not found");
+            size_t counter = 0;
+            for (auto const &elem: m_umap) {
+                auto const &edges = elem.second.getedges();
+                if (edges.find(key) != edges.end()) counter++;
+            }
+            return counter;
+        }
+    }
+
     /** @throws If the key is not found, throws GraphException. */
-    template<typename key_type, typename value_type, typename weight_type>
-    size_t Graph<key_type, value_type, weight_type>::degree_in(const key_type &key) {
-        if (m_umap.find(key) == m_umap.end()) throw GraphException("Key not found");
-        size_t counter = 0;
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    const typename Graph<key_type, value_type, weight_type, reverse_index, storage>::key_set&
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::in_edges(const key_type &key) const {
+        static_assert(reverse_index, "in_edges requires a Graph with reverse_index enabled");
+        return at(key).in_edges();
+    }
+
+    /**
+     * @details A single lookup of each key; does not allocate.
+     * @throws If the source key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    bool Graph<key_type, value_type, weight_type, reverse_index, storage>::has_edge(const key_type &source, const key_type &target) const {
+        auto const &edges = at(source).m_edge;
+        operation_log().edge_lookup();
+        return edges.find(target) != edges.end();
+    }
+
+    /**
+     * @details A single lookup of each key; does not allocate unless it throws.
+     * @throws If the source key is not found or there is no such edge, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    const weight_type& Graph<key_type, value_type, weight_type, reverse_index, storage>::edge_weight(const key_type &source, const key_type &target) const {
+        auto const &edges = at(source).m_edge;
+        operation_log().edge_lookup();
+        auto find = edges.find(target);
+        if (find == edges.end()) throw GraphException("Edge not found");
+        return find->second;
+    }
+
+    /**
+     * @details
+     * Looks the keys up in groups of detail::batch_width: first every key of a group is prefetched, then every key
+     * is found. Each lookup is a cache miss that does not depend on the others, so the misses of a group overlap
+     * instead of being paid one after another. See detail::prefetch_lookup for what each storage prefetches.
+     *
+     * @param[in] keys A forward range of keys, or of values convertible to keys
+     * @return For every key, in order, a pointer to its node, or null if it is not found. The pointers are
+     * invalidated as references to nodes are.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    template<typename range_type>
+    std::vector<const typename Graph<key_type, value_type, weight_type, reverse_index, storage>::Node*>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::find_batch(const range_type &keys) const {
+        auto count = static_cast<size_t>(std::distance(std::begin(keys), std::end(keys)));
+        std::vector<const Node*> result(count, nullptr);
+        decltype(std::begin(keys)) group[detail::batch_width];
+        auto key = std::begin(keys);
+        for (size_t first = 0; first < count; first += detail::batch_width) {
+            size_t size = std::min(detail::batch_width, count - first);
+            for (size_t i = 0; i < size; ++i, ++key) {
+                group[i] = key;
+                detail::prefetch_lookup(m_umap, static_cast<const key_type&>(*key));
+            }
+            for (size_t i = 0; i < size; ++i) {
+                auto find = m_umap.find(static_cast<const key_type&>(*group[i]));
+                if (find != m_umap.end()) result[first + i] = &find->second;
+            }
+        }
+        operation_log().node_lookup(count);
+        return result;
+    }
+
+    /**
+     * @details As find_batch, with a second stage per group: once the sources of a group are found, the lookups
+     * of the targets in their edge maps are prefetched before any of them is made.
+     * @param[in] edges A forward range of (source, target) pairs or tuples of keys, or of values convertible to keys
+     * @throws If a source key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    template<typename range_type>
+    std::vector<bool> Graph<key_type, value_type, weight_type, reverse_index, storage>::has_edge_batch(const range_type &edges) const {
+        auto count = static_cast<size_t>(std::distance(std::begin(edges), std::end(edges)));
+        std::vector<bool> result(count, false);
+        decltype(std::begin(edges)) group[detail::batch_width];
+        const Node* sources[detail::batch_width];
+        auto edge = std::begin(edges);
+        for (size_t first = 0; first < count; first += detail::batch_width) {
+            size_t size = std::min(detail::batch_width, count - first);
+            for (size_t i = 0; i < size; ++i, ++edge) {
+                group[i] = edge;
+                detail::prefetch_lookup(m_umap, static_cast<const key_type&>(std::get<0>(*edge)));
+            }
+            for (size_t i = 0; i < size; ++i) {
+                auto find = m_umap.find(static_cast<const key_type&>(std::get<0>(*group[i])));
+                if (find == m_umap.end()) throw GraphException("Key not found");
+                sources[i] = &find->second;
+                detail::prefetch_lookup(sources[i]->m_edge, static_cast<const key_type&>(std::get<1>(*group[i])));
+            }
+            for (size_t i = 0; i < size; ++i) {
+                auto const &targets = sources[i]->m_edge;
+                result[first + i] = targets.find(static_cast<const key_type&>(std::get<1>(*group[i]))) != targets.end();
+            }
+        }
+        operation_log().node_lookup(count);
+        operation_log().edge_lookup(count);
+        return result;
+    }
+
+    /**
+     * @details As find_batch.
+     * @throws If a key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    template<typename range_type>
+    std::vector<size_t> Graph<key_type, value_type, weight_type, reverse_index, storage>::degree_out_batch(const range_type &keys) const {
+        auto nodes = find_batch(keys);
+        std::vector<size_t> result(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i] == nullptr) throw GraphException("Key not found");
+            result[i] = nodes[i]->size();
+        }
+        return result;
+    }
+
+    /** @details O(1), unless edges were removed since the last query; then every node is scanned once. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    size_t Graph<key_type, value_type, weight_type, reverse_index, storage>::max_degree_out() const {
+        refresh_max_degrees();
+        return m_counters.max_out;
+    }
+
+    /** @details O(1), unless edges were removed since the last query; then every node is scanned once. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    size_t Graph<key_type, value_type, weight_type, reverse_index, storage>::max_degree_in() const {
+        static_assert(reverse_index, "max_degree_in requires a Graph with reverse_index enabled");
+        refresh_max_degrees();
+        return m_counters.max_in;
+    }
+
+    /** @details Costs the same as max_degree_out. Without the reverse index, max_degree_in is reported as zero. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    GraphStats Graph<key_type, value_type, weight_type, reverse_index, storage>::stats() const {
+        refresh_max_degrees();
+        return {size(), m_counters.edges, m_counters.loops, m_counters.max_out, reverse_index ? m_counters.max_in : 0, m_counters.epoch};
+    }
+
+    /**
+     * @details Returns the cached histogram if the epoch has not changed since it was computed. Otherwise scans
+     * every node; without the reverse index the in-degrees are counted from the edges, one lookup per edge.
+     * The reference stays valid until the next call.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    const DegreeHistogram& Graph<key_type, value_type, weight_type, reverse_index, storage>::degree_histogram() const {
+        if (!m_histogram.out.empty() && m_histogram.epoch == m_counters.epoch) return m_histogram;
+        refresh_max_degrees();
+        m_histogram.out.assign(empty() ? 0 : m_counters.max_out + 1, 0);
+        if constexpr (reverse_index) {
+            m_histogram.in.assign(empty() ? 0 : m_counters.max_in + 1, 0);
+            for (auto const &elem: m_umap) {
+                ++m_histogram.out[elem.second.size()];
+                ++m_histogram.in[elem.second.in_size()];
+            }
+        } else {
+            std::vector<size_t> in_degree(m_keys.size(), 0);
+            for (auto const &elem: m_umap) {
+                ++m_histogram.out[elem.second.size()];
+                for (auto const &edge: elem.second.m_edge) ++in_degree[m_umap.find(edge.first)->second.m_id];
+            }
+            m_histogram.in.clear();
+            for (size_t degree: in_degree) {
+                if (degree >= m_histogram.in.size()) m_histogram.in.resize(degree + 1, 0);
+                ++m_histogram.in[degree];
+            }
+        }
+        m_histogram.epoch = m_counters.epoch;
+        return m_histogram;
+    }
+
+    /** @details Scans the node map once; see MemoryUsage for what is counted. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    MemoryUsage Graph<key_type, value_type, weight_type, reverse_index, storage>::memory_usage() const {
+        MemoryUsage usage;
+        usage.nodes = detail::table_bytes(m_umap);
+        usage.keys = m_keys.capacity() * sizeof(key_type);
         for (auto const &elem: m_umap) {
-            auto edges = elem.second.getedges();
-            if (edges.find(key) != edges.end()) counter++;
+            usage.edges += detail::table_bytes(elem.second.m_edge);
+            if constexpr (reverse_index) usage.reverse_index += detail::table_bytes(elem.second.m_in_edge);
         }
-        return counter;
+        return usage;
     }
 
-    template<typename key_type, typename value_type, typename weight_type>
-    size_t Graph<key_type, value_type, weight_type>::degree_out(const key_type &key) {
-        if (m_umap.find(key) == m_umap.end()) throw GraphException("Key not found");
-        return (m_umap.find(key))->second.getedges().size();
+    /** @details Walks every bucket or slot of the node map and of every edge map. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    TableStats Graph<key_type, value_type, weight_type, reverse_index, storage>::table_stats() const {
+        TableStats stats;
+        stats.node_slots = detail::table_slots(m_umap);
+        if (stats.node_slots != 0) stats.node_load_factor = static_cast<double>(size()) / static_cast<double>(stats.node_slots);
+        detail::add_probe_lengths(m_umap, stats.node_probes);
+        size_t edges = 0;
+        for (auto const &elem: m_umap) {
+            size_t slots = detail::table_slots(elem.second.m_edge);
+            stats.edge_slots += slots;
+            stats.max_edge_slots = std::max(stats.max_edge_slots, slots);
+            edges += elem.second.m_edge.size();
+            detail::add_probe_lengths(elem.second.m_edge, stats.edge_probes);
+        }
+        if (stats.edge_slots != 0) stats.edge_load_factor = static_cast<double>(edges) / static_cast<double>(stats.edge_slots);
+        return stats;
+    }
+
+    /** @details Counts an edge that was just inserted, after the reverse index was updated. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    void Graph<key_type, value_type, weight_type, reverse_index, storage>::count_edge(const Node& source, const Node& target) noexcept {
+        ++m_counters.edges;
+        if (&source == &target) ++m_counters.loops;
+        if (source.size() > m_counters.max_out) m_counters.max_out = source.size();
+        if constexpr (reverse_index) {
+            if (target.in_size() > m_counters.max_in) m_counters.max_in = target.in_size();
+        }
+        ++m_counters.epoch;
+    }
+
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    void Graph<key_type, value_type, weight_type, reverse_index, storage>::refresh_max_degrees() const {
+        if (!m_counters.max_stale) return;
+        m_counters.max_out = 0;
+        m_counters.max_in = 0;
+        for (auto const &elem: m_umap) {
+            if (elem.second.size() > m_counters.max_out) m_counters.max_out = elem.second.size();
+            if constexpr (reverse_index) {
+                if (elem.second.in_size() > m_counters.max_in) m_counters.max_in = elem.second.in_size();
+            }
+        }
+        m_counters.max_stale = false;
     }
 
-    template<typename key_type, typename value_type, typename weight_type>
-    bool Graph<key_type, value_type, weight_type>::loop(const key_type &key) {
-        if (m_umap.find(key) == m_umap.end()) throw GraphException("Key not found");
-        auto node_map = m_umap.find(key)->second.getedges();
-        if (node_map.find(key) != node_map.end()) return true;
-        return false;
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    size_t Graph<key_type, value_type, weight_type, reverse_index, storage>::Node::in_size() const noexcept {
+        static_assert(reverse_index, "in_size requires a Graph with reverse_index enabled");
+        return this->m_in_edge.size();
     }
 
-    template<typename key_type, typename value_type, typename weight_type>
-    std::pair<typename Graph<key_type, value_type, weight_type>::Node::iterator, bool>
-    Graph<key_type, value_type, weight_type>::Node::insert_edge(key_type key, weight_type weight) {
-        return m_edge.insert({key, weight});
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    const typename Graph<key_type, value_type, weight_type, reverse_index, storage>::key_set&
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::Node::in_edges() const noexcept {
+        static_assert(reverse_index, "in_edges requires a Graph with reverse_index enabled");
+        return this->m_in_edge;
     }
 
-    template<typename key_type, typename value_type, typename weight_type>
-    std::pair<typename Graph<key_type, value_type, weight_type>::Node::iterator, bool>
-    Graph<key_type, value_type, weight_type>::Node::insert_or_assign_edge(key_type key, weight_type weight) {
-        return m_edge.insert_or_assign(key, weight);
+    /**
+     * @details Gives a freshly inserted node the next free id.
+     * @throws If vertex_id cannot address another node, removes the node and throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    void Graph<key_type, value_type, weight_type, reverse_index, storage>::intern(iterator node) {
+        if (m_keys.size() >= no_vertex) {
+            m_umap.erase(node);
+            throw GraphException("Too many nodes");
+        }
+        node->second.m_id = static_cast<vertex_id>(m_keys.size());
+        m_keys.push_back(node->first);
+        ++m_counters.epoch;
+    }
+
+    /**
+     * @details Constructs the node directly in the node map, and its value from args; nothing is constructed if
+     * the key is present. The new node gets the next free id. An allocator that performs uses-allocator
+     * construction (std::pmr) passes itself to the node; any other allocator is passed explicitly.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    template<typename key_arg, typename... Args>
+    std::pair<typename Graph<key_type, value_type, weight_type, reverse_index, storage>::iterator, bool>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::try_emplace_node(key_arg&& key, Args&&... args) {
+        size_t slots = operation_log().slots(m_umap);
+        if constexpr (detail::constructs_with_allocator<typename node_map::allocator_type>::value) {
+            auto result = m_umap.try_emplace(std::forward<key_arg>(key), std::in_place, std::forward<Args>(args)...);
+            if (result.second) intern(result.first);
+            operation_log().node_insert(result.second, slots, m_umap);
+            return result;
+        } else {
+            auto result = m_umap.try_emplace(std::forward<key_arg>(key), std::allocator_arg, get_allocator(), std::in_place, std::forward<Args>(args)...);
+            if (result.second) intern(result.first);
+            operation_log().node_insert(result.second, slots, m_umap);
+            return result;
+        }
+    }
+
+    /**
+     * @details Inserts a node, or replaces the value of an existing one. A replaced node loses its outgoing edges,
+     * and they are removed from the reverse index and counted as erased edges; edges ending in the node and the
+     * node's id are kept.
+     * @return A pair of an iterator and a bool (true if the node was inserted, false if it was assigned)
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    std::pair<typename Graph<key_type, value_type, weight_type, reverse_index, storage>::iterator, bool>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::insert_or_assign_node(key_type key, value_type value) {
+        auto find = m_umap.find(key);
+        if (find == m_umap.end()) return emplace_node(std::move(key), std::move(value));
+        auto &edges = find->second.m_edge;
+        if (!edges.empty()) {
+            m_counters.edges -= edges.size();
+            if (edges.find(key) != edges.end()) --m_counters.loops;
+            m_counters.max_stale = true;
+            ++m_counters.epoch;
+            operation_log().edge_erase(edges.size());
+        }
+        if constexpr (reverse_index) {
+            for (auto const &edge: edges) m_umap.find(edge.first)->second.m_in_edge.erase(key);
+        }
+        edges.clear();
+        find->second.m_value = std::move(value);
+        return {find, false};
     }
 
     /**
@@ -219,14 +924,43 @@ namespace graph {
      * @return A pair of a Node::iterator and a bool (success indicator)
      * @throws If the key is not found, throws GraphException.
     */
-    template<typename key_type, typename value_type, typename weight_type>
-    std::pair<typename Graph<key_type, value_type, weight_type>::Node::iterator, bool>
-    Graph<key_type, value_type, weight_type>::insert_edge(std::pair<key_type, key_type> end_points, weight_type weight) {
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    std::pair<typename Graph<key_type, value_type, weight_type, reverse_index, storage>::Node::iterator, bool>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::insert_edge(std::pair<key_type, key_type> end_points, weight_type weight) {
+        auto first = m_umap.find(end_points.first);
+        auto second = m_umap.find(end_points.second);
+        if (first == m_umap.end()) throw GraphException("Key not found");
+        if (second == m_umap.end()) throw GraphException("Key not found");
+        size_t slots = operation_log().slots(first->second.m_edge);
+        auto result = first->second.emplace_edge(std::move(end_points.second), std::move(weight));
+        operation_log().edge_insert(result.second, slots, first->second.m_edge);
+        if (result.second) {
+            if constexpr (reverse_index) second->second.m_in_edge.insert(std::move(end_points.first));
+            count_edge(first->second, second->second);
+        }
+        return result;
+    }
+
+    /**
+     * @details As insert_edge, but the weight is constructed from args, and only if the edge is not present.
+     * @throws If the key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    template<typename... Args>
+    std::pair<typename Graph<key_type, value_type, weight_type, reverse_index, storage>::Node::iterator, bool>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::emplace_edge(std::pair<key_type, key_type> end_points, Args&&... args) {
         auto first = m_umap.find(end_points.first);
         auto second = m_umap.find(end_points.second);
         if (first == m_umap.end()) throw GraphException("Key not found");
         if (second == m_umap.end()) throw GraphException("Key not found");
-        return (first->second.insert_edge(end_points.second, weight));
+        size_t slots = operation_log().slots(first->second.m_edge);
+        auto result = first->second.emplace_edge(std::move(end_points.second), std::forward<Args>(args)...);
+        operation_log().edge_insert(result.second, slots, first->second.m_edge);
+        if (result.second) {
+            if constexpr (reverse_index) second->second.m_in_edge.insert(std::move(end_points.first));
+            count_edge(first->second, second->second);
+        }
+        return result;
     }
 
     /**
@@ -236,10 +970,168 @@ namespace graph {
      * @return A pair of a Node::iterator and a bool (success indicator)
      * @throws If the key is not found, throws GraphException.
     */
-    template<typename key_type, typename value_type, typename weight_type>
-    std::pair<typename Graph<key_type, value_type, weight_type>::Node::iterator, bool>
-    Graph<key_type, value_type, weight_type>::insert_or_assign_edge(std::pair<key_type, key_type> end_points, weight_type weight) {
-        if (m_umap.find(end_points.first) == m_umap.end()) throw GraphException("Key not found");
-        return (m_umap.find(end_points.first))->second.insert_or_assign_edge(end_points.second, weight);
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    std::pair<typename Graph<key_type, value_type, weight_type, reverse_index, storage>::Node::iterator, bool>
+    Graph<key_type, value_type, weight_type, reverse_index, storage>::insert_or_assign_edge(std::pair<key_type, key_type> end_points, weight_type weight) {
+        auto first = m_umap.find(end_points.first);
+        auto second = m_umap.find(end_points.second);
+        if (first == m_umap.end()) throw GraphException("Key not found");
+        if (second == m_umap.end()) throw GraphException("Key not found");
+        size_t slots = operation_log().slots(first->second.m_edge);
+        auto result = first->second.insert_or_assign_edge(std::move(end_points.second), std::move(weight));
+        operation_log().edge_insert(result.second, slots, first->second.m_edge);
+        if (result.second) {
+            if constexpr (reverse_index) second->second.m_in_edge.insert(std::move(end_points.first));
+            count_edge(first->second, second->second);
+        }
+        return result;
+    }
+
+    /**
+     * @details Also removes the source from the reverse index of the target. Does not throw if either key is
+     * missing.
+     * @return True if an edge was removed
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    bool Graph<key_type, value_type, weight_type, reverse_index, storage>::erase_edge(const key_type &source, const key_type &target) {
+        auto first = m_umap.find(source);
+        if (first == m_umap.end()) return false;
+        auto &edges = first->second.m_edge;
+        size_t degree = edges.size();
+        if (edges.erase(target) == 0) return false;
+        auto second = m_umap.find(target);
+        if constexpr (reverse_index) {
+            if (second != m_umap.end()) {
+                if (second->second.in_size() == m_counters.max_in) m_counters.max_stale = true;
+                second->second.m_in_edge.erase(source);
+            }
+        }
+        --m_counters.edges;
+        if (second == first) --m_counters.loops;
+        if (degree == m_counters.max_out) m_counters.max_stale = true;
+        ++m_counters.epoch;
+        operation_log().edge_erase(1);
+        return true;
+    }
+
+    /**
+     * @details Removes the outgoing edges and their entries in the reverse index of their targets, then the
+     * incoming edges: from the reverse index, or by scanning every node if the graph has none. The node with the
+     * largest id then takes over the id of the erased node. Invalidates iterators and references to the erased
+     * node, and, depending on the storage policy, to other nodes.
+     * @return True if a node was removed
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    bool Graph<key_type, value_type, weight_type, reverse_index, storage>::erase_node(const key_type &key) {
+        auto find = m_umap.find(key);
+        if (find == m_umap.end()) return false;
+        Node &node = find->second;
+        size_t removed = node.m_edge.size();
+        bool loop = node.m_edge.find(key) != node.m_edge.end();
+        if constexpr (reverse_index) {
+            for (auto const &edge: node.m_edge) {
+                auto target = m_umap.find(edge.first);
+                if (target != find) target->second.m_in_edge.erase(key);
+            }
+            for (auto const &source: node.m_in_edge) {
+                auto origin = m_umap.find(source);
+                if (origin != find) removed += origin->second.m_edge.erase(key);
+            }
+        } else {
+            for (auto &elem: m_umap) {
+                if (&elem.second != &node) removed += elem.second.m_edge.erase(key);
+            }
+        }
+
+        vertex_id id = node.m_id;
+        vertex_id last = static_cast<vertex_id>(m_keys.size() - 1);
+        if (id != last) {
+            m_umap.find(m_keys[last])->second.m_id = id;
+            m_keys[id] = std::move(m_keys[last]);
+        }
+        m_keys.pop_back();
+        m_umap.erase(find);
+
+        m_counters.edges -= removed;
+        if (loop) --m_counters.loops;
+        if (removed > 0) m_counters.max_stale = true;
+        ++m_counters.epoch;
+        operation_log().node_erase(removed);
+        return true;
+    }
+
+    /**
+     * @details Reserves space for the whole range up front, then inserts the nodes in order. Keys that are
+     * already present are left unchanged, as with insert_node.
+     * @param[in] nodes A forward range of (key, value) pairs
+     * @return The number of nodes that were inserted
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    template<typename range_type>
+    size_t Graph<key_type, value_type, weight_type, reverse_index, storage>::insert_nodes(const range_type &nodes) {
+        reserve(m_umap.size() + static_cast<size_t>(std::distance(std::begin(nodes), std::end(nodes))));
+        size_t inserted = 0;
+        for (auto const &node: nodes) inserted += insert_node(node.first, node.second).second;
+        return inserted;
+    }
+
+    /**
+     * @details Inserts many edges with one lookup per endpoint. The first pass resolves every endpoint, the
+     * second groups the edges by source id (a counting sort, so input order is kept within a source), and the
+     * third reserves each source's edge map once and inserts its edges. An edge with a missing endpoint is
+     * skipped and reported; an edge that already exists is left unchanged, as with insert_edge.
+     * @param[in] edges A container (or other forward range of lvalues) of ((source, target), weight) pairs
+     * @return The number of inserted edges and the positions of the edges with a missing endpoint
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    template<typename range_type>
+    BulkInsertResult Graph<key_type, value_type, weight_type, reverse_index, storage>::insert_edges(const range_type &edges) {
+        BulkInsertResult result;
+        auto count = static_cast<size_t>(std::distance(std::begin(edges), std::end(edges)));
+        std::vector<const std::remove_reference_t<decltype(*std::begin(edges))>*> elements(count);
+        std::vector<Node*> sources(count, nullptr);
+        std::vector<Node*> targets(count, nullptr);
+        std::vector<size_t> offsets(m_keys.size() + 1, 0);
+
+        size_t index = 0;
+        for (auto const &edge: edges) {
+            elements[index] = &edge;
+            auto first = m_umap.find(edge.first.first);
+            auto second = m_umap.find(edge.first.second);
+            if (first == m_umap.end() || second == m_umap.end()) {
+                result.failed.push_back(index++);
+                continue;
+            }
+            sources[index] = &first->second;
+            targets[index] = &second->second;
+            ++offsets[first->second.m_id + 1];
+            ++index;
+        }
+
+        for (size_t id = 0; id < m_keys.size(); ++id) offsets[id + 1] += offsets[id];
+        std::vector<size_t> order(offsets.back());
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for (index = 0; index < count; ++index) {
+            if (sources[index] != nullptr) order[next[sources[index]->m_id]++] = index;
+        }
+
+        for (size_t id = 0; id < m_keys.size(); ++id) {
+            if (offsets[id] == offsets[id + 1]) continue;
+            Node &source = *sources[order[offsets[id]]];
+            size_t slots = operation_log().slots(source.m_edge);
+            source.reserve_edges(source.m_edge.size() + offsets[id + 1] - offsets[id]);
+            operation_log().edge_insert(false, slots, source.m_edge);
+            for (size_t position = offsets[id]; position < offsets[id + 1]; ++position) {
+                auto const &edge = *elements[order[position]];
+                slots = operation_log().slots(source.m_edge);
+                bool inserted = source.insert_edge(edge.first.second, edge.second).second;
+                operation_log().edge_insert(inserted, slots, source.m_edge);
+                if (!inserted) continue;
+                ++result.inserted;
+                if constexpr (reverse_index) targets[order[position]]->m_in_edge.insert(edge.first.first);
+                count_edge(source, *targets[order[position]]);
+            }
+        }
+        return result;
     }
-}
\ No newline at end of file
+}
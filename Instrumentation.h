@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "Graph.h"
+
+namespace graph {
+    /**
+     * @defgroup Instrumentation Instrumentation
+     *
+     * @brief Exporting what a graph holds and does
+     *
+     * @details Graph::stats, memory_usage and table_stats are always available; Graph::operations counts only for
+     * graphs with an instrumented_storage policy. counting_resource measures the exact heap usage of graphs built
+     * on a std::pmr storage policy, and write_prometheus renders all of it in the Prometheus text format.
+     */
+
+    /**
+     * @ingroup Instrumentation
+     * @brief A std::pmr::memory_resource that counts what passes through it to another resource
+     *
+     * @details Build a graph on it with a std::pmr storage policy, for example `Graph<int, int, int, true,
+     * pmr::hash_storage> graph(&resource)`, to measure its allocations exactly. The counters are relaxed atomics,
+     * so the resource is as thread-safe as its upstream.
+     */
+    class counting_resource : public std::pmr::memory_resource {
+    public:
+        explicit counting_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept : m_upstream(upstream) {}
+
+        size_t bytes() const noexcept { return m_bytes.load(std::memory_order_relaxed); } /**< @brief Counts the bytes allocated and not freed yet. */
+        size_t peak_bytes() const noexcept { return m_peak.load(std::memory_order_relaxed); } /**< @brief Returns the largest value bytes() has had. */
+        std::uint64_t allocations() const noexcept { return m_allocations.load(std::memory_order_relaxed); } /**< @brief Counts all allocations. */
+        std::uint64_t deallocations() const noexcept { return m_deallocations.load(std::memory_order_relaxed); } /**< @brief Counts all deallocations. */
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            void* pointer = m_upstream->allocate(bytes, alignment);
+            m_allocations.fetch_add(1, std::memory_order_relaxed);
+            size_t current = m_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            size_t peak = m_peak.load(std::memory_order_relaxed);
+            while (current > peak && !m_peak.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+            return pointer;
+        }
+
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+            m_upstream->deallocate(pointer, bytes, alignment);
+            m_deallocations.fetch_add(1, std::memory_order_relaxed);
+            m_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+        std::pmr::memory_resource* m_upstream;
+        std::atomic<size_t> m_bytes{0};
+        std::atomic<size_t> m_peak{0};
+        std::atomic<std::uint64_t> m_allocations{0};
+        std::atomic<std::uint64_t> m_deallocations{0};
+    };
+
+    namespace detail {
+        /** @brief Writes a label value with every backslash, double quote and newline escaped, as the text exposition format requires. */
+        inline void write_label_value(std::ostream& out, std::string_view text) {
+            for (char letter: text) {
+                if (letter == '\\') out << "\\\\";
+                else if (letter == '"') out << "\\\"";
+                else if (letter == '\n') out << "\\n";
+                else out << letter;
+            }
+        }
+
+        /** @brief Writes one sample line, `name{graph="label",extra} value`; the label is escaped, extra is written as is. */
+        template<typename value_type>
+        void write_sample(std::ostream& out, const char* name, const std::string& label, const char* extra, value_type value) {
+            out << name << "{graph=\"";
+            write_label_value(out, label);
+            out << '"';
+            if (extra[0] != '\0') out << ',' << extra;
+            out << "} " << value << '\n';
+        }
+
+        /** @brief Writes a probe length histogram as a Prometheus histogram with one bucket per length. */
+        inline void write_probes(std::ostream& out, const std::string& label, const char* table, const std::vector<size_t>& probes) {
+            auto labels = [&](const char* name) {
+                out << name << "{graph=\"";
+                write_label_value(out, label);
+                out << "\",table=\"";
+                write_label_value(out, table);
+                out << '"';
+            };
+            size_t count = 0;
+            size_t sum = 0;
+            for (size_t length = 1; length <= probes.size(); ++length) {
+                count += probes[length - 1];
+                sum += probes[length - 1] * length;
+                labels("graph_probe_length_bucket");
+                out << ",le=\"" << length << "\"} " << count << '\n';
+            }
+            labels("graph_probe_length_bucket");
+            out << ",le=\"+Inf\"} " << count << '\n';
+            labels("graph_probe_length_sum");
+            out << "} " << sum << '\n';
+            labels("graph_probe_length_count");
+            out << "} " << count << '\n';
+        }
+    }
+
+    /**
+     * @ingroup Instrumentation
+     * @brief Writes the stats, memory usage, table occupancy and, if instrumented, operation counts of a graph
+     * in the Prometheus text exposition format
+     *
+     * @details Every sample carries a `graph` label with the given name, escaped, so several graphs can share one scrape.
+     * Takes O(size() + edges) for memory_usage and table_stats; export at scrape intervals, not per operation.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    void write_prometheus(std::ostream& out, const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, const std::string& name = "graph") {
+        auto stats = graph.stats();
+        out << "# TYPE graph_nodes gauge\n";
+        detail::write_sample(out, "graph_nodes", name, "", stats.nodes);
+        out << "# TYPE graph_edges gauge\n";
+        detail::write_sample(out, "graph_edges", name, "", stats.edges);
+        out << "# TYPE graph_self_loops gauge\n";
+        detail::write_sample(out, "graph_self_loops", name, "", stats.self_loops);
+        out << "# TYPE graph_max_degree gauge\n";
+        detail::write_sample(out, "graph_max_degree", name, "direction=\"out\"", stats.max_degree_out);
+        detail::write_sample(out, "graph_max_degree", name, "direction=\"in\"", stats.max_degree_in);
+
+        auto memory = graph.memory_usage();
+        out << "# TYPE graph_memory_bytes gauge\n";
+        detail::write_sample(out, "graph_memory_bytes", name, "part=\"nodes\"", memory.nodes);
+        detail::write_sample(out, "graph_memory_bytes", name, "part=\"edges\"", memory.edges);
+        detail::write_sample(out, "graph_memory_bytes", name, "part=\"reverse_index\"", memory.reverse_index);
+        detail::write_sample(out, "graph_memory_bytes", name, "part=\"keys\"", memory.keys);
+
+        auto tables = graph.table_stats();
+        out << "# TYPE graph_table_slots gauge\n";
+        detail::write_sample(out, "graph_table_slots", name, "table=\"nodes\"", tables.node_slots);
+        detail::write_sample(out, "graph_table_slots", name, "table=\"edges\"", tables.edge_slots);
+        out << "# TYPE graph_load_factor gauge\n";
+        detail::write_sample(out, "graph_load_factor", name, "table=\"nodes\"", tables.node_load_factor);
+        detail::write_sample(out, "graph_load_factor", name, "table=\"edges\"", tables.edge_load_factor);
+        out << "# TYPE graph_probe_length histogram\n";
+        detail::write_probes(out, name, "nodes", tables.node_probes);
+        detail::write_probes(out, name, "edges", tables.edge_probes);
+
+        if constexpr (Graph<key_type, value_type, weight_type, reverse_index, storage>::instrumented) {
+            auto operations = graph.operations();
+            out << "# TYPE graph_operations_total counter\n";
+            detail::write_sample(out, "graph_operations_total", name, "operation=\"node_lookup\"", operations.node_lookups);
+            detail::write_sample(out, "graph_operations_total", name, "operation=\"edge_lookup\"", operations.edge_lookups);
+            detail::write_sample(out, "graph_operations_total", name, "operation=\"node_insert\"", operations.node_inserts);
+            detail::write_sample(out, "graph_operations_total", name, "operation=\"edge_insert\"", operations.edge_inserts);
+            detail::write_sample(out, "graph_operations_total", name, "operation=\"node_erase\"", operations.node_erases);
+            detail::write_sample(out, "graph_operations_total", name, "operation=\"edge_erase\"", operations.edge_erases);
+            out << "# TYPE graph_rehashes_total counter\n";
+            detail::write_sample(out, "graph_rehashes_total", name, "table=\"nodes\"", operations.node_rehashes);
+            detail::write_sample(out, "graph_rehashes_total", name, "table=\"edges\"", operations.edge_rehashes);
+        }
+    }
+
+    /**
+     * @ingroup Instrumentation
+     * @brief Writes the allocation counters of a counting_resource in the Prometheus text exposition format
+     */
+    inline void write_prometheus(std::ostream& out, const counting_resource& resource, const std::string& name = "graph") {
+        out << "# TYPE graph_allocated_bytes gauge\n";
+        detail::write_sample(out, "graph_allocated_bytes", name, "", resource.bytes());
+        out << "# TYPE graph_allocated_bytes_peak gauge\n";
+        detail::write_sample(out, "graph_allocated_bytes_peak", name, "", resource.peak_bytes());
+        out << "# TYPE graph_allocations_total counter\n";
+        detail::write_sample(out, "graph_allocations_total", name, "", resource.allocations());
+        out << "# TYPE graph_deallocations_total counter\n";
+        detail::write_sample(out, "graph_deallocations_total", name, "", resource.deallocations());
+    }
+}
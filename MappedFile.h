@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Graph.h"
+
+namespace graph {
+    namespace detail {
+        /**
+         * @brief Read-only memory mapping of a whole file
+         *
+         * @details Maps with MAP_SHARED, so several processes reading the same file share its pages. An empty file
+         * has no mapping and a null data(). Requires POSIX mmap.
+         */
+        class mapped_file {
+        public:
+            mapped_file() = default;
+            /** @throws If the file cannot be opened or mapped, throws GraphException. */
+            explicit mapped_file(const std::string& path) {
+                int descriptor = open(path.c_str(), O_RDONLY);
+                if (descriptor < 0) throw GraphException("Cannot open file");
+                struct stat status{};
+                if (fstat(descriptor, &status) != 0) {
+                    close(descriptor);
+                    throw GraphException("Cannot open file");
+                }
+                m_size = static_cast<size_t>(status.st_size);
+                void* mapping = m_size == 0 ? nullptr : mmap(nullptr, m_size, PROT_READ, MAP_SHARED, descriptor, 0);
+                close(descriptor);
+                if (mapping == MAP_FAILED) throw GraphException("Cannot map file");
+                m_data = static_cast<const char*>(mapping);
+            }
+            mapped_file(mapped_file&& other) noexcept { swap(other); }
+            mapped_file& operator=(mapped_file&& other) noexcept { swap(other); return *this; }
+            mapped_file(const mapped_file&) = delete;
+            mapped_file& operator=(const mapped_file&) = delete;
+            ~mapped_file() { if (m_data != nullptr) munmap(const_cast<char*>(m_data), m_size); }
+
+            void swap(mapped_file& other) noexcept {
+                std::swap(m_data, other.m_data);
+                std::swap(m_size, other.m_size);
+            }
+
+            const char* data() const noexcept { return m_data; }
+            size_t size() const noexcept { return m_size; }
+        private:
+            const char* m_data = nullptr;
+            size_t m_size = 0;
+        };
+    }
+}
@@ -0,0 +1,501 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "MappedFile.h"
+
+namespace graph {
+    /**
+     * @defgroup Files Graph files
+     *
+     * @brief Binary on-disk format of a frozen graph
+     *
+     * @details
+     * A graph file is a fixed header followed by sections, each starting at a multiple of 64 bytes:
+     *
+     * | section   | contents                                                             |
+     * |-----------|----------------------------------------------------------------------|
+     * | offsets   | node_count + 1 uint64 row offsets, as CsrGraph::offsets()            |
+     * | neighbors | edge_count vertex ids, as CsrGraph::neighbors()                      |
+     * | weights   | edge_count weights, as CsrGraph::weights()                           |
+     * | keys      | the key of every node (the vertex table), indexed by id              |
+     * | key data  | characters of string keys                                            |
+     * | values    | the value of every node, indexed by id; only if the file has values  |
+     * | value data| characters of string values                                          |
+     * | index     | open-addressing table of ids, hashed by key, for MappedGraph::id_of  |
+     *
+     * Keys, values and weights must be trivially copyable and are stored as their object bytes, or be std::string
+     * and stored as node_count + 1 uint64 offsets into the data section. Numbers are written in native byte order;
+     * the header records the byte order, the format version and the size of every element type, and a file that
+     * does not match the reading program is rejected.
+     */
+
+    namespace detail {
+        constexpr char file_magic[8] = {'G', 'R', 'A', 'P', 'H', 'C', 'S', 'R'};
+        constexpr std::uint32_t file_version = 1;
+        constexpr std::uint32_t file_byte_order = 0x01020304;
+        constexpr std::uint64_t file_alignment = 64;
+        constexpr std::uint32_t file_has_values = 1;
+
+        /** @brief Position and length, in bytes, of one section of a graph file. */
+        struct file_section {
+            std::uint64_t offset = 0;
+            std::uint64_t size = 0;
+        };
+
+        /** @brief Header at the start of a graph file. */
+        struct file_header {
+            char magic[8] = {};
+            std::uint32_t version = 0;
+            std::uint32_t byte_order = 0;
+            std::uint64_t node_count = 0;
+            std::uint64_t edge_count = 0;
+            std::uint32_t key_size = 0; /**< @brief sizeof the key type, or 0 for string keys. */
+            std::uint32_t value_size = 0; /**< @brief sizeof the value type, or 0 for string values. */
+            std::uint32_t weight_size = 0;
+            std::uint32_t flags = 0;
+            std::uint64_t index_capacity = 0; /**< @brief Number of slots of the index; a power of two. */
+            file_section offsets, neighbors, weights, keys, key_data, values, value_data, index;
+        };
+
+        /** @brief FNV-1a; stable across programs, unlike std::hash. */
+        inline std::uint64_t file_hash(const void* data, size_t size) noexcept {
+            auto bytes = static_cast<const unsigned char*>(data);
+            std::uint64_t hash = 14695981039346656037ull;
+            for (size_t index = 0; index < size; ++index) {
+                hash ^= bytes[index];
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        /**
+         * @brief How a column of keys or values is laid out in a graph file
+         *
+         * @details Trivially copyable types are stored as an array of objects. Their object bytes are hashed, so
+         * key types must not have padding.
+         */
+        template<typename T, typename = void>
+        struct file_column {
+            static_assert(std::is_trivially_copyable_v<T>, "Graph files store only trivially copyable types and std::string");
+        };
+
+        template<typename T>
+        struct file_column<T, std::enable_if_t<std::is_trivially_copyable_v<T>>> {
+            using reference = const T&;
+            static constexpr std::uint32_t element_size = sizeof(T);
+
+            static std::uint64_t primary_size(size_t count) noexcept { return count * sizeof(T); }
+            template<typename getter>
+            static std::uint64_t data_size(size_t, getter&&) noexcept { return 0; }
+            template<typename writer_type, typename getter>
+            static void write(writer_type& writer, size_t count, getter&& get) {
+                for (size_t index = 0; index < count; ++index) writer.write(&get(index), sizeof(T));
+            }
+            template<typename writer_type, typename getter>
+            static void write_data(writer_type&, size_t, getter&&) {}
+
+            static bool valid(const char*, const file_section&, size_t) noexcept { return true; }
+            static reference get(const char* primary, const char*, size_t index) noexcept {
+                return reinterpret_cast<const T*>(primary)[index];
+            }
+            static std::uint64_t hash(reference item) noexcept { return file_hash(&item, sizeof(T)); }
+        };
+
+        template<>
+        struct file_column<std::string> {
+            using reference = std::string_view;
+            static constexpr std::uint32_t element_size = 0;
+
+            static std::uint64_t primary_size(size_t count) noexcept { return (count + 1) * sizeof(std::uint64_t); }
+            template<typename getter>
+            static std::uint64_t data_size(size_t count, getter&& get) {
+                std::uint64_t size = 0;
+                for (size_t index = 0; index < count; ++index) size += get(index).size();
+                return size;
+            }
+            template<typename writer_type, typename getter>
+            static void write(writer_type& writer, size_t count, getter&& get) {
+                std::uint64_t offset = 0;
+                writer.write(&offset, sizeof(offset));
+                for (size_t index = 0; index < count; ++index) {
+                    offset += get(index).size();
+                    writer.write(&offset, sizeof(offset));
+                }
+            }
+            template<typename writer_type, typename getter>
+            static void write_data(writer_type& writer, size_t count, getter&& get) {
+                for (size_t index = 0; index < count; ++index) writer.write(get(index).data(), get(index).size());
+            }
+
+            /** @brief Checks that the last string ends at the end of the data section. */
+            static bool valid(const char* primary, const file_section& data, size_t count) noexcept {
+                return reinterpret_cast<const std::uint64_t*>(primary)[count] == data.size;
+            }
+            static reference get(const char* primary, const char* data, size_t index) noexcept {
+                auto offsets = reinterpret_cast<const std::uint64_t*>(primary);
+                return {data + offsets[index], static_cast<size_t>(offsets[index + 1] - offsets[index])};
+            }
+            static std::uint64_t hash(reference item) noexcept { return file_hash(item.data(), item.size()); }
+        };
+
+        /** @brief Sequential writer that tracks its position so sections can be padded to their offsets. */
+        class file_writer {
+        public:
+            explicit file_writer(const std::string& path) : m_out(path, std::ios::binary | std::ios::trunc) {
+                if (!m_out) throw GraphException("Cannot open file");
+            }
+
+            void write(const void* data, size_t size) {
+                m_out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+                m_position += size;
+            }
+            void pad_to(std::uint64_t offset) {
+                static const char zeros[file_alignment] = {};
+                while (m_position < offset) write(zeros, std::min<std::uint64_t>(offset - m_position, file_alignment));
+            }
+            void close() {
+                m_out.close();
+                if (!m_out) throw GraphException("Cannot write file");
+            }
+        private:
+            std::ofstream m_out;
+            std::uint64_t m_position = 0;
+        };
+
+        inline std::uint64_t file_align(std::uint64_t offset) noexcept {
+            return (offset + file_alignment - 1) / file_alignment * file_alignment;
+        }
+    }
+
+    /**
+     * @ingroup Files
+     * @brief Writes a frozen graph to a graph file
+     *
+     * @param[in] graph The graph to write
+     * @param[in] path The file to create or overwrite
+     * @param[in] values If false, the node values are left out of the file
+     * @throws If the file cannot be written, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    void save(const CsrGraph<key_type, value_type, weight_type>& graph, const std::string& path, bool values = true) {
+        static_assert(std::is_trivially_copyable_v<weight_type>, "Graph files store only trivially copyable weights");
+        using key_column = detail::file_column<key_type>;
+        using value_column = detail::file_column<value_type>;
+        size_t size = graph.size();
+        auto key = [&graph](size_t id) -> const key_type& { return graph.key_of(static_cast<vertex_id>(id)); };
+        auto value = [&graph](size_t id) -> const value_type& { return graph[static_cast<vertex_id>(id)].value(); };
+
+        std::uint64_t capacity = 1;
+        while (capacity < 2 * size + 1) capacity *= 2;
+        std::vector<vertex_id> index(capacity, no_vertex);
+        for (size_t id = 0; id < size; ++id) {
+            auto slot = key_column::hash(key(id)) & (capacity - 1);
+            while (index[slot] != no_vertex) slot = (slot + 1) & (capacity - 1);
+            index[slot] = static_cast<vertex_id>(id);
+        }
+
+        detail::file_header header;
+        std::memcpy(header.magic, detail::file_magic, sizeof(header.magic));
+        header.version = detail::file_version;
+        header.byte_order = detail::file_byte_order;
+        header.node_count = size;
+        header.edge_count = graph.edge_count();
+        header.key_size = key_column::element_size;
+        header.weight_size = sizeof(weight_type);
+        header.index_capacity = capacity;
+        if (values) {
+            header.value_size = value_column::element_size;
+            header.flags |= detail::file_has_values;
+        }
+
+        std::uint64_t offset = detail::file_align(sizeof(header));
+        auto place = [&offset](detail::file_section& section, std::uint64_t bytes) {
+            section = {offset, bytes};
+            offset = detail::file_align(offset + bytes);
+        };
+        place(header.offsets, (size + 1) * sizeof(std::uint64_t));
+        place(header.neighbors, graph.edge_count() * sizeof(vertex_id));
+        place(header.weights, graph.edge_count() * sizeof(weight_type));
+        place(header.keys, key_column::primary_size(size));
+        place(header.key_data, key_column::data_size(size, key));
+        if (values) {
+            place(header.values, value_column::primary_size(size));
+            place(header.value_data, value_column::data_size(size, value));
+        }
+        place(header.index, capacity * sizeof(vertex_id));
+
+        detail::file_writer writer(path);
+        writer.write(&header, sizeof(header));
+        writer.pad_to(header.offsets.offset);
+        for (auto row: graph.offsets()) {
+            auto row_offset = static_cast<std::uint64_t>(row);
+            writer.write(&row_offset, sizeof(row_offset));
+        }
+        writer.pad_to(header.neighbors.offset);
+        writer.write(graph.neighbors().data(), header.neighbors.size);
+        writer.pad_to(header.weights.offset);
+        writer.write(graph.weights().data(), header.weights.size);
+        writer.pad_to(header.keys.offset);
+        key_column::write(writer, size, key);
+        writer.pad_to(header.key_data.offset);
+        key_column::write_data(writer, size, key);
+        if (values) {
+            writer.pad_to(header.values.offset);
+            value_column::write(writer, size, value);
+            writer.pad_to(header.value_data.offset);
+            value_column::write_data(writer, size, value);
+        }
+        writer.pad_to(header.index.offset);
+        writer.write(index.data(), header.index.size);
+        writer.close();
+    }
+
+    /** @ingroup Files @brief Freezes the graph and writes it to a graph file. */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    void save(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, const std::string& path, bool values = true) {
+        save(freeze(graph), path, values);
+    }
+
+    /**
+     * @ingroup Files
+     * @brief Read-only graph backed by a memory-mapped graph file
+     *
+     * @details
+     * Opening a file maps it and checks the header and the bounds of every section; nothing is parsed or copied,
+     * so opening is O(1) and pages are loaded by the operating system as they are touched. The contents of the
+     * sections are trusted: a file whose rows point outside the graph is not detected.
+     *
+     * The interface mirrors CsrGraph. String keys and values are returned as std::string_view into the mapping.
+     * The file is mapped with MAP_SHARED, so several processes reading it share its pages. Requires POSIX mmap.
+     *
+     * @tparam key_type - type of the key of the node
+     * @tparam value_type - type of the value of the node
+     * @tparam weight_type - type of the weight of the edge
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    class MappedGraph {
+        using key_column = detail::file_column<key_type>;
+        using value_column = detail::file_column<value_type>;
+    public:
+        class Node;
+
+        using key_reference = typename key_column::reference;
+        using value_reference = typename value_column::reference;
+        using const_iterator = detail::csr_node_iterator<key_reference, Node, MappedGraph>;
+        using iterator = const_iterator;
+
+        /** @throws If the file cannot be mapped or is not a graph file of these types, throws GraphException. */
+        explicit MappedGraph(const std::string& path);
+        MappedGraph(MappedGraph&& other) noexcept { swap(other); }
+        MappedGraph& operator=(MappedGraph&& other) noexcept { swap(other); return *this; }
+        MappedGraph(const MappedGraph&) = delete;
+        MappedGraph& operator=(const MappedGraph&) = delete;
+
+        void swap(MappedGraph& other) noexcept;
+
+        bool empty() const noexcept { return size() == 0; } /**< @brief Checks if the graph has no nodes. */
+        size_t size() const noexcept { return m_size; } /**< @brief Counts the number of nodes. */
+        size_t edge_count() const noexcept { return m_edge_count; } /**< @brief Counts the number of edges. */
+        bool has_values() const noexcept { return m_values != nullptr; } /**< @brief Checks if the file stores the node values. */
+
+        const_iterator cbegin() const noexcept { return const_iterator(this, 0); }
+        const_iterator cend() const noexcept { return const_iterator(this, static_cast<vertex_id>(size())); }
+        const_iterator begin() const noexcept { return cbegin(); }
+        const_iterator end() const noexcept { return cend(); }
+
+        Node operator[](vertex_id id) const noexcept { return Node(this, id); } /**< @brief Returns the node with the given id. */
+        Node at(const key_type& key) const;
+        const_iterator find(const key_type& key) const;
+
+        vertex_id id_of(const key_type& key) const;
+        key_reference key_of(vertex_id id) const noexcept { return key_column::get(m_keys, m_key_data, id); } /**< @brief Returns the key of the node with the given id. */
+
+        size_t degree_out(const key_type& key) const { return at(key).size(); } /**< @brief Counts the number of edges that start in the node with the given key. */
+        size_t degree_out_by_id(vertex_id id) const noexcept { return static_cast<size_t>(m_offsets[id + 1] - m_offsets[id]); } /**< @brief Counts the edges that start in the node with the given id. */
+
+        /** @brief Returns the offset array; the edges of node i occupy [offsets()[i], offsets()[i + 1]). */
+        detail::array_view<std::uint64_t> offsets() const noexcept { return {m_offsets, m_offsets + m_size + 1}; }
+        detail::array_view<vertex_id> neighbors() const noexcept { return {m_neighbors, m_neighbors + m_edge_count}; } /**< @brief Returns the neighbor ids of all edges. */
+        detail::array_view<weight_type> weights() const noexcept { return {m_weights, m_weights + m_edge_count}; } /**< @brief Returns the weights of all edges. */
+    private:
+        vertex_id find_id(const key_type& key) const noexcept;
+
+        detail::mapped_file m_file;
+        size_t m_size = 0;
+        size_t m_edge_count = 0;
+        const std::uint64_t* m_offsets = nullptr;
+        const vertex_id* m_neighbors = nullptr;
+        const weight_type* m_weights = nullptr;
+        const char* m_keys = nullptr;
+        const char* m_key_data = nullptr;
+        const char* m_values = nullptr; /**< @brief Null if the file has no values. */
+        const char* m_value_data = nullptr;
+        const vertex_id* m_index = nullptr;
+        std::uint64_t m_index_mask = 0;
+    };
+
+    /**
+     * @ingroup Files
+     * @brief View of a single node of a MappedGraph
+     *
+     * @details Cheap to copy; it refers into the mapping and stays valid as long as the MappedGraph does.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    class MappedGraph<key_type, value_type, weight_type>::Node {
+    public:
+        using const_iterator = detail::csr_edge_iterator<key_reference, weight_type, MappedGraph>;
+        using iterator = const_iterator;
+
+        Node() = default;
+        Node(const MappedGraph* graph, vertex_id id) noexcept : m_graph(graph), m_id(id) {}
+
+        bool empty() const noexcept { return size() == 0; } /**< @brief Returns true if the node has no edges, false otherwise. */
+        size_t size() const noexcept { return m_graph->degree_out_by_id(m_id); } /**< @brief Returns the number of edges in the node. */
+        vertex_id id() const noexcept { return m_id; } /**< @brief Returns the id of the node. */
+        key_reference key() const noexcept { return m_graph->key_of(m_id); } /**< @brief Returns the key of the node. */
+        value_reference value() const;
+        value_reference getvalue() const { return value(); }
+
+        const_iterator cbegin() const noexcept { return edge_iterator(m_graph->m_offsets[m_id]); }
+        const_iterator cend() const noexcept { return edge_iterator(m_graph->m_offsets[m_id + 1]); }
+        const_iterator begin() const noexcept { return cbegin(); }
+        const_iterator end() const noexcept { return cend(); }
+
+        /** @brief Returns the ids of the neighbors, sorted ascending. */
+        detail::array_view<vertex_id> neighbors() const noexcept {
+            return {m_graph->m_neighbors + m_graph->m_offsets[m_id], m_graph->m_neighbors + m_graph->m_offsets[m_id + 1]};
+        }
+        /** @brief Returns the weights of the edges, parallel to neighbors(). */
+        detail::array_view<weight_type> weights() const noexcept {
+            return {m_graph->m_weights + m_graph->m_offsets[m_id], m_graph->m_weights + m_graph->m_offsets[m_id + 1]};
+        }
+    private:
+        const_iterator edge_iterator(std::uint64_t offset) const noexcept {
+            return const_iterator(m_graph, m_graph->m_neighbors + offset, m_graph->m_weights + offset);
+        }
+
+        const MappedGraph* m_graph = nullptr;
+        vertex_id m_id = 0;
+    };
+
+    template<typename key_type, typename value_type, typename weight_type>
+    MappedGraph<key_type, value_type, weight_type>::MappedGraph(const std::string& path) : m_file(path) {
+        static_assert(std::is_trivially_copyable_v<weight_type>, "Graph files store only trivially copyable weights");
+        if (m_file.size() < sizeof(detail::file_header)) throw GraphException("Invalid graph file");
+        auto base = m_file.data();
+        size_t length = m_file.size();
+        detail::file_header header;
+        std::memcpy(&header, base, sizeof(header));
+        auto fits = [length](const detail::file_section& section, std::uint64_t size) {
+            return section.size == size && section.offset % detail::file_alignment == 0
+                   && section.offset <= length && section.size <= length - section.offset;
+        };
+        // Checked before the section sizes are computed, so that count * element cannot overflow.
+        auto fits_count = [length](std::uint64_t count, size_t element) { return count <= length / element; };
+        bool values = (header.flags & detail::file_has_values) != 0;
+        bool valid = std::memcmp(header.magic, detail::file_magic, sizeof(header.magic)) == 0
+                     && header.version == detail::file_version
+                     && header.byte_order == detail::file_byte_order
+                     && header.key_size == key_column::element_size
+                     && header.weight_size == sizeof(weight_type)
+                     && (!values || header.value_size == value_column::element_size)
+                     && header.node_count < no_vertex
+                     && header.index_capacity > header.node_count
+                     && (header.index_capacity & (header.index_capacity - 1)) == 0
+                     && fits_count(header.edge_count, sizeof(vertex_id))
+                     && fits_count(header.edge_count, sizeof(weight_type))
+                     && fits_count(header.index_capacity, sizeof(vertex_id))
+                     && fits(header.offsets, (header.node_count + 1) * sizeof(std::uint64_t))
+                     && fits(header.neighbors, header.edge_count * sizeof(vertex_id))
+                     && fits(header.weights, header.edge_count * sizeof(weight_type))
+                     && fits(header.keys, key_column::primary_size(header.node_count))
+                     && fits(header.key_data, header.key_data.size)
+                     && (!values || fits(header.values, value_column::primary_size(header.node_count)))
+                     && (!values || fits(header.value_data, header.value_data.size))
+                     && fits(header.index, header.index_capacity * sizeof(vertex_id));
+        if (valid) {
+            m_offsets = reinterpret_cast<const std::uint64_t*>(base + header.offsets.offset);
+            valid = m_offsets[0] == 0 && m_offsets[header.node_count] == header.edge_count
+                    && key_column::valid(base + header.keys.offset, header.key_data, header.node_count)
+                    && (!values || value_column::valid(base + header.values.offset, header.value_data, header.node_count));
+        }
+        if (!valid) throw GraphException("Invalid graph file");
+
+        m_size = header.node_count;
+        m_edge_count = header.edge_count;
+        m_neighbors = reinterpret_cast<const vertex_id*>(base + header.neighbors.offset);
+        m_weights = reinterpret_cast<const weight_type*>(base + header.weights.offset);
+        m_keys = base + header.keys.offset;
+        m_key_data = base + header.key_data.offset;
+        if (values) {
+            m_values = base + header.values.offset;
+            m_value_data = base + header.value_data.offset;
+        }
+        m_index = reinterpret_cast<const vertex_id*>(base + header.index.offset);
+        m_index_mask = header.index_capacity - 1;
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    void MappedGraph<key_type, value_type, weight_type>::swap(MappedGraph &other) noexcept {
+        m_file.swap(other.m_file);
+        std::swap(m_size, other.m_size);
+        std::swap(m_edge_count, other.m_edge_count);
+        std::swap(m_offsets, other.m_offsets);
+        std::swap(m_neighbors, other.m_neighbors);
+        std::swap(m_weights, other.m_weights);
+        std::swap(m_keys, other.m_keys);
+        std::swap(m_key_data, other.m_key_data);
+        std::swap(m_values, other.m_values);
+        std::swap(m_value_data, other.m_value_data);
+        std::swap(m_index, other.m_index);
+        std::swap(m_index_mask, other.m_index_mask);
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    typename MappedGraph<key_type, value_type, weight_type>::Node MappedGraph<key_type, value_type, weight_type>::at(const key_type &key) const {
+        return Node(this, id_of(key));
+    }
+
+    template<typename key_type, typename value_type, typename weight_type>
+    typename MappedGraph<key_type, value_type, weight_type>::const_iterator MappedGraph<key_type, value_type, weight_type>::find(const key_type &key) const {
+        vertex_id id = find_id(key);
+        if (id == no_vertex) return cend();
+        return const_iterator(this, id);
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    vertex_id MappedGraph<key_type, value_type, weight_type>::id_of(const key_type &key) const {
+        vertex_id id = find_id(key);
+        if (id == no_vertex) throw GraphException("Key not found");
+        return id;
+    }
+
+    /** @details Linear probing in the index section; stops at the first empty slot. */
+    template<typename key_type, typename value_type, typename weight_type>
+    vertex_id MappedGraph<key_type, value_type, weight_type>::find_id(const key_type &key) const noexcept {
+        if (m_index == nullptr) return no_vertex;
+        for (auto slot = key_column::hash(key) & m_index_mask; m_index[slot] != no_vertex; slot = (slot + 1) & m_index_mask) {
+            if (key_of(m_index[slot]) == key) return m_index[slot];
+        }
+        return no_vertex;
+    }
+
+    /** @throws If the file was saved without values, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type>
+    typename MappedGraph<key_type, value_type, weight_type>::value_reference MappedGraph<key_type, value_type, weight_type>::Node::value() const {
+        if (m_graph->m_values == nullptr) throw GraphException("Values not stored");
+        return value_column::get(m_graph->m_values, m_graph->m_value_data, m_id);
+    }
+}
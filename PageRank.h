@@ -0,0 +1,378 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "Parallel.h"
+#include "Storage.h"
+
+namespace graph {
+    /** @defgroup Ranking Ranking */
+
+    /**
+     * @ingroup Ranking
+     * @brief Parameters of PageRank
+     */
+    struct PageRankOptions {
+        double damping = 0.85; /**< @brief The probability of following an edge rather than jumping to a random node. */
+        double tolerance = 1e-6; /**< @brief Stop when the L1 distance between two iterations falls below this. */
+        size_t max_iterations = 100; /**< @brief Stop after this many iterations. */
+        size_t threads = 0; /**< @brief The number of workers; 0 means default_threads(). */
+    };
+
+    /**
+     * @ingroup Ranking
+     * @brief Result of PageRank, as a dense array indexed by vertex id
+     */
+    template<typename rank_type>
+    struct PageRankResult {
+        std::vector<rank_type> rank; /**< @brief The rank of every node; the ranks sum to 1. */
+        size_t iterations = 0; /**< @brief The number of iterations that ran. */
+        rank_type error = 0; /**< @brief The L1 distance between the last two iterations. */
+    };
+
+    /**
+     * @ingroup Ranking
+     * @brief Parameters of Personalized PageRank
+     */
+    struct PersonalizedPageRankOptions {
+        double damping = 0.85; /**< @brief The probability of following an edge rather than jumping back to a source. */
+        double epsilon = 1e-7; /**< @brief Stop when every residual is below epsilon times the out-degree of its node. */
+    };
+
+    /**
+     * @ingroup Ranking
+     * @brief Result of Personalized PageRank: the nodes with a nonzero score only
+     */
+    struct PersonalizedPageRankResult {
+        std::vector<std::pair<vertex_id, double>> scores; /**< @brief (id, score) pairs, highest score first. */
+        size_t pushes = 0; /**< @brief The number of push operations that ran. */
+    };
+
+    namespace detail {
+        /** @brief One vector of SIMD lanes, and the operations the gather kernels need on it. */
+        template<typename T>
+        struct simd;
+
+#if defined(__AVX512F__)
+        template<>
+        struct simd<double> {
+            using vector = __m512d;
+            static constexpr size_t lanes = 8;
+            static vector zero() noexcept { return _mm512_setzero_pd(); }
+            static vector load(const double* values) noexcept { return _mm512_loadu_pd(values); }
+            static vector gather(const double* x, const vertex_id* index) noexcept {
+                __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index));
+                return _mm512_mask_i32gather_pd(zero(), 0xff, indices, x, 8);
+            }
+            static vector add(vector first, vector second) noexcept { return _mm512_add_pd(first, second); }
+            static vector multiply(vector first, vector second) noexcept { return _mm512_mul_pd(first, second); }
+            static double sum(vector values) noexcept {
+                alignas(64) double lane[lanes];
+                _mm512_store_pd(lane, values);
+                return ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));
+            }
+        };
+
+        template<>
+        struct simd<float> {
+            using vector = __m512;
+            static constexpr size_t lanes = 16;
+            static vector zero() noexcept { return _mm512_setzero_ps(); }
+            static vector load(const float* values) noexcept { return _mm512_loadu_ps(values); }
+            static vector gather(const float* x, const vertex_id* index) noexcept {
+                return _mm512_mask_i32gather_ps(zero(), 0xffff, _mm512_loadu_si512(index), x, 4);
+            }
+            static vector add(vector first, vector second) noexcept { return _mm512_add_ps(first, second); }
+            static vector multiply(vector first, vector second) noexcept { return _mm512_mul_ps(first, second); }
+            static float sum(vector values) noexcept {
+                alignas(64) float lane[lanes];
+                _mm512_store_ps(lane, values);
+                float total = 0;
+                for (float value: lane) total += value;
+                return total;
+            }
+        };
+#elif defined(__AVX2__)
+        template<>
+        struct simd<double> {
+            using vector = __m256d;
+            static constexpr size_t lanes = 4;
+            static vector zero() noexcept { return _mm256_setzero_pd(); }
+            static vector load(const double* values) noexcept { return _mm256_loadu_pd(values); }
+            static vector gather(const double* x, const vertex_id* index) noexcept {
+                __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(index));
+                return _mm256_mask_i32gather_pd(zero(), x, indices, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+            }
+            static vector add(vector first, vector second) noexcept { return _mm256_add_pd(first, second); }
+            static vector multiply(vector first, vector second) noexcept { return _mm256_mul_pd(first, second); }
+            static double sum(vector values) noexcept {
+                alignas(32) double lane[lanes];
+                _mm256_store_pd(lane, values);
+                return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+            }
+        };
+
+        template<>
+        struct simd<float> {
+            using vector = __m256;
+            static constexpr size_t lanes = 8;
+            static vector zero() noexcept { return _mm256_setzero_ps(); }
+            static vector load(const float* values) noexcept { return _mm256_loadu_ps(values); }
+            static vector gather(const float* x, const vertex_id* index) noexcept {
+                __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index));
+                return _mm256_mask_i32gather_ps(zero(), x, indices, _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+            }
+            static vector add(vector first, vector second) noexcept { return _mm256_add_ps(first, second); }
+            static vector multiply(vector first, vector second) noexcept { return _mm256_mul_ps(first, second); }
+            static float sum(vector values) noexcept {
+                alignas(32) float lane[lanes];
+                _mm256_store_ps(lane, values);
+                float total = 0;
+                for (float value: lane) total += value;
+                return total;
+            }
+        };
+#endif
+
+        /** @brief Checks if gather_sum and gather_dot have a SIMD path for T, with the instruction set the compiler targets. */
+        template<typename T>
+        constexpr bool has_simd() noexcept {
+#if defined(__AVX512F__) || defined(__AVX2__)
+            return std::is_same_v<T, double> || std::is_same_v<T, float>;
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * @brief Returns the sum of x[index[i]] for i in [0, count)
+         *
+         * @details For float and double, and if vectorized, gathers 8 or 16 values at a time with AVX-512 or 4 or
+         * 8 with AVX2, whichever the compiler targets (-mavx2, -mavx512f or -march=native); otherwise, and for the
+         * tail, it is the scalar loop. The gathers take signed 32-bit indices, so the caller only vectorizes graphs
+         * of fewer than 2^31 nodes.
+         */
+        template<bool vectorized, typename T>
+        T gather_sum(const T* x, const vertex_id* index, size_t count) noexcept {
+            size_t position = 0;
+            T total{};
+#if defined(__AVX512F__) || defined(__AVX2__)
+            if constexpr (vectorized && has_simd<T>()) {
+                using lane = simd<T>;
+                auto sum = lane::zero();
+                for (; position + lane::lanes <= count; position += lane::lanes) sum = lane::add(sum, lane::gather(x, index + position));
+                total = lane::sum(sum);
+            }
+#endif
+            for (; position < count; ++position) total += x[index[position]];
+            return total;
+        }
+
+        /** @brief Returns the sum of weight[i] * x[index[i]] for i in [0, count); vectorized as gather_sum when the weights are of type T. */
+        template<bool vectorized, typename T, typename weight_type>
+        T gather_dot(const T* x, const vertex_id* index, const weight_type* weight, size_t count) noexcept {
+            size_t position = 0;
+            T total{};
+#if defined(__AVX512F__) || defined(__AVX2__)
+            if constexpr (vectorized && has_simd<T>() && std::is_same_v<T, weight_type>) {
+                using lane = simd<T>;
+                auto sum = lane::zero();
+                for (; position + lane::lanes <= count; position += lane::lanes) {
+                    sum = lane::add(sum, lane::multiply(lane::load(weight + position), lane::gather(x, index + position)));
+                }
+                total = lane::sum(sum);
+            }
+#endif
+            for (; position < count; ++position) total += static_cast<T>(weight[position]) * x[index[position]];
+            return total;
+        }
+
+        /** @brief Checks if vertex ids fit the signed 32-bit indices of the gather instructions. */
+        inline bool gather_indices_fit(size_t size) noexcept {
+            return size <= static_cast<size_t>(std::numeric_limits<std::int32_t>::max());
+        }
+    }
+
+    /**
+     * @ingroup Ranking
+     * @brief Sparse matrix-vector product: y[u] is the sum over the edges u -> v of weight * x[v]
+     *
+     * @details Rows are split into edge-balanced chunks (see parallel_for_edges), and every row is a
+     * gather_sum-style dot product, vectorized when value_type and weight_type are both float or both double.
+     * @throws If x does not have one entry per node, throws GraphException.
+     */
+    template<typename key_type, typename node_value_type, typename weight_type, typename value_type>
+    void spmv(const CsrGraph<key_type, node_value_type, weight_type>& graph, const std::vector<value_type>& x, std::vector<value_type>& y, size_t threads = 0) {
+        if (x.size() != graph.size()) throw GraphException("Size mismatch");
+        if (threads == 0) threads = default_threads();
+        y.resize(graph.size());
+        if (graph.empty()) return;
+        auto const &offsets = graph.offsets();
+        const vertex_id* neighbors = graph.neighbors().data();
+        const weight_type* weights = graph.weights().data();
+        bool vectorized = detail::gather_indices_fit(graph.size());
+        parallel_for_edges(offsets, [&](size_t first, size_t last, size_t) {
+            for (size_t node = first; node < last; ++node) {
+                size_t begin = offsets[node];
+                size_t count = offsets[node + 1] - begin;
+                y[node] = vectorized ? detail::gather_dot<true>(x.data(), neighbors + begin, weights + begin, count)
+                                     : detail::gather_dot<false>(x.data(), neighbors + begin, weights + begin, count);
+            }
+        }, threads);
+    }
+
+    /**
+     * @ingroup Ranking
+     * @brief PageRank by pull-based power iteration
+     *
+     * @details
+     * Every iteration divides each rank by the out-degree of its node, then every node sums the shares of its
+     * in-neighbors from the transposed graph. The sums are vectorized gathers (see detail::gather_sum) when
+     * rank_type is float or double, and the rows are split into edge-balanced chunks. The rank of
+     * nodes without out-edges is spread evenly over all nodes. Edge weights are ignored.
+     *
+     * @param[in] graph The graph to rank
+     * @param[in] transposed graph.transpose()
+     */
+    template<typename rank_type = double, typename key_type, typename value_type, typename weight_type>
+    PageRankResult<rank_type> pagerank(const CsrGraph<key_type, value_type, weight_type>& graph,
+                                       const CsrGraph<key_type, value_type, weight_type>& transposed,
+                                       const PageRankOptions& options = {}) {
+        size_t size = graph.size();
+        PageRankResult<rank_type> result;
+        if (size == 0) return result;
+        size_t threads = options.threads == 0 ? default_threads() : options.threads;
+        auto damping = static_cast<rank_type>(options.damping);
+        auto nodes = static_cast<rank_type>(size);
+        auto const &in_offsets = transposed.offsets();
+        const vertex_id* in_neighbors = transposed.neighbors().data();
+        bool vectorized = detail::gather_indices_fit(size);
+
+        result.rank.assign(size, 1 / nodes);
+        std::vector<rank_type> share(size);
+        std::vector<rank_type> next(size);
+        std::vector<rank_type> partial(threads);
+        while (result.iterations < options.max_iterations) {
+            std::fill(partial.begin(), partial.end(), rank_type{});
+            parallel_for(0, size, [&](size_t first, size_t last, size_t worker) {
+                rank_type dangling{};
+                for (size_t node = first; node < last; ++node) {
+                    size_t degree = graph.degree_out_by_id(static_cast<vertex_id>(node));
+                    if (degree == 0) dangling += result.rank[node];
+                    share[node] = degree == 0 ? rank_type{} : result.rank[node] / static_cast<rank_type>(degree);
+                }
+                partial[worker] += dangling;
+            }, threads);
+            rank_type dangling{};
+            for (auto value: partial) dangling += value;
+            rank_type base = (1 - damping) / nodes + damping * dangling / nodes;
+
+            std::fill(partial.begin(), partial.end(), rank_type{});
+            parallel_for_edges(in_offsets, [&](size_t first, size_t last, size_t worker) {
+                rank_type error{};
+                for (size_t node = first; node < last; ++node) {
+                    size_t begin = in_offsets[node];
+                    size_t count = in_offsets[node + 1] - begin;
+                    rank_type sum = vectorized ? detail::gather_sum<true>(share.data(), in_neighbors + begin, count)
+                                               : detail::gather_sum<false>(share.data(), in_neighbors + begin, count);
+                    next[node] = base + damping * sum;
+                    error += std::abs(next[node] - result.rank[node]);
+                }
+                partial[worker] += error;
+            }, threads);
+            result.rank.swap(next);
+            ++result.iterations;
+            result.error = rank_type{};
+            for (auto value: partial) result.error += value;
+            if (result.error < static_cast<rank_type>(options.tolerance)) break;
+        }
+        return result;
+    }
+
+    /** @ingroup Ranking @brief PageRank; computes the transposed graph itself. */
+    template<typename rank_type = double, typename key_type, typename value_type, typename weight_type>
+    PageRankResult<rank_type> pagerank(const CsrGraph<key_type, value_type, weight_type>& graph, const PageRankOptions& options = {}) {
+        return pagerank<rank_type>(graph, graph.transpose(), options);
+    }
+
+    /**
+     * @ingroup Ranking
+     * @brief Personalized PageRank from a set of source nodes, by local residual pushes
+     *
+     * @details
+     * The Andersen-Chung-Lang push: every source starts with an equal share of residual mass. A node whose residual
+     * reaches epsilon times its out-degree keeps 1 - damping of it as score and pushes the rest evenly to its
+     * out-neighbors; a node without out-edges pushes it back to the sources. The work depends on epsilon and the
+     * neighborhood of the sources, not on the size of the graph, and scores and residuals are kept in hash maps, so
+     * a query touches only the nodes it reaches.
+     *
+     * @throws If a source id is out of range, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    PersonalizedPageRankResult personalized_pagerank(const CsrGraph<key_type, value_type, weight_type>& graph, const std::vector<vertex_id>& sources,
+                                                     const PersonalizedPageRankOptions& options = {}) {
+        PersonalizedPageRankResult result;
+        for (auto source: sources) {
+            if (source >= graph.size()) throw GraphException("Vertex not found");
+        }
+        if (sources.empty()) return result;
+        auto const &offsets = graph.offsets();
+        auto const &neighbors = graph.neighbors();
+        flat_hash_map<vertex_id, double> residual;
+        flat_hash_map<vertex_id, double> score;
+        std::vector<vertex_id> queue;
+
+        auto threshold = [&](vertex_id node) {
+            return options.epsilon * static_cast<double>(std::max<size_t>(1, offsets[node + 1] - offsets[node]));
+        };
+        auto add = [&](vertex_id node, double mass) {
+            double &value = residual[node];
+            bool active = value >= threshold(node);
+            value += mass;
+            if (!active && value >= threshold(node)) queue.push_back(node);
+        };
+
+        for (auto source: sources) add(source, 1.0 / static_cast<double>(sources.size()));
+        for (size_t head = 0; head < queue.size(); ++head) {
+            vertex_id node = queue[head];
+            double &value = residual[node];
+            if (value < threshold(node)) continue;
+            double mass = value;
+            value = 0;
+            ++result.pushes;
+            score[node] += (1 - options.damping) * mass;
+            double rest = options.damping * mass;
+            size_t degree = offsets[node + 1] - offsets[node];
+            if (degree == 0) {
+                for (auto source: sources) add(source, rest / static_cast<double>(sources.size()));
+            } else {
+                for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) add(neighbors[edge], rest / static_cast<double>(degree));
+            }
+        }
+
+        result.scores.assign(score.begin(), score.end());
+        std::sort(result.scores.begin(), result.scores.end(), [](auto const &first, auto const &second) {
+            return first.second != second.second ? first.second > second.second : first.first < second.first;
+        });
+        return result;
+    }
+
+    /** @ingroup Ranking @brief Personalized PageRank from a single source node. */
+    template<typename key_type, typename value_type, typename weight_type>
+    PersonalizedPageRankResult personalized_pagerank(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id source,
+                                                     const PersonalizedPageRankOptions& options = {}) {
+        return personalized_pagerank(graph, std::vector<vertex_id>{source}, options);
+    }
+}
@@ -0,0 +1,594 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace graph {
+    /**
+     * @defgroup Parallel Parallel execution
+     *
+     * @brief One shared work-stealing pool for every parallel algorithm
+     *
+     * @details parallel_for, parallel_for_edges and parallel_for_parts, and every algorithm built on them, run on
+     * Scheduler::shared(): a fixed set of worker threads that the calling thread joins for the length of a call.
+     * Several calls at once, from several threads or nested inside each other, share those workers instead of
+     * each starting their own, so a process never runs more threads than the pool has, plus its callers.
+     */
+
+    /**
+     * @ingroup Parallel
+     * @brief The CPUs of every NUMA node of the machine
+     *
+     * @details On Linux, read from /sys/devices/system/node. Elsewhere, or if that cannot be read, there is one
+     * node without CPUs, and nothing is pinned.
+     */
+    struct NumaTopology {
+        std::vector<std::vector<unsigned>> cpus; /**< @brief The CPU numbers of every node. */
+
+        size_t nodes() const noexcept { return cpus.size(); } /**< @brief Counts the NUMA nodes. */
+        /** @brief Returns the node that part of parts belongs to; consecutive parts share a node. */
+        size_t node_of(size_t part, size_t parts) const noexcept { return parts == 0 ? 0 : part * nodes() / parts; }
+
+        static const NumaTopology& system();
+    };
+
+    namespace detail {
+        /** @brief Parses a sysfs CPU list such as "0-3,8-11". */
+        inline std::vector<unsigned> parse_cpu_list(const std::string& list) {
+            std::vector<unsigned> cpus;
+            size_t position = 0;
+            while (position < list.size()) {
+                size_t end = list.find(',', position);
+                if (end == std::string::npos) end = list.size();
+                std::string range = list.substr(position, end - position);
+                size_t dash = range.find('-');
+                try {
+                    unsigned first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+                    unsigned last = dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+                    for (unsigned cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+                } catch (const std::exception&) {
+                    return {};
+                }
+                position = end + 1;
+            }
+            return cpus;
+        }
+
+        /**
+         * @brief Pins the calling thread to a set of CPUs for its lifetime, and restores the previous affinity when
+         * destroyed
+         *
+         * @details An empty set pins nothing.
+         */
+        class cpu_pin {
+        public:
+            explicit cpu_pin(const std::vector<unsigned>& cpus) noexcept {
+#if defined(__linux__)
+                if (cpus.empty()) return;
+                if (pthread_getaffinity_np(pthread_self(), sizeof(m_previous), &m_previous) != 0) return;
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (unsigned cpu: cpus) {
+                    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+                }
+                m_pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+                (void) cpus;
+#endif
+            }
+            cpu_pin(const cpu_pin&) = delete;
+            cpu_pin& operator=(const cpu_pin&) = delete;
+            ~cpu_pin() {
+#if defined(__linux__)
+                if (m_pinned) pthread_setaffinity_np(pthread_self(), sizeof(m_previous), &m_previous);
+#endif
+            }
+        private:
+#if defined(__linux__)
+            cpu_set_t m_previous;
+#endif
+            bool m_pinned = false;
+        };
+
+        /** @brief Pins the calling thread to the CPUs of a NUMA node, as cpu_pin. */
+        class numa_pin : public cpu_pin {
+        public:
+            numa_pin(const NumaTopology& topology, size_t node) noexcept
+                : cpu_pin(node < topology.nodes() ? topology.cpus[node] : std::vector<unsigned>{}) {}
+        };
+    }
+
+    /** @details Read once, on first use. */
+    inline const NumaTopology& NumaTopology::system() {
+        static const NumaTopology topology = [] {
+            NumaTopology result;
+#if defined(__linux__)
+            for (size_t node = 0;; ++node) {
+                std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                std::string list;
+                if (!file || !std::getline(file, list)) break;
+                result.cpus.push_back(detail::parse_cpu_list(list));
+            }
+#endif
+            if (result.cpus.empty()) result.cpus.emplace_back();
+            return result;
+        }();
+        return topology;
+    }
+
+    /** @ingroup Parallel @brief Where the workers of a Scheduler may run */
+    enum class Affinity {
+        none,  /**< @brief Workers are not pinned. */
+        numa,  /**< @brief Worker w runs on the CPUs of NUMA node NumaTopology::node_of(w, workers). */
+        cores  /**< @brief Worker w runs on one CPU, the CPUs taken in node order, wrapping around. */
+    };
+
+    /** @ingroup Parallel @brief Parameters of a Scheduler */
+    struct SchedulerOptions {
+        size_t workers = 0; /**< @brief The number of worker threads; 0 means one less than the hardware threads. */
+        Affinity affinity = Affinity::none; /**< @brief Where the workers run. */
+    };
+
+    namespace detail {
+        /** @brief A call is split into this many chunks per participant, so that stealing has something to even out. */
+        constexpr size_t chunks_per_worker = 8;
+
+        /**
+         * @brief The chunks a participant of a job has left, [front, back), packed into one word
+         *
+         * @details The owner takes chunks from the front and thieves take the back half of what is left, each with
+         * one compare-and-swap. A range only ever gains chunks no one else holds, and only when it is empty, so an
+         * exchange cannot succeed on a range that changed and changed back.
+         */
+        struct alignas(64) chunk_deque {
+            std::atomic<std::uint64_t> range{0};
+
+            static std::uint64_t pack(size_t front, size_t back) noexcept {
+                return static_cast<std::uint64_t>(back) << 32 | static_cast<std::uint64_t>(front);
+            }
+
+            /** @brief Replaces the range; only the owner calls this, and only when the range is empty. */
+            void assign(size_t front, size_t back) noexcept { range.store(pack(front, back), std::memory_order_release); }
+
+            /** @brief Takes the front chunk. */
+            bool pop(size_t& chunk) noexcept {
+                std::uint64_t current = range.load(std::memory_order_acquire);
+                for (;;) {
+                    size_t front = static_cast<size_t>(current & 0xffffffffu);
+                    size_t back = static_cast<size_t>(current >> 32);
+                    if (front >= back) return false;
+                    if (range.compare_exchange_weak(current, pack(front + 1, back), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        chunk = front;
+                        return true;
+                    }
+                }
+            }
+
+            /** @brief Takes the back half, rounded up, as [first, last). */
+            bool steal(size_t& first, size_t& last) noexcept {
+                std::uint64_t current = range.load(std::memory_order_acquire);
+                for (;;) {
+                    size_t front = static_cast<size_t>(current & 0xffffffffu);
+                    size_t back = static_cast<size_t>(current >> 32);
+                    if (front >= back) return false;
+                    size_t split = back - (back - front + 1) / 2;
+                    if (range.compare_exchange_weak(current, pack(front, split), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        first = split;
+                        last = back;
+                        return true;
+                    }
+                }
+            }
+        };
+
+        /** @brief One call to Scheduler::run; lives on the stack of the calling thread. */
+        struct scheduler_job {
+            explicit scheduler_job(size_t participants) : limit(participants), deques(participants) {}
+
+            void (*run)(void*, size_t, size_t) = nullptr; /**< @brief Calls the body of context on (chunk, worker). */
+            void* context = nullptr;
+            size_t limit;
+            std::vector<chunk_deque> deques; /**< @brief One per participant slot. */
+            size_t joined = 1; /**< @brief Slots taken; slot 0 is the caller. Guarded by the scheduler mutex. */
+            size_t active = 0; /**< @brief Workers still inside the job. Guarded by the scheduler mutex. */
+            bool queued = false; /**< @brief Guarded by the scheduler mutex. */
+            std::condition_variable finished;
+            std::atomic<bool> failed{false};
+            std::mutex error_mutex;
+            std::exception_ptr error;
+        };
+
+        template<typename function_type>
+        void run_chunk(void* context, size_t chunk, size_t worker) {
+            (*static_cast<function_type*>(context))(chunk, worker);
+        }
+    }
+
+    /**
+     * @ingroup Parallel
+     * @brief A pool of worker threads that run the chunks of parallel loops, stealing them from each other
+     *
+     * @details
+     * A call to run splits its work into chunks, hands each participant a contiguous share of them, and lets idle
+     * workers join until the call has as many participants as it asked for. Every participant works through its
+     * own share front to back, and when it runs out takes the back half of the share of another. A share is a
+     * pair of chunk indices in one atomic word, so taking a chunk is one compare-and-swap and a skewed chunk, such
+     * as the row of a hub, only delays the participant that has it.
+     *
+     * The calling thread is always participant 0 and never waits for a worker to become free, so nested calls,
+     * and several calls at once from different threads, make progress on however many workers are idle. The
+     * workers are started by the constructor and stopped by the destructor; use shared() unless a separate pool is
+     * really needed.
+     */
+    class Scheduler {
+    public:
+        explicit Scheduler(const SchedulerOptions& options = {});
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+        ~Scheduler();
+
+        size_t workers() const noexcept { return m_workers; } /**< @brief Counts the worker threads. */
+        /** @brief Returns the largest number of participants a call can have: the workers and the caller. */
+        size_t concurrency() const noexcept { return m_workers + 1; }
+        Affinity affinity() const noexcept { return m_affinity; } /**< @brief Returns where the workers run. */
+
+        template<typename function_type>
+        void run(size_t chunks, function_type&& body, size_t threads = 0);
+
+        static Scheduler& shared();
+        static bool configure(const SchedulerOptions& options);
+    private:
+        void work(detail::scheduler_job& job, size_t slot);
+        void serve(size_t worker);
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<detail::scheduler_job*> m_queue;
+        bool m_stop = false;
+        Affinity m_affinity;
+        size_t m_workers;
+        std::vector<std::thread> m_threads;
+    };
+
+    namespace detail {
+        /** @brief The options of the shared scheduler, and whether it was started already. */
+        struct shared_scheduler_state {
+            std::mutex mutex;
+            SchedulerOptions options;
+            bool started = false;
+        };
+
+        inline shared_scheduler_state& shared_scheduler() {
+            static shared_scheduler_state state;
+            return state;
+        }
+    }
+
+    inline Scheduler::Scheduler(const SchedulerOptions& options)
+        : m_affinity(options.affinity),
+          m_workers(options.workers == 0 ? std::max<size_t>(1, std::thread::hardware_concurrency()) - 1 : options.workers) {
+        m_threads.reserve(m_workers);
+        try {
+            for (size_t worker = 0; worker < m_workers; ++worker) m_threads.emplace_back([this, worker] { serve(worker); });
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto &thread: m_threads) thread.join();
+            m_threads.clear();
+            throw;
+        }
+    }
+
+    /** @details Waits for the workers to finish their chunks; no call may still be running on the scheduler. */
+    inline Scheduler::~Scheduler() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto &thread: m_threads) thread.join();
+    }
+
+    /**
+     * @brief Returns the scheduler shared by all algorithms, started on first use with the options of configure()
+     * @details It lives until the end of the program.
+     */
+    inline Scheduler& Scheduler::shared() {
+        static Scheduler scheduler([] {
+            auto &state = detail::shared_scheduler();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.started = true;
+            return state.options;
+        }());
+        return scheduler;
+    }
+
+    /**
+     * @brief Sets the worker count and affinity of the shared scheduler
+     * @return false, and changes nothing, if the shared scheduler was already started
+     */
+    inline bool Scheduler::configure(const SchedulerOptions& options) {
+        auto &state = detail::shared_scheduler();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.started) return false;
+        state.options = options;
+        return true;
+    }
+
+    /**
+     * @brief Calls body(chunk, worker) for every chunk in [0, chunks)
+     *
+     * @details At most threads participants, the caller included, take part, and worker is the slot of the
+     * participant in [0, threads), so it can index per-worker buffers; no two participants use the same slot at
+     * once. Returns when every chunk has run. If a chunk throws, no further chunks are started and the first
+     * exception is rethrown once the running ones have finished.
+     *
+     * @param[in] chunks The number of chunks, below 2^32
+     * @param[in] threads The largest number of participants; 0, or more than concurrency(), means concurrency()
+     */
+    template<typename function_type>
+    void Scheduler::run(size_t chunks, function_type&& body, size_t threads) {
+        if (threads == 0 || threads > concurrency()) threads = concurrency();
+        threads = std::min(threads, chunks);
+        if (threads == 0) return;
+        if (threads == 1) {
+            for (size_t chunk = 0; chunk < chunks; ++chunk) body(chunk, size_t{0});
+            return;
+        }
+
+        detail::scheduler_job job(threads);
+        job.run = &detail::run_chunk<std::remove_reference_t<function_type>>;
+        job.context = const_cast<void*>(static_cast<const void*>(std::addressof(body)));
+        for (size_t slot = 0; slot < threads; ++slot) job.deques[slot].assign(chunks * slot / threads, chunks * (slot + 1) / threads);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(&job);
+            job.queued = true;
+        }
+        if (threads - 1 >= workers()) {
+            m_wake.notify_all();
+        } else {
+            for (size_t helper = 1; helper < threads; ++helper) m_wake.notify_one();
+        }
+        work(job, 0);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (job.queued) {
+                m_queue.erase(std::find(m_queue.begin(), m_queue.end(), &job));
+                job.queued = false;
+            }
+            job.finished.wait(lock, [&] { return job.active == 0; });
+        }
+        if (job.error) std::rethrow_exception(job.error);
+    }
+
+    /** @details Runs the own chunks of the slot, then steals from the other slots, starting at the next one. */
+    inline void Scheduler::work(detail::scheduler_job& job, size_t slot) {
+        auto execute = [&](size_t chunk) {
+            try {
+                job.run(job.context, chunk, slot);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(job.error_mutex);
+                if (!job.error) job.error = std::current_exception();
+                job.failed.store(true, std::memory_order_relaxed);
+            }
+        };
+        while (!job.failed.load(std::memory_order_relaxed)) {
+            size_t chunk;
+            if (job.deques[slot].pop(chunk)) {
+                execute(chunk);
+                continue;
+            }
+            bool stolen = false;
+            for (size_t step = 1; step < job.limit && !stolen; ++step) {
+                size_t first;
+                size_t last;
+                if (!job.deques[(slot + step) % job.limit].steal(first, last)) continue;
+                job.deques[slot].assign(first + 1, last);
+                execute(first);
+                stolen = true;
+            }
+            if (!stolen) return;
+        }
+    }
+
+    /** @details The loop of worker thread worker: join the oldest job that still has a free slot, or sleep. */
+    inline void Scheduler::serve(size_t worker) {
+        std::vector<unsigned> cpus;
+        auto const &topology = NumaTopology::system();
+        if (m_affinity == Affinity::numa) {
+            cpus = topology.cpus[topology.node_of(worker, m_workers)];
+        } else if (m_affinity == Affinity::cores) {
+            std::vector<unsigned> all;
+            for (auto const &node: topology.cpus) all.insert(all.end(), node.begin(), node.end());
+            if (!all.empty()) cpus.push_back(all[worker % all.size()]);
+        }
+        detail::cpu_pin pinned(cpus);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            auto &job = *m_queue.front();
+            size_t slot = job.joined++;
+            ++job.active;
+            if (job.joined == job.limit) {
+                m_queue.pop_front();
+                job.queued = false;
+            }
+            lock.unlock();
+            work(job, slot);
+            lock.lock();
+            if (--job.active == 0) job.finished.notify_all();
+        }
+    }
+
+    /**
+     * @ingroup Parallel
+     * @brief Returns the number of workers used when an algorithm is not given one explicitly: the concurrency of
+     * the shared scheduler.
+     */
+    inline size_t default_threads() {
+        return Scheduler::shared().concurrency();
+    }
+
+    /**
+     * @ingroup Parallel
+     * @brief Runs body over [begin, end), split into chunks of the same length that the workers of the shared
+     * scheduler take and steal
+     *
+     * @details The body is called as body(first, last, worker), once per chunk and possibly several times per
+     * worker, with worker in [0, threads), so it can index per-worker buffers. With one worker the body is called
+     * once on the whole range. See Scheduler::run for exceptions.
+     *
+     * @param[in] threads The number of workers; 0 means default_threads()
+     */
+    template<typename function_type>
+    void parallel_for(size_t begin, size_t end, function_type&& body, size_t threads = 0) {
+        if (end <= begin) return;
+        auto &scheduler = Scheduler::shared();
+        if (threads == 0 || threads > scheduler.concurrency()) threads = scheduler.concurrency();
+        size_t count = end - begin;
+        if (threads == 1 || count == 1) {
+            body(begin, end, size_t{0});
+            return;
+        }
+        size_t chunks = std::min(count, threads * detail::chunks_per_worker);
+        scheduler.run(chunks, [&](size_t chunk, size_t worker) {
+            body(begin + count * chunk / chunks, begin + count * (chunk + 1) / chunks, worker);
+        }, threads);
+    }
+
+    /**
+     * @ingroup Parallel
+     * @brief Runs body(part) once for each of parts parts on the shared scheduler, each pinned to the NUMA node of
+     * the part while it runs
+     *
+     * @details Memory a part first writes is then placed on its node by the kernel's first-touch policy, and a
+     * later call runs the part on the same node again. Part p runs on node NumaTopology::node_of(p, parts). The
+     * worker that runs a part gets its affinity back afterwards. Exceptions are handled as in parallel_for.
+     *
+     * @param[in] pin If false, the parts are not pinned
+     */
+    template<typename function_type>
+    void parallel_for_parts(size_t parts, function_type&& body, bool pin = true) {
+        auto const &topology = NumaTopology::system();
+        Scheduler::shared().run(parts, [&](size_t part, size_t) {
+            if (!pin) {
+                body(part);
+                return;
+            }
+            detail::numa_pin pinned(topology, topology.node_of(part, parts));
+            body(part);
+        }, parts);
+    }
+
+    /**
+     * @ingroup Parallel
+     * @brief Splits the rows of a CSR offset array into blocks of about the same number of nodes plus edges
+     *
+     * @details Splitting by node count alone gives one worker all the hubs of a skewed graph. Here a row costs its
+     * number of edges plus one, and block boundaries are found by binary search over the offsets.
+     *
+     * @param[in] offsets A CSR offset array, rows + 1 entries
+     * @param[in] parts The number of blocks
+     * @return parts + 1 row boundaries; block b is the rows [result[b], result[b + 1])
+     */
+    template<typename offsets_type>
+    std::vector<size_t> balanced_blocks(const offsets_type& offsets, size_t parts) {
+        size_t rows = offsets.size() - 1;
+        size_t total = static_cast<size_t>(offsets[rows] - offsets[0]) + rows;
+        std::vector<size_t> result(parts + 1, rows);
+        result[0] = 0;
+        for (size_t part = 1; part < parts; ++part) {
+            size_t target = total / parts * part + total % parts * part / parts;
+            size_t low = result[part - 1];
+            size_t high = rows;
+            while (low < high) {
+                size_t middle = low + (high - low) / 2;
+                if (static_cast<size_t>(offsets[middle] - offsets[0]) + middle < target) low = middle + 1;
+                else high = middle;
+            }
+            result[part] = low;
+        }
+        return result;
+    }
+
+    /**
+     * @ingroup Parallel
+     * @brief Runs body(first, last, worker) over the rows of a CSR offset array, in chunks of about the same number
+     * of nodes plus edges (see balanced_blocks) that the workers of the shared scheduler take and steal
+     *
+     * @details A row is never split, so a hub gets a chunk of its own and the rest of its share goes to the
+     * other workers. Chunks left empty by a hub are skipped. Otherwise as parallel_for.
+     *
+     * @param[in] offsets A CSR offset array, rows + 1 entries
+     * @param[in] threads The number of workers; 0 means default_threads()
+     */
+    template<typename offsets_type, typename function_type>
+    void parallel_for_edges(const offsets_type& offsets, function_type&& body, size_t threads = 0) {
+        size_t rows = offsets.size() - 1;
+        if (rows == 0) return;
+        auto &scheduler = Scheduler::shared();
+        if (threads == 0 || threads > scheduler.concurrency()) threads = scheduler.concurrency();
+        if (threads == 1) {
+            body(size_t{0}, rows, size_t{0});
+            return;
+        }
+        auto blocks = balanced_blocks(offsets, std::min(rows, threads * detail::chunks_per_worker));
+        scheduler.run(blocks.size() - 1, [&](size_t chunk, size_t worker) {
+            if (blocks[chunk] < blocks[chunk + 1]) body(blocks[chunk], blocks[chunk + 1], worker);
+        }, threads);
+    }
+
+    /**
+     * @ingroup Parallel
+     * @brief Sorts [first, last) with compare, in parallel parts that are then merged pairwise in parallel rounds
+     *
+     * @details Splits the range into one part per worker, sorts the parts with std::sort, and merges neighboring
+     * runs with std::inplace_merge until one is left; so it is not stable. Small ranges are sorted on the caller.
+     *
+     * @param[in] threads The number of workers; 0 means default_threads()
+     */
+    template<typename iterator_type, typename compare_type>
+    void parallel_sort(iterator_type first, iterator_type last, compare_type compare, size_t threads = 0) {
+        auto &scheduler = Scheduler::shared();
+        if (threads == 0 || threads > scheduler.concurrency()) threads = scheduler.concurrency();
+        auto count = static_cast<size_t>(last - first);
+        size_t parts = std::min(threads, count / 4096);
+        if (parts <= 1) {
+            std::sort(first, last, compare);
+            return;
+        }
+        std::vector<iterator_type> bounds(parts + 1);
+        for (size_t part = 0; part <= parts; ++part) bounds[part] = first + static_cast<std::ptrdiff_t>(count * part / parts);
+        scheduler.run(parts, [&](size_t part, size_t) { std::sort(bounds[part], bounds[part + 1], compare); }, threads);
+        for (size_t width = 1; width < parts; width *= 2) {
+            size_t merges = (parts + 2 * width - 1) / (2 * width);
+            scheduler.run(merges, [&](size_t merge, size_t) {
+                size_t low = merge * 2 * width;
+                if (low + width >= parts) return;
+                std::inplace_merge(bounds[low], bounds[low + width], bounds[std::min(low + 2 * width, parts)], compare);
+            }, threads);
+        }
+    }
+}
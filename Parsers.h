@@ -0,0 +1,427 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Generators.h"
+#include "Graph.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Storage.h"
+
+namespace graph {
+    /**
+     * @defgroup Parsers Parsers
+     *
+     * @brief Loaders for text graph formats
+     *
+     * @details
+     * The input is cut into chunks of about ParseOptions::chunk_size bytes at line boundaries, and the chunks are
+     * parsed in parallel with std::from_chars. The edges come out in file order whatever the number of threads.
+     * Keys must be integers. Edges without a weight get weight 1; with graph::empty weights, the weights in the file
+     * are checked and dropped. Anything but a comment left on a line after its last field is a parse error, as is
+     * a number of the wrong type, such as 3.7 for an integer weight.
+     */
+
+    /** @ingroup Parsers @brief Supported text formats. */
+    enum class TextFormat {
+        edge_list, /**< @brief One "source target [weight]" per line; lines starting with # or % are comments. */
+        snap, /**< @brief SNAP edge lists: the edge list format with a # comment header. */
+        matrix_market, /**< @brief Matrix Market coordinate matrices; entry (i, j) is the edge i -> j, keys are 1-based. */
+        metis /**< @brief METIS graphs; line i lists the neighbors of node i, keys are 1-based. */
+    };
+
+    /** @ingroup Parsers @brief Tuning knobs of the parsers. */
+    struct ParseOptions {
+        size_t threads = 0; /**< @brief The number of workers; 0 means default_threads(). */
+        size_t chunk_size = size_t{1} << 20; /**< @brief Approximate number of bytes parsed by one task. */
+    };
+
+    /** @ingroup Parsers @brief Nodes and edges read from a file. */
+    template<typename key_type, typename weight_type>
+    struct ParsedGraph {
+        std::vector<key_type> nodes; /**< @brief Every node, including isolated ones where the format lists them, sorted by key. */
+        EdgeList<key_type, weight_type> edges; /**< @brief Every edge, in file order. */
+    };
+
+    namespace detail {
+        /** @brief Reads whitespace-separated numbers from one line. */
+        struct text_cursor {
+            const char* position;
+            const char* end;
+
+            void skip_blanks() noexcept {
+                while (position != end && (*position == ' ' || *position == '\t' || *position == '\r')) ++position;
+            }
+            /** @brief Skips blanks and checks if the line has nothing left but a comment. */
+            bool done() noexcept {
+                skip_blanks();
+                return position == end || *position == '#' || *position == '%';
+            }
+            /** @brief Throws if anything but blanks or a comment is left on the line. */
+            void finish() {
+                if (!done()) throw GraphException("Parse error");
+            }
+            template<typename T>
+            bool parse(T& value) noexcept {
+                skip_blanks();
+                if (position != end && *position == '+') ++position;
+                auto [next, error] = std::from_chars(position, end, value);
+                if (error != std::errc{}) return false;
+                position = next;
+                return true;
+            }
+            /** @brief Checks that a number follows and drops it, for graphs without weights. */
+            bool parse(empty&) noexcept {
+                double ignored;
+                return parse(ignored);
+            }
+            template<typename T>
+            void expect(T& value) {
+                if (!parse(value)) throw GraphException("Parse error");
+            }
+        };
+
+        /** @brief The weight of an edge the file lists without one. */
+        template<typename weight_type>
+        weight_type unit_weight() {
+            if constexpr (std::is_same_v<weight_type, empty>) return {};
+            else return weight_type{1};
+        }
+
+        /** @brief The weight of the mirrored entry of a skew-symmetric matrix. */
+        template<typename weight_type>
+        weight_type negated(const weight_type& weight) {
+            if constexpr (std::is_same_v<weight_type, empty>) return weight;
+            else return static_cast<weight_type>(-weight);
+        }
+
+        /** @brief Calls f(first, last) for every line of [first, last), without the newline; a final newline does not start an empty line. */
+        template<typename function_type>
+        void for_each_line(const char* first, const char* last, function_type&& f) {
+            while (first != last) {
+                auto newline = static_cast<const char*>(std::memchr(first, '\n', static_cast<size_t>(last - first)));
+                f(first, newline == nullptr ? last : newline);
+                first = newline == nullptr ? last : newline + 1;
+            }
+        }
+
+        /** @brief Cuts text into chunks of about chunk_size bytes that each end after a newline; returns the chunk starts plus the end. */
+        inline std::vector<size_t> chunk_bounds(std::string_view text, size_t chunk_size) {
+            std::vector<size_t> bounds{0};
+            size_t position = std::max<size_t>(chunk_size, 1);
+            while (position < text.size()) {
+                size_t newline = text.find('\n', position - 1);
+                if (newline == std::string_view::npos || newline + 1 == text.size()) break;
+                bounds.push_back(newline + 1);
+                position = newline + 1 + std::max<size_t>(chunk_size, 1);
+            }
+            if (bounds.back() != text.size()) bounds.push_back(text.size());
+            return bounds;
+        }
+
+        /** @brief Runs parse_chunk(chunk, first, last, edges) on every chunk in parallel and concatenates the edges in chunk order. */
+        template<typename edge_type, typename parser_type>
+        std::vector<edge_type> parse_chunks(std::string_view text, const std::vector<size_t>& bounds, size_t threads, parser_type&& parse_chunk) {
+            size_t chunks = bounds.size() - 1;
+            std::vector<std::vector<edge_type>> parts(chunks);
+            parallel_for(0, chunks, [&](size_t first, size_t last, size_t) {
+                for (size_t chunk = first; chunk < last; ++chunk) {
+                    parse_chunk(chunk, text.data() + bounds[chunk], text.data() + bounds[chunk + 1], parts[chunk]);
+                }
+            }, threads);
+
+            std::vector<size_t> starts(chunks + 1, 0);
+            for (size_t chunk = 0; chunk < chunks; ++chunk) starts[chunk + 1] = starts[chunk] + parts[chunk].size();
+            std::vector<edge_type> result(starts.back());
+            parallel_for(0, chunks, [&](size_t first, size_t last, size_t) {
+                for (size_t chunk = first; chunk < last; ++chunk) {
+                    std::move(parts[chunk].begin(), parts[chunk].end(), result.begin() + static_cast<std::ptrdiff_t>(starts[chunk]));
+                    std::vector<edge_type>().swap(parts[chunk]);
+                }
+            }, threads);
+            return result;
+        }
+
+        /**
+         * @brief Returns the distinct endpoints of the edges, sorted
+         * @details The edges are split into one share per worker, and the endpoints of a share are collected in a
+         * hash set so that only the distinct ones are sorted; the sorted runs are then merged pairwise.
+         */
+        template<typename key_type, typename weight_type>
+        std::vector<key_type> distinct_endpoints(const EdgeList<key_type, weight_type>& edges, size_t threads) {
+            std::vector<std::vector<key_type>> runs(std::max<size_t>(1, std::min(threads, edges.size())));
+            parallel_for(0, runs.size(), [&](size_t first, size_t last, size_t) {
+                for (size_t index = first; index < last; ++index) {
+                    flat_hash_set<key_type> seen;
+                    for (size_t edge = edges.size() * index / runs.size(); edge < edges.size() * (index + 1) / runs.size(); ++edge) {
+                        seen.insert(edges[edge].first.first);
+                        seen.insert(edges[edge].first.second);
+                    }
+                    auto &run = runs[index];
+                    run.assign(seen.begin(), seen.end());
+                    std::sort(run.begin(), run.end());
+                }
+            }, threads);
+
+            while (runs.size() > 1) {
+                std::vector<std::vector<key_type>> merged((runs.size() + 1) / 2);
+                parallel_for(0, merged.size(), [&](size_t first, size_t last, size_t) {
+                    for (size_t pair = first; pair < last; ++pair) {
+                        if (2 * pair + 1 == runs.size()) {
+                            merged[pair] = std::move(runs[2 * pair]);
+                            continue;
+                        }
+                        auto &left = runs[2 * pair];
+                        auto &right = runs[2 * pair + 1];
+                        merged[pair].reserve(left.size() + right.size());
+                        std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(merged[pair]));
+                    }
+                }, threads);
+                runs = std::move(merged);
+            }
+            return runs.empty() ? std::vector<key_type>{} : std::move(runs.front());
+        }
+
+        template<typename key_type>
+        std::vector<key_type> key_range(size_t count) {
+            std::vector<key_type> keys(count);
+            for (size_t key = 0; key < count; ++key) keys[key] = static_cast<key_type>(key + 1);
+            return keys;
+        }
+
+        template<typename key_type, typename weight_type>
+        ParsedGraph<key_type, weight_type> parse_edge_list(std::string_view text, size_t chunk_size, size_t threads) {
+            using edge_type = typename EdgeList<key_type, weight_type>::value_type;
+            ParsedGraph<key_type, weight_type> result;
+            result.edges = parse_chunks<edge_type>(text, chunk_bounds(text, chunk_size), threads,
+                                                   [](size_t, const char* first, const char* last, std::vector<edge_type>& edges) {
+                for_each_line(first, last, [&edges](const char* line, const char* end) {
+                    text_cursor cursor{line, end};
+                    if (cursor.done()) return;
+                    key_type source{};
+                    key_type target{};
+                    weight_type weight = unit_weight<weight_type>();
+                    cursor.expect(source);
+                    cursor.expect(target);
+                    if (!cursor.done()) cursor.expect(weight);
+                    cursor.finish();
+                    edges.push_back({{source, target}, weight});
+                });
+            });
+            result.nodes = distinct_endpoints(result.edges, threads);
+            return result;
+        }
+
+        /**
+         * @details Reads the banner and the size line serially, then the entries in parallel. Symmetric and
+         * skew-symmetric matrices store one triangle; the mirrored edge is added for every off-diagonal entry. The
+         * number of entry lines must be the one the size line declares.
+         */
+        template<typename key_type, typename weight_type>
+        ParsedGraph<key_type, weight_type> parse_matrix_market(std::string_view text, size_t chunk_size, size_t threads) {
+            using edge_type = typename EdgeList<key_type, weight_type>::value_type;
+            auto line_end = [&text](size_t position) { return std::min(text.find('\n', position), text.size()); };
+            auto lower = [](std::string_view word) {
+                std::string result(word);
+                for (auto &letter: result) letter = static_cast<char>(letter >= 'A' && letter <= 'Z' ? letter - 'A' + 'a' : letter);
+                return result;
+            };
+
+            size_t end = line_end(0);
+            std::vector<std::string> banner;
+            for (size_t position = 0; position < end;) {
+                size_t next = std::min(text.find_first_of(" \t\r", position), end);
+                if (next > position) banner.push_back(lower(text.substr(position, next - position)));
+                position = next + 1;
+            }
+            if (banner.size() != 5 || banner[0] != "%%matrixmarket" || banner[1] != "matrix" || banner[2] != "coordinate") {
+                throw GraphException("Parse error");
+            }
+            bool pattern = banner[3] == "pattern";
+            if (!pattern && banner[3] != "real" && banner[3] != "double" && banner[3] != "integer") throw GraphException("Parse error");
+            bool symmetric = banner[4] == "symmetric";
+            bool skew = banner[4] == "skew-symmetric";
+            if (!symmetric && !skew && banner[4] != "general") throw GraphException("Parse error");
+
+            size_t rows = 0;
+            size_t columns = 0;
+            size_t entries = 0;
+            size_t position = std::min(end + 1, text.size());
+            for (;; position = std::min(end + 1, text.size())) {
+                if (position == text.size()) throw GraphException("Parse error");
+                end = line_end(position);
+                text_cursor cursor{text.data() + position, text.data() + end};
+                if (cursor.done()) continue;
+                cursor.expect(rows);
+                cursor.expect(columns);
+                cursor.expect(entries);
+                cursor.finish();
+                position = std::min(end + 1, text.size());
+                break;
+            }
+
+            ParsedGraph<key_type, weight_type> result;
+            auto body = text.substr(position);
+            auto bounds = chunk_bounds(body, chunk_size);
+            std::vector<size_t> parsed(bounds.size(), 0);
+            result.edges = parse_chunks<edge_type>(body, bounds, threads,
+                                                   [&](size_t chunk, const char* first, const char* last, std::vector<edge_type>& edges) {
+                for_each_line(first, last, [&](const char* line, const char* line_last) {
+                    text_cursor cursor{line, line_last};
+                    if (cursor.done()) return;
+                    size_t row = 0;
+                    size_t column = 0;
+                    weight_type weight = unit_weight<weight_type>();
+                    cursor.expect(row);
+                    cursor.expect(column);
+                    if (!pattern) cursor.expect(weight);
+                    cursor.finish();
+                    ++parsed[chunk];
+                    if (row == 0 || row > rows || column == 0 || column > columns) throw GraphException("Parse error");
+                    edges.push_back({{static_cast<key_type>(row), static_cast<key_type>(column)}, weight});
+                    if ((symmetric || skew) && row != column) {
+                        edges.push_back({{static_cast<key_type>(column), static_cast<key_type>(row)}, skew ? negated(weight) : weight});
+                    }
+                });
+            });
+            if (std::accumulate(parsed.begin(), parsed.end(), size_t{0}) != entries) throw GraphException("Parse error");
+            result.nodes = key_range<key_type>(std::max(rows, columns));
+            return result;
+        }
+
+        /**
+         * @details METIS lines are numbered, so an empty line is a node without edges and only comment lines are
+         * skipped. A first parallel pass counts the node lines of every chunk to find the node each chunk starts
+         * at. Every line lists the neighbors of one node, so an undirected graph gives both directions of each edge.
+         */
+        template<typename key_type, typename weight_type>
+        ParsedGraph<key_type, weight_type> parse_metis(std::string_view text, size_t chunk_size, size_t threads) {
+            using edge_type = typename EdgeList<key_type, weight_type>::value_type;
+            auto is_comment = [](const char* line, const char* end) {
+                text_cursor cursor{line, end};
+                cursor.skip_blanks();
+                return cursor.position != end && *cursor.position == '%';
+            };
+
+            size_t nodes = 0;
+            size_t edge_count = 0;
+            size_t format = 0;
+            size_t constraints = 0;
+            size_t position = 0;
+            for (;;) {
+                if (position == text.size()) throw GraphException("Parse error");
+                size_t end = std::min(text.find('\n', position), text.size());
+                text_cursor cursor{text.data() + position, text.data() + end};
+                position = std::min(end + 1, text.size());
+                if (cursor.done()) continue;
+                cursor.expect(nodes);
+                cursor.expect(edge_count);
+                if (!cursor.done()) cursor.expect(format);
+                if (!cursor.done()) cursor.expect(constraints);
+                break;
+            }
+            bool edge_weights = format % 10 == 1;
+            if ((format / 10) % 10 == 1 && constraints == 0) constraints = 1;
+            if ((format / 10) % 10 != 1) constraints = 0;
+            size_t skipped = (format / 100) % 10 == 1 ? constraints + 1 : constraints;
+
+            auto body = text.substr(position);
+            auto bounds = chunk_bounds(body, chunk_size);
+            size_t chunks = bounds.size() - 1;
+            std::vector<size_t> first_node(chunks + 1, 0);
+            parallel_for(0, chunks, [&](size_t first, size_t last, size_t) {
+                for (size_t chunk = first; chunk < last; ++chunk) {
+                    for_each_line(body.data() + bounds[chunk], body.data() + bounds[chunk + 1], [&](const char* line, const char* end) {
+                        if (!is_comment(line, end)) ++first_node[chunk + 1];
+                    });
+                }
+            }, threads);
+            for (size_t chunk = 0; chunk < chunks; ++chunk) first_node[chunk + 1] += first_node[chunk];
+
+            ParsedGraph<key_type, weight_type> result;
+            result.edges = parse_chunks<edge_type>(body, bounds, threads,
+                                                   [&](size_t chunk, const char* first, const char* last, std::vector<edge_type>& edges) {
+                size_t node = first_node[chunk];
+                for_each_line(first, last, [&](const char* line, const char* end) {
+                    if (is_comment(line, end)) return;
+                    text_cursor cursor{line, end};
+                    ++node;
+                    if (node > nodes) {
+                        if (cursor.done()) return;
+                        throw GraphException("Parse error");
+                    }
+                    for (size_t field = 0; field < skipped; ++field) {
+                        size_t ignored = 0;
+                        cursor.expect(ignored);
+                    }
+                    while (!cursor.done()) {
+                        size_t neighbor = 0;
+                        weight_type weight = unit_weight<weight_type>();
+                        cursor.expect(neighbor);
+                        if (edge_weights) cursor.expect(weight);
+                        if (neighbor == 0 || neighbor > nodes) throw GraphException("Parse error");
+                        edges.push_back({{static_cast<key_type>(node), static_cast<key_type>(neighbor)}, weight});
+                    }
+                });
+            });
+            result.nodes = key_range<key_type>(nodes);
+            return result;
+        }
+    }
+
+    /**
+     * @ingroup Parsers
+     * @brief Parses a graph from text
+     * @throws If the text is malformed, throws GraphException.
+     */
+    template<typename key_type, typename weight_type>
+    ParsedGraph<key_type, weight_type> parse_graph(std::string_view text, TextFormat format, const ParseOptions& options = {}) {
+        static_assert(std::is_integral_v<key_type>, "The parsers read integer keys");
+        size_t threads = options.threads == 0 ? default_threads() : options.threads;
+        switch (format) {
+            case TextFormat::matrix_market: return detail::parse_matrix_market<key_type, weight_type>(text, options.chunk_size, threads);
+            case TextFormat::metis: return detail::parse_metis<key_type, weight_type>(text, options.chunk_size, threads);
+            default: return detail::parse_edge_list<key_type, weight_type>(text, options.chunk_size, threads);
+        }
+    }
+
+    /**
+     * @ingroup Parsers
+     * @brief Parses a graph file; the file is memory-mapped, not copied
+     * @throws If the file cannot be read or is malformed, throws GraphException.
+     */
+    template<typename key_type, typename weight_type>
+    ParsedGraph<key_type, weight_type> read_graph(const std::string& path, TextFormat format, const ParseOptions& options = {}) {
+        detail::mapped_file file(path);
+        return parse_graph<key_type, weight_type>(std::string_view(file.data(), file.size()), format, options);
+    }
+
+    /**
+     * @ingroup Parsers
+     * @brief Reads a graph file into a Graph
+     *
+     * @details Nodes missing from the graph are added in key order with a default value, then the edges are added
+     * with Graph::insert_edges. Edges that are already in the graph are kept as they are.
+     *
+     * @returns The result of Graph::insert_edges.
+     * @throws If the file cannot be read or is malformed, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    BulkInsertResult load_graph(Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, const std::string& path,
+                                TextFormat format, const ParseOptions& options = {}) {
+        auto parsed = read_graph<key_type, weight_type>(path, format, options);
+        graph.reserve(graph.size() + parsed.nodes.size());
+        for (auto const &key: parsed.nodes) graph.insert_node(key, value_type{});
+        return graph.insert_edges(parsed.edges);
+    }
+}
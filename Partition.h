@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "PageRank.h"
+#include "Parallel.h"
+
+namespace graph {
+    /**
+     * @ingroup Frozen
+     * @brief How a PartitionedCsr splits a graph and places the parts
+     */
+    struct PartitionOptions {
+        size_t parts = 0; /**< @brief The number of parts; 0 means one per NUMA node. */
+        bool pin = true; /**< @brief Build and process every part on workers pinned to its NUMA node. */
+    };
+
+    /**
+     * @ingroup Frozen
+     * @brief The rows of a CsrGraph split into vertex ranges, each stored on its own NUMA node
+     *
+     * @details
+     * The ranges are edge-balanced (see balanced_blocks), so every part holds about the same number of nodes plus
+     * edges. Each part is a small CSR of its own: local offsets, and the global ids and the weights of its edges.
+     * The arrays of a part are allocated and first written by a worker pinned to the part's node (see
+     * parallel_for_parts), so the kernel places their pages there, and for_each_part runs every part on a worker of
+     * the same node again. Kernels that write one value per node should first-touch those arrays by part as well.
+     *
+     * Ordering the nodes by locality first (for example by BFS order) lowers the edge cut of the ranges.
+     *
+     * @tparam weight_type - type of the weight of the edge
+     */
+    template<typename weight_type>
+    class PartitionedCsr {
+    public:
+        /** @brief One vertex range and its rows. */
+        struct Part {
+            vertex_id first = 0; /**< @brief The first node of the range. */
+            vertex_id last = 0; /**< @brief One past the last node of the range. */
+            size_t node = 0; /**< @brief The NUMA node the part is placed on. */
+            size_t cut = 0; /**< @brief The number of edges that lead to a node of another part. */
+            std::vector<size_t> offsets; /**< @brief Row starts relative to the part, last - first + 1 entries. */
+            std::vector<vertex_id> neighbors; /**< @brief Global target ids of the edges of the part. */
+            std::vector<weight_type> weights; /**< @brief Weights of the edges of the part, parallel to neighbors. */
+
+            size_t size() const noexcept { return last - first; } /**< @brief Counts the nodes of the part. */
+            size_t edge_count() const noexcept { return neighbors.size(); } /**< @brief Counts the edges of the part. */
+        };
+
+        PartitionedCsr() = default;
+        template<typename key_type, typename value_type>
+        explicit PartitionedCsr(const CsrGraph<key_type, value_type, weight_type>& graph, const PartitionOptions& options = {});
+
+        size_t size() const noexcept { return m_size; } /**< @brief Counts the nodes. */
+        size_t edge_count() const noexcept { return m_edges; } /**< @brief Counts the edges. */
+        size_t edge_cut() const noexcept; /**< @brief Counts the edges between nodes of different parts. */
+        bool pinned() const noexcept { return m_pin; } /**< @brief Checks if the parts are processed on pinned workers. */
+
+        const std::vector<Part>& parts() const noexcept { return m_parts; } /**< @brief Returns the parts, in node order. */
+        size_t part_of(vertex_id id) const noexcept;
+
+        /** @brief Runs body(part, index) for every part, each on a worker of the part's NUMA node. */
+        template<typename function_type>
+        void for_each_part(function_type&& body) const {
+            parallel_for_parts(m_parts.size(), [&](size_t index) { body(m_parts[index], index); }, m_pin);
+        }
+    private:
+        std::vector<Part> m_parts;
+        size_t m_size = 0;
+        size_t m_edges = 0;
+        bool m_pin = true;
+    };
+
+    /** @details Each part copies its rows from the graph on a worker pinned to its node. */
+    template<typename weight_type>
+    template<typename key_type, typename value_type>
+    PartitionedCsr<weight_type>::PartitionedCsr(const CsrGraph<key_type, value_type, weight_type>& graph, const PartitionOptions& options)
+        : m_size(graph.size()), m_edges(graph.edge_count()), m_pin(options.pin) {
+        auto const &topology = NumaTopology::system();
+        size_t parts = options.parts == 0 ? topology.nodes() : options.parts;
+        auto const &offsets = graph.offsets();
+        auto bounds = balanced_blocks(offsets, parts);
+        m_parts.resize(parts);
+        parallel_for_parts(parts, [&](size_t index) {
+            Part &part = m_parts[index];
+            part.first = static_cast<vertex_id>(bounds[index]);
+            part.last = static_cast<vertex_id>(bounds[index + 1]);
+            part.node = topology.node_of(index, parts);
+            size_t begin = offsets[part.first];
+            size_t end = offsets[part.last];
+            part.offsets.resize(part.size() + 1);
+            for (size_t row = 0; row <= part.size(); ++row) part.offsets[row] = offsets[part.first + row] - begin;
+            part.neighbors.assign(graph.neighbors().begin() + static_cast<std::ptrdiff_t>(begin), graph.neighbors().begin() + static_cast<std::ptrdiff_t>(end));
+            part.weights.assign(graph.weights().begin() + static_cast<std::ptrdiff_t>(begin), graph.weights().begin() + static_cast<std::ptrdiff_t>(end));
+            for (auto target: part.neighbors) part.cut += target < part.first || target >= part.last;
+        }, options.pin);
+    }
+
+    template<typename weight_type>
+    size_t PartitionedCsr<weight_type>::edge_cut() const noexcept {
+        size_t cut = 0;
+        for (auto const &part: m_parts) cut += part.cut;
+        return cut;
+    }
+
+    /** @brief Returns the index of the part that holds the given node. */
+    template<typename weight_type>
+    size_t PartitionedCsr<weight_type>::part_of(vertex_id id) const noexcept {
+        auto found = std::upper_bound(m_parts.begin(), m_parts.end(), id, [](vertex_id value, const Part& part) { return value < part.last; });
+        return static_cast<size_t>(found - m_parts.begin());
+    }
+
+    /**
+     * @ingroup Ranking
+     * @brief PageRank on a partitioned transposed graph, with every part and its share of the rank arrays on its
+     * own NUMA node
+     *
+     * @details The same iteration as pagerank(graph, transposed, options), but the nodes of each part are updated
+     * by a worker pinned to the part's node, and the rank arrays are first written by part, so the only remote
+     * accesses are the gathers of the shares of in-neighbors in other parts. PageRankOptions::threads is ignored;
+     * the parts are the chunks of the shared scheduler.
+     *
+     * @param[in] graph The graph to rank; only its out-degrees are read
+     * @param[in] transposed graph.transpose(), partitioned
+     * @throws If the graphs do not have the same number of nodes, throws GraphException.
+     */
+    template<typename rank_type = double, typename key_type, typename value_type, typename weight_type>
+    PageRankResult<rank_type> pagerank(const CsrGraph<key_type, value_type, weight_type>& graph, const PartitionedCsr<weight_type>& transposed,
+                                       const PageRankOptions& options = {}) {
+        size_t size = graph.size();
+        if (transposed.size() != size) throw GraphException("Size mismatch");
+        PageRankResult<rank_type> result;
+        if (size == 0) return result;
+        auto damping = static_cast<rank_type>(options.damping);
+        auto nodes = static_cast<rank_type>(size);
+        bool vectorized = detail::gather_indices_fit(size);
+        std::unique_ptr<rank_type[]> rank(new rank_type[size]);
+        std::unique_ptr<rank_type[]> next(new rank_type[size]);
+        std::unique_ptr<rank_type[]> share(new rank_type[size]);
+        std::unique_ptr<rank_type[]> inverse_degree(new rank_type[size]);
+        std::vector<rank_type> partial(transposed.parts().size());
+
+        transposed.for_each_part([&](const auto& part, size_t) {
+            for (size_t node = part.first; node < part.last; ++node) {
+                size_t degree = graph.degree_out_by_id(static_cast<vertex_id>(node));
+                inverse_degree[node] = degree == 0 ? rank_type{} : 1 / static_cast<rank_type>(degree);
+                rank[node] = 1 / nodes;
+                next[node] = rank_type{};
+                share[node] = rank_type{};
+            }
+        });
+        while (result.iterations < options.max_iterations) {
+            transposed.for_each_part([&](const auto& part, size_t index) {
+                rank_type dangling{};
+                for (size_t node = part.first; node < part.last; ++node) {
+                    if (inverse_degree[node] == 0) dangling += rank[node];
+                    share[node] = rank[node] * inverse_degree[node];
+                }
+                partial[index] = dangling;
+            });
+            rank_type dangling{};
+            for (auto value: partial) dangling += value;
+            rank_type base = (1 - damping) / nodes + damping * dangling / nodes;
+
+            transposed.for_each_part([&](const auto& part, size_t index) {
+                rank_type error{};
+                const vertex_id* neighbors = part.neighbors.data();
+                for (size_t row = 0; row < part.size(); ++row) {
+                    size_t begin = part.offsets[row];
+                    size_t count = part.offsets[row + 1] - begin;
+                    rank_type sum = vectorized ? detail::gather_sum<true>(share.get(), neighbors + begin, count)
+                                               : detail::gather_sum<false>(share.get(), neighbors + begin, count);
+                    size_t node = part.first + row;
+                    next[node] = base + damping * sum;
+                    error += std::abs(next[node] - rank[node]);
+                }
+                partial[index] = error;
+            });
+            rank.swap(next);
+            ++result.iterations;
+            result.error = rank_type{};
+            for (auto value: partial) result.error += value;
+            if (result.error < static_cast<rank_type>(options.tolerance)) break;
+        }
+        result.rank.assign(rank.get(), rank.get() + size);
+        return result;
+    }
+}
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "Parallel.h"
+
+namespace graph {
+    /** @defgroup ShortestPaths Shortest paths */
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief Distance of a node that cannot be reached: infinity for floating-point weights, the maximum otherwise.
+     */
+    template<typename distance_type>
+    constexpr distance_type infinite_distance() noexcept {
+        if constexpr (std::numeric_limits<distance_type>::has_infinity) return std::numeric_limits<distance_type>::infinity();
+        else return std::numeric_limits<distance_type>::max();
+    }
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief Result of a single-source shortest path search, as dense arrays indexed by vertex id
+     */
+    template<typename distance_type>
+    struct ShortestPathResult {
+        std::vector<distance_type> distance; /**< @brief Distance of every node from the source, or infinite_distance(). */
+        std::vector<vertex_id> parent; /**< @brief Predecessor on a shortest path; the source is its own parent, unreached nodes have no_vertex. */
+
+        bool reached(vertex_id id) const noexcept { return parent[id] != no_vertex; } /**< @brief Checks if the node was reached. */
+        std::vector<vertex_id> path_to(vertex_id target) const;
+    };
+
+    /** @ingroup ShortestPaths @brief Result of a point-to-point shortest path search */
+    template<typename distance_type>
+    struct PathResult {
+        distance_type distance = infinite_distance<distance_type>(); /**< @brief Length of the path, or infinite_distance(). */
+        std::vector<vertex_id> path; /**< @brief The nodes of the path from source to target; empty if there is none. */
+    };
+
+    /** @brief Returns the nodes of the shortest path from the source to target; empty if target was not reached. */
+    template<typename distance_type>
+    std::vector<vertex_id> ShortestPathResult<distance_type>::path_to(vertex_id target) const {
+        std::vector<vertex_id> path;
+        if (!reached(target)) return path;
+        for (vertex_id node = target;; node = parent[node]) {
+            path.push_back(node);
+            if (parent[node] == node) break;
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief Binary min-heap of (distance, node) entries
+     *
+     * @details The heaps used by the shortest path algorithms do not support decrease-key; the algorithms push a
+     * node again when its distance improves and skip the stale entries when they come out.
+     */
+    template<typename distance_type>
+    class binary_heap {
+    public:
+        bool empty() const noexcept { return m_heap.empty(); } /**< @brief Checks if the heap is empty. */
+        size_t size() const noexcept { return m_heap.size(); } /**< @brief Counts the entries, stale ones included. */
+        const std::pair<distance_type, vertex_id>& top() const noexcept { return m_heap.front(); } /**< @brief Returns the smallest entry. */
+
+        void push(distance_type distance, vertex_id node) {
+            m_heap.emplace_back(distance, node);
+            std::push_heap(m_heap.begin(), m_heap.end(), std::greater<>{});
+        }
+        void pop() {
+            std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<>{});
+            m_heap.pop_back();
+        }
+    private:
+        std::vector<std::pair<distance_type, vertex_id>> m_heap;
+    };
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief d-ary min-heap of (distance, node) entries
+     *
+     * @details A wider heap is shallower, so a push does fewer comparisons, and the children of a node share a
+     * cache line. Four children is usually the sweet spot for Dijkstra.
+     */
+    template<typename distance_type, size_t arity>
+    class dary_heap {
+        static_assert(arity >= 2, "a heap needs at least two children per node");
+    public:
+        bool empty() const noexcept { return m_heap.empty(); } /**< @brief Checks if the heap is empty. */
+        size_t size() const noexcept { return m_heap.size(); } /**< @brief Counts the entries, stale ones included. */
+        const std::pair<distance_type, vertex_id>& top() const noexcept { return m_heap.front(); } /**< @brief Returns the smallest entry. */
+
+        void push(distance_type distance, vertex_id node);
+        void pop();
+    private:
+        std::vector<std::pair<distance_type, vertex_id>> m_heap;
+    };
+
+    template<typename distance_type, size_t arity>
+    void dary_heap<distance_type, arity>::push(distance_type distance, vertex_id node) {
+        size_t index = m_heap.size();
+        m_heap.emplace_back(distance, node);
+        auto entry = m_heap.back();
+        while (index > 0) {
+            size_t parent = (index - 1) / arity;
+            if (!(entry.first < m_heap[parent].first)) break;
+            m_heap[index] = m_heap[parent];
+            index = parent;
+        }
+        m_heap[index] = entry;
+    }
+
+    template<typename distance_type, size_t arity>
+    void dary_heap<distance_type, arity>::pop() {
+        auto entry = m_heap.back();
+        m_heap.pop_back();
+        if (m_heap.empty()) return;
+        size_t index = 0;
+        for (;;) {
+            size_t first = index * arity + 1;
+            if (first >= m_heap.size()) break;
+            size_t last = std::min(first + arity, m_heap.size());
+            size_t smallest = first;
+            for (size_t child = first + 1; child < last; ++child) {
+                if (m_heap[child].first < m_heap[smallest].first) smallest = child;
+            }
+            if (!(m_heap[smallest].first < entry.first)) break;
+            m_heap[index] = m_heap[smallest];
+            index = smallest;
+        }
+        m_heap[index] = entry;
+    }
+
+    /** @ingroup ShortestPaths @brief 4-ary min-heap of (distance, node) entries */
+    template<typename distance_type>
+    using quaternary_heap = dary_heap<distance_type, 4>;
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief Radix heap for non-negative integer distances
+     *
+     * @details A monotone priority queue: every pushed distance must be at least the last popped one, which
+     * Dijkstra guarantees. Entries sit in buckets by the highest bit in which they differ from the last popped
+     * distance, so push is O(1) and each entry moves down at most once per bit.
+     */
+    template<typename distance_type>
+    class radix_heap {
+        static_assert(std::is_integral_v<distance_type>, "radix_heap requires integer distances");
+        using bits_type = std::make_unsigned_t<distance_type>;
+        static constexpr size_t bucket_count = std::numeric_limits<bits_type>::digits + 1;
+    public:
+        bool empty() const noexcept { return m_size == 0; } /**< @brief Checks if the heap is empty. */
+        size_t size() const noexcept { return m_size; } /**< @brief Counts the entries, stale ones included. */
+        const std::pair<distance_type, vertex_id>& top(); /**< @brief Returns the smallest entry. */
+
+        void push(distance_type distance, vertex_id node) {
+            m_buckets[bucket_of(distance)].emplace_back(distance, node);
+            ++m_size;
+        }
+        void pop() {
+            top();
+            m_buckets[0].pop_back();
+            --m_size;
+        }
+    private:
+        size_t bucket_of(distance_type distance) const noexcept {
+            auto difference = static_cast<bits_type>(distance) ^ static_cast<bits_type>(m_last);
+            size_t bucket = 0;
+            while (difference != 0) {
+                difference >>= 1;
+                ++bucket;
+            }
+            return bucket;
+        }
+
+        std::vector<std::pair<distance_type, vertex_id>> m_buckets[bucket_count];
+        distance_type m_last = 0; /**< @brief The last distance moved to bucket 0. */
+        size_t m_size = 0;
+    };
+
+    /** @details Refills bucket 0 from the first non-empty bucket when it runs dry. */
+    template<typename distance_type>
+    const std::pair<distance_type, vertex_id>& radix_heap<distance_type>::top() {
+        if (m_buckets[0].empty()) {
+            size_t bucket = 1;
+            while (m_buckets[bucket].empty()) ++bucket;
+            auto &source = m_buckets[bucket];
+            m_last = std::min_element(source.begin(), source.end())->first;
+            for (auto const &entry: source) m_buckets[bucket_of(entry.first)].push_back(entry);
+            source.clear();
+        }
+        return m_buckets[0].back();
+    }
+
+    namespace detail {
+        /** @brief Calls f(v, w) for every edge u -> v with weight w of a CsrGraph. */
+        template<typename csr_type>
+        auto csr_weighted_neighbors(const csr_type& graph) {
+            return [&graph](vertex_id node, auto&& visit) {
+                auto const &offsets = graph.offsets();
+                for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) visit(graph.neighbors()[edge], graph.weights()[edge]);
+            };
+        }
+
+        /** @brief Calls f(v, w) for every edge u -> v with weight w of a Graph, translating keys to interned ids. */
+        template<typename graph_type>
+        auto graph_weighted_neighbors(const graph_type& graph) {
+            return [&graph](vertex_id node, auto&& visit) {
+                for (auto const &edge: graph.at(graph.key_of(node)).getedges()) visit(graph.id_of(edge.first), edge.second);
+            };
+        }
+
+        template<typename weight_type>
+        void check_weight(const weight_type& weight) {
+            if (weight < weight_type{}) throw GraphException("Negative edge weight");
+        }
+
+        /** @brief Dijkstra's algorithm over nodes [0, size) with a lazy-deletion heap. */
+        template<template<typename> class heap_type, typename weight_type, typename neighbors_type>
+        ShortestPathResult<weight_type> dijkstra(size_t size, vertex_id source, neighbors_type&& for_each_edge) {
+            if (source >= size) throw GraphException("Vertex not found");
+            ShortestPathResult<weight_type> result{std::vector<weight_type>(size, infinite_distance<weight_type>()), std::vector<vertex_id>(size, no_vertex)};
+            std::vector<std::uint8_t> settled(size, 0);
+            heap_type<weight_type> heap;
+            result.distance[source] = weight_type{};
+            result.parent[source] = source;
+            heap.push(weight_type{}, source);
+            while (!heap.empty()) {
+                auto [distance, node] = heap.top();
+                heap.pop();
+                if (settled[node]) continue;
+                settled[node] = 1;
+                for_each_edge(node, [&, distance = distance, node = node](vertex_id neighbor, const weight_type& weight) {
+                    check_weight(weight);
+                    weight_type candidate = distance + weight;
+                    if (!(candidate < result.distance[neighbor])) return;
+                    result.distance[neighbor] = candidate;
+                    result.parent[neighbor] = node;
+                    heap.push(candidate, neighbor);
+                });
+            }
+            return result;
+        }
+    }
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief Single-source shortest paths with Dijkstra's algorithm
+     *
+     * @tparam heap_type - the priority queue: binary_heap (default), quaternary_heap, or radix_heap for integer weights
+     * @throws If the id is out of range or an edge weight is negative, throws GraphException.
+     */
+    template<template<typename> class heap_type = binary_heap, typename key_type, typename value_type, typename weight_type>
+    ShortestPathResult<weight_type> dijkstra(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id source) {
+        return detail::dijkstra<heap_type, weight_type>(graph.size(), source, detail::csr_weighted_neighbors(graph));
+    }
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief Single-source shortest paths from the node with the given key; the result is indexed by interned id
+     * @throws If the key is not found or an edge weight is negative, throws GraphException.
+     */
+    template<template<typename> class heap_type = binary_heap, typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    ShortestPathResult<weight_type> dijkstra(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, const key_type& source) {
+        return detail::dijkstra<heap_type, weight_type>(graph.size(), graph.id_of(source), detail::graph_weighted_neighbors(graph));
+    }
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief Point-to-point shortest path with bidirectional Dijkstra
+     *
+     * @details Searches forward from the source on graph and backward from the target on transposed, always
+     * advancing the side with the smaller tentative distance. It stops once the two smallest tentative distances
+     * add up to at least the best path found so far, which typically settles far fewer nodes than a one-sided
+     * search.
+     *
+     * @param[in] transposed graph.transpose()
+     * @throws If an id is out of range or an edge weight is negative, throws GraphException.
+     */
+    template<template<typename> class heap_type = binary_heap, typename key_type, typename value_type, typename weight_type>
+    PathResult<weight_type> bidirectional_dijkstra(const CsrGraph<key_type, value_type, weight_type>& graph,
+                                                   const CsrGraph<key_type, value_type, weight_type>& transposed,
+                                                   vertex_id source, vertex_id target) {
+        size_t size = graph.size();
+        if (source >= size || target >= size) throw GraphException("Vertex not found");
+        const weight_type infinity = infinite_distance<weight_type>();
+        const CsrGraph<key_type, value_type, weight_type>* sides[2] = {&graph, &transposed};
+        std::vector<weight_type> distance[2] = {std::vector<weight_type>(size, infinity), std::vector<weight_type>(size, infinity)};
+        std::vector<vertex_id> parent[2] = {std::vector<vertex_id>(size, no_vertex), std::vector<vertex_id>(size, no_vertex)};
+        std::vector<std::uint8_t> settled[2] = {std::vector<std::uint8_t>(size, 0), std::vector<std::uint8_t>(size, 0)};
+        heap_type<weight_type> heaps[2];
+        vertex_id roots[2] = {source, target};
+        for (int side = 0; side < 2; ++side) {
+            distance[side][roots[side]] = weight_type{};
+            parent[side][roots[side]] = roots[side];
+            heaps[side].push(weight_type{}, roots[side]);
+        }
+
+        PathResult<weight_type> result;
+        vertex_id meeting = source == target ? source : no_vertex;
+        if (meeting != no_vertex) result.distance = weight_type{};
+        while (!heaps[0].empty() && !heaps[1].empty()) {
+            weight_type forward = heaps[0].top().first;
+            weight_type backward = heaps[1].top().first;
+            if (meeting != no_vertex && !(forward + backward < result.distance)) break;
+            int side = backward < forward ? 1 : 0;
+            auto [current, node] = heaps[side].top();
+            heaps[side].pop();
+            if (settled[side][node]) continue;
+            settled[side][node] = 1;
+
+            auto const &offsets = sides[side]->offsets();
+            for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) {
+                vertex_id neighbor = sides[side]->neighbors()[edge];
+                const weight_type &weight = sides[side]->weights()[edge];
+                detail::check_weight(weight);
+                weight_type candidate = current + weight;
+                if (candidate < distance[side][neighbor]) {
+                    distance[side][neighbor] = candidate;
+                    parent[side][neighbor] = node;
+                    heaps[side].push(candidate, neighbor);
+                }
+                if (distance[1 - side][neighbor] != infinity && distance[side][neighbor] + distance[1 - side][neighbor] < result.distance) {
+                    result.distance = distance[side][neighbor] + distance[1 - side][neighbor];
+                    meeting = neighbor;
+                }
+            }
+        }
+
+        if (meeting == no_vertex) return result;
+        for (vertex_id node = meeting; node != source; node = parent[0][node]) result.path.push_back(node);
+        result.path.push_back(source);
+        std::reverse(result.path.begin(), result.path.end());
+        for (vertex_id node = meeting; node != target; ) {
+            node = parent[1][node];
+            result.path.push_back(node);
+        }
+        return result;
+    }
+
+    /**
+     * @ingroup ShortestPaths
+     * @brief Parallel single-source shortest paths with delta-stepping
+     *
+     * @details
+     * Keeps the tentative distances in buckets of width delta and settles one bucket at a time. Within a bucket the
+     * light edges (weight <= delta) are relaxed in parallel rounds until the bucket stops changing; the heavy edges
+     * of every node removed from the bucket are relaxed once afterwards. Distances are lowered with an atomic
+     * compare-and-swap, so the result does not depend on scheduling. Parents are derived from the final distances;
+     * with zero-weight cycles a parent chain may loop.
+     *
+     * @param[in] delta The bucket width; zero picks the largest weight divided by the average degree
+     * @param[in] threads The number of workers; 0 means default_threads()
+     * @throws If the id is out of range or an edge weight is negative, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    ShortestPathResult<weight_type> delta_stepping(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id source,
+                                                   weight_type delta = weight_type{}, size_t threads = 0) {
+        size_t size = graph.size();
+        if (source >= size) throw GraphException("Vertex not found");
+        if (threads == 0) threads = default_threads();
+        auto const &offsets = graph.offsets();
+        auto const &neighbors = graph.neighbors();
+        auto const &weights = graph.weights();
+        weight_type largest{};
+        for (auto const &weight: weights) {
+            detail::check_weight(weight);
+            largest = std::max(largest, weight);
+        }
+        if (!(weight_type{} < delta)) {
+            delta = static_cast<weight_type>(largest / static_cast<weight_type>(std::max<size_t>(1, graph.edge_count() / std::max<size_t>(1, size))));
+            if (!(weight_type{} < delta)) delta = weight_type{1};
+        }
+
+        const weight_type infinity = infinite_distance<weight_type>();
+        std::vector<std::atomic<weight_type>> distance(size);
+        parallel_for(0, size, [&](size_t first, size_t last, size_t) {
+            for (size_t node = first; node < last; ++node) distance[node].store(infinity, std::memory_order_relaxed);
+        }, threads);
+        distance[source].store(weight_type{}, std::memory_order_relaxed);
+
+        auto bucket_of = [&](const weight_type& value) { return static_cast<size_t>(value / delta); };
+        std::vector<std::vector<vertex_id>> buckets(1, std::vector<vertex_id>{source});
+        std::vector<std::vector<vertex_id>> updated(threads);
+        auto relax = [&](const std::vector<vertex_id>& frontier, bool light) {
+            parallel_for(0, frontier.size(), [&](size_t first, size_t last, size_t worker) {
+                for (size_t index = first; index < last; ++index) {
+                    vertex_id node = frontier[index];
+                    weight_type base = distance[node].load(std::memory_order_relaxed);
+                    for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) {
+                        if ((weights[edge] <= delta) != light) continue;
+                        weight_type candidate = base + weights[edge];
+                        auto &target = distance[neighbors[edge]];
+                        weight_type current = target.load(std::memory_order_relaxed);
+                        while (candidate < current && !target.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {}
+                        if (candidate < current) updated[worker].push_back(neighbors[edge]);
+                    }
+                }
+            }, threads);
+            for (auto &nodes: updated) {
+                for (auto node: nodes) {
+                    size_t bucket = bucket_of(distance[node].load(std::memory_order_relaxed));
+                    if (bucket >= buckets.size()) buckets.resize(bucket + 1);
+                    buckets[bucket].push_back(node);
+                }
+                nodes.clear();
+            }
+        };
+
+        std::vector<std::uint8_t> queued(size, 0);
+        std::vector<vertex_id> frontier;
+        std::vector<vertex_id> removed;
+        for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+            removed.clear();
+            while (!buckets[bucket].empty()) {
+                frontier.clear();
+                for (auto node: buckets[bucket]) {
+                    if (queued[node] || bucket_of(distance[node].load(std::memory_order_relaxed)) != bucket) continue;
+                    queued[node] = 1;
+                    frontier.push_back(node);
+                }
+                buckets[bucket].clear();
+                for (auto node: frontier) queued[node] = 0;
+                removed.insert(removed.end(), frontier.begin(), frontier.end());
+                relax(frontier, true);
+            }
+            std::sort(removed.begin(), removed.end());
+            removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+            relax(removed, false);
+        }
+
+        ShortestPathResult<weight_type> result{std::vector<weight_type>(size), std::vector<vertex_id>(size, no_vertex)};
+        for (size_t node = 0; node < size; ++node) result.distance[node] = distance[node].load(std::memory_order_relaxed);
+        result.parent[source] = source;
+        std::vector<std::atomic<vertex_id>> parent(size);
+        for (auto &node: parent) node.store(no_vertex, std::memory_order_relaxed);
+        parallel_for(0, size, [&](size_t first, size_t last, size_t) {
+            for (size_t node = first; node < last; ++node) {
+                if (result.distance[node] == infinity) continue;
+                for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) {
+                    vertex_id neighbor = neighbors[edge];
+                    if (neighbor == source || node == neighbor || !(result.distance[node] + weights[edge] == result.distance[neighbor])) continue;
+                    vertex_id expected = no_vertex;
+                    parent[neighbor].compare_exchange_strong(expected, static_cast<vertex_id>(node), std::memory_order_relaxed);
+                }
+            }
+        }, threads);
+        for (size_t node = 0; node < size; ++node) {
+            if (node != source) result.parent[node] = parent[node].load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+}
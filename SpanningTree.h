@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "Components.h"
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "Parallel.h"
+
+namespace graph {
+    /** @defgroup SpanningTrees Minimum spanning trees */
+
+    /**
+     * @ingroup SpanningTrees
+     * @brief Result of a minimum spanning forest search: the edges of the forest, between interned ids
+     *
+     * @details The edges are treated as undirected. Ties between equal weights are broken by the endpoints, so
+     * the forest is unique and every algorithm returns the same one, serial or parallel.
+     */
+    template<typename weight_type>
+    struct SpanningForest {
+        detail::id_edge_list<weight_type> edges; /**< @brief The edges of the forest as (smaller id, larger id), in the order of weight. */
+        weight_type weight{}; /**< @brief The total weight of the edges. */
+        size_t trees = 0; /**< @brief The number of trees, one per weakly connected component. */
+    };
+
+    namespace detail {
+        /** @brief Orders edges by weight, then by endpoints, which makes the minimum spanning forest unique. */
+        struct lighter_edge {
+            template<typename edge_type>
+            bool operator()(const edge_type& first, const edge_type& second) const {
+                if (first.second < second.second) return true;
+                if (second.second < first.second) return false;
+                return first.first < second.first;
+            }
+        };
+
+        /** @brief Returns the edges of a Graph as (smaller id, larger id), without self-loops. */
+        template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+        id_edge_list<weight_type> undirected_edges(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph) {
+            id_edge_list<weight_type> edges;
+            edges.reserve(graph.edge_count());
+            for (size_t node = 0; node < graph.size(); ++node) {
+                auto source = static_cast<vertex_id>(node);
+                for (auto const &edge: graph.at(graph.key_of(source)).getedges()) {
+                    vertex_id target = graph.id_of(edge.first);
+                    if (target != source) edges.emplace_back(std::minmax(source, target), edge.second);
+                }
+            }
+            return edges;
+        }
+
+        /** @brief Returns the edges of a CsrGraph as (smaller id, larger id), without self-loops, filled in parallel by rows. */
+        template<typename key_type, typename value_type, typename weight_type>
+        id_edge_list<weight_type> undirected_edges(const CsrGraph<key_type, value_type, weight_type>& graph, size_t threads) {
+            auto const &offsets = graph.offsets();
+            auto const &neighbors = graph.neighbors();
+            auto const &weights = graph.weights();
+            id_edge_list<weight_type> edges(graph.edge_count());
+            parallel_for_edges(offsets, [&](size_t first, size_t last, size_t) {
+                for (size_t node = first; node < last; ++node) {
+                    auto source = static_cast<vertex_id>(node);
+                    for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) edges[edge] = {std::minmax(source, neighbors[edge]), weights[edge]};
+                }
+            }, threads);
+            edges.erase(std::remove_if(edges.begin(), edges.end(), [](const auto& edge) { return edge.first.first == edge.first.second; }), edges.end());
+            return edges;
+        }
+
+        /** @brief Kruskal's algorithm over nodes [0, size): a parallel sort of the edges, then a union-find pass. */
+        template<typename weight_type>
+        SpanningForest<weight_type> kruskal(size_t size, id_edge_list<weight_type> edges, size_t threads) {
+            parallel_sort(edges.begin(), edges.end(), lighter_edge{}, threads);
+            SpanningForest<weight_type> result;
+            std::vector<vertex_id> parent(size);
+            for (size_t node = 0; node < size; ++node) parent[node] = static_cast<vertex_id>(node);
+            for (auto const &edge: edges) {
+                if (result.edges.size() + 1 >= size) break;
+                vertex_id first = find_root(parent, edge.first.first);
+                vertex_id second = find_root(parent, edge.first.second);
+                if (first == second) continue;
+                parent[std::max(first, second)] = std::min(first, second);
+                result.weight += edge.second;
+                result.edges.push_back(edge);
+            }
+            result.trees = size - result.edges.size();
+            return result;
+        }
+
+        /**
+         * @brief Borůvka's algorithm over nodes [0, size)
+         *
+         * @details Every round, each edge between two components offers itself in parallel to both, and each
+         * component keeps the lightest offer with a compare-and-swap. Those edges join the components, the forest
+         * is flattened in parallel, and the edges inside a component are dropped. Every round at least halves the
+         * number of components, so there are at most log2(size) rounds.
+         */
+        template<typename weight_type>
+        SpanningForest<weight_type> boruvka(size_t size, id_edge_list<weight_type> edges, size_t threads) {
+            constexpr size_t none = static_cast<size_t>(-1);
+            SpanningForest<weight_type> result;
+            std::vector<vertex_id> parent(size);
+            std::vector<vertex_id> roots(size);
+            std::vector<std::atomic<size_t>> lightest(size);
+            parallel_for(0, size, [&](size_t first, size_t last, size_t) {
+                for (size_t node = first; node < last; ++node) {
+                    parent[node] = roots[node] = static_cast<vertex_id>(node);
+                    lightest[node].store(none, std::memory_order_relaxed);
+                }
+            }, threads);
+            std::vector<vertex_id> flat(size);
+            lighter_edge lighter;
+
+            while (!edges.empty()) {
+                parallel_for(0, edges.size(), [&](size_t first, size_t last, size_t) {
+                    for (size_t index = first; index < last; ++index) {
+                        vertex_id ends[2] = {parent[edges[index].first.first], parent[edges[index].first.second]};
+                        if (ends[0] == ends[1]) continue;
+                        for (auto component: ends) {
+                            size_t current = lightest[component].load(std::memory_order_relaxed);
+                            while ((current == none || lighter(edges[index], edges[current])) &&
+                                   !lightest[component].compare_exchange_weak(current, index, std::memory_order_relaxed)) {}
+                        }
+                    }
+                }, threads);
+
+                for (auto root: roots) {
+                    size_t index = lightest[root].exchange(none, std::memory_order_relaxed);
+                    if (index == none) continue;
+                    vertex_id first = find_root(parent, edges[index].first.first);
+                    vertex_id second = find_root(parent, edges[index].first.second);
+                    if (first == second) continue;
+                    parent[std::max(first, second)] = std::min(first, second);
+                    result.weight += edges[index].second;
+                    result.edges.push_back(edges[index]);
+                }
+
+                parallel_for(0, size, [&](size_t first, size_t last, size_t) {
+                    for (size_t node = first; node < last; ++node) {
+                        vertex_id root = parent[node];
+                        while (parent[root] != root) root = parent[root];
+                        flat[node] = root;
+                    }
+                }, threads);
+                parent.swap(flat);
+                roots.erase(std::remove_if(roots.begin(), roots.end(), [&](vertex_id node) { return parent[node] != node; }), roots.end());
+                edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const auto& edge) {
+                    return parent[edge.first.first] == parent[edge.first.second];
+                }), edges.end());
+            }
+            std::sort(result.edges.begin(), result.edges.end(), lighter);
+            result.trees = size - result.edges.size();
+            return result;
+        }
+    }
+
+    /**
+     * @ingroup SpanningTrees
+     * @brief Minimum spanning forest with Kruskal's algorithm, sorting the edges in parallel
+     *
+     * @details Every edge counts in both directions; an edge stored both ways is considered twice, with no harm.
+     * Best when the edges are few or the union-find pass is short; see boruvka for large graphs on many cores.
+     *
+     * @param[in] threads The number of workers; 0 means default_threads()
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    SpanningForest<weight_type> kruskal(const CsrGraph<key_type, value_type, weight_type>& graph, size_t threads = 0) {
+        return detail::kruskal(graph.size(), detail::undirected_edges(graph, threads), threads);
+    }
+
+    /** @ingroup SpanningTrees @brief Minimum spanning forest of a Graph with Kruskal's algorithm; the result is between interned ids */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    SpanningForest<weight_type> kruskal(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, size_t threads = 0) {
+        return detail::kruskal(graph.size(), detail::undirected_edges(graph), threads);
+    }
+
+    /**
+     * @ingroup SpanningTrees
+     * @brief Parallel minimum spanning forest with Borůvka's algorithm
+     *
+     * @details Returns the same forest as kruskal. Every round scans the remaining edges in parallel, and edges
+     * inside a component are dropped for good, so the later rounds are short.
+     *
+     * @param[in] threads The number of workers; 0 means default_threads()
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    SpanningForest<weight_type> boruvka(const CsrGraph<key_type, value_type, weight_type>& graph, size_t threads = 0) {
+        return detail::boruvka(graph.size(), detail::undirected_edges(graph, threads), threads);
+    }
+
+    /** @ingroup SpanningTrees @brief Parallel minimum spanning forest of a Graph with Borůvka's algorithm; the result is between interned ids */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    SpanningForest<weight_type> boruvka(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, size_t threads = 0) {
+        return detail::boruvka(graph.size(), detail::undirected_edges(graph), threads);
+    }
+}
@@ -0,0 +1,828 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace graph {
+    /**
+     * @defgroup Storage Storage
+     *
+     * @brief Containers and storage policies for Graph
+     *
+     * @details
+     * A storage policy is a struct with three member alias templates that choose the containers a Graph is made of:
+     * - `node_map<key, mapped>` - the container behind Graph::m_umap
+     * - `edge_map<key, mapped>` - the container behind Node::m_edge
+     * - `key_set<key>` - the container behind the reverse index of a Node
+     *
+     * Any container can be plugged in as long as it offers the subset of the std::unordered_map (or
+     * std::unordered_set) interface that Graph uses: begin/end, cbegin/cend, find, insert, try_emplace,
+     * insert_or_assign, erase by key and by iterator, clear, size, empty, reserve and swap. Iteration must yield objects with
+     * `first` and `second` members for maps.
+     *
+     * A policy may also declare an `allocator_type`. Every container is then constructed from that allocator, and
+     * Node is allocator-aware, so a std::pmr allocator of the node map is passed on to the edge map and the reverse
+     * index of every node. The containers must then offer get_allocator and the allocator-extended constructors.
+     * Policies without an `allocator_type` use std::allocator.
+     *
+     * Graphs without weights or values use graph::empty for weight_type or value_type. flat_hash_map and
+     * sorted_vector_map with graph::empty as the mapped type store only the keys, so the edges of such a graph cost
+     * one key each; std::unordered_map still allocates a list node per edge, which dwarfs the empty weight.
+     */
+
+    /**
+     * @ingroup Storage
+     * @brief Tag for graphs without weights or values
+     *
+     * @details All instances are equal. Use it as weight_type or value_type of a Graph; the flat and sorted vector
+     * edge maps then store the neighbor keys alone.
+     */
+    struct empty {
+        friend constexpr bool operator==(empty, empty) noexcept { return true; }
+        friend constexpr bool operator!=(empty, empty) noexcept { return false; }
+    };
+
+    /** @brief Implementation details, not part of the public interface. */
+    namespace detail {
+        /** @brief Hints the processor to load the cache line of the address for reading; a no-op where unsupported. */
+        inline void prefetch_address(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(address, 0, 3);
+#else
+            (void) address;
+#endif
+        }
+
+        /** @brief Extracts the key of a map entry. */
+        struct pair_key {
+            template<typename T>
+            const auto& operator()(const T& value) const noexcept { return value.first; }
+        };
+
+        /** @brief Extracts the key of a set entry, which is the entry itself. */
+        struct identity_key {
+            template<typename T>
+            const T& operator()(const T& value) const noexcept { return value; }
+        };
+
+        /**
+         * @brief Map entry of a key and a graph::empty, stored as the key alone
+         *
+         * @details Offers first and second like the std::pair entries of the other maps; second is a static member,
+         * so it takes no space and cannot be assigned.
+         */
+        template<typename key_type>
+        struct key_entry {
+            static constexpr empty second{};
+
+            key_entry(key_type key, empty = {}) : first(std::move(key)) {}
+            template<typename key_arg, typename... Args>
+            key_entry(std::piecewise_construct_t, std::tuple<key_arg> key, std::tuple<Args...>) : first(std::forward<key_arg>(std::get<0>(key))) {}
+
+            key_type first;
+        };
+
+        /**
+         * @ingroup Storage
+         * @brief Open-addressing hash table with linear probing
+         *
+         * @details
+         * Stores the entries in a single array of slots, so a lookup is a hash followed by a short linear scan
+         * instead of a walk through a bucket list. Erased slots become tombstones and are reclaimed on the next
+         * rehash, which keeps iterators to the other entries valid during erase. The capacity is a power of two
+         * and the table grows when it is three quarters full.
+         *
+         * @tparam key_type - type of the key
+         * @tparam entry_type - type of the stored entry, either the key itself or a pair of a key and a value
+         * @tparam key_of - function object that extracts the key of an entry
+         * @tparam allocator - allocator of the slots; entries are constructed through it, so a std::pmr allocator
+         * is passed on to allocator-aware entries
+         */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        class open_addressing_table : private std::allocator_traits<allocator>::template rebind_alloc<entry_type> {
+            enum class slot_state : std::uint8_t { empty, full, deleted };
+            using entry_allocator = typename std::allocator_traits<allocator>::template rebind_alloc<entry_type>;
+            using state_allocator = typename std::allocator_traits<allocator>::template rebind_alloc<slot_state>;
+            using entry_traits = std::allocator_traits<entry_allocator>;
+
+            template<bool is_const>
+            class basic_iterator {
+                using table_pointer = std::conditional_t<is_const, const open_addressing_table*, open_addressing_table*>;
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = entry_type;
+                using difference_type = std::ptrdiff_t;
+                using reference = std::conditional_t<is_const, const entry_type&, entry_type&>;
+                using pointer = std::conditional_t<is_const, const entry_type*, entry_type*>;
+
+                basic_iterator() = default;
+                basic_iterator(table_pointer table, size_t index) noexcept : m_table(table), m_index(index) { skip(); }
+                template<bool other_const, typename = std::enable_if_t<is_const && !other_const>>
+                basic_iterator(const basic_iterator<other_const>& other) noexcept : m_table(other.m_table), m_index(other.m_index) {}
+
+                reference operator*() const noexcept { return m_table->m_slots[m_index]; }
+                pointer operator->() const noexcept { return m_table->m_slots + m_index; }
+
+                basic_iterator& operator++() noexcept { ++m_index; skip(); return *this; }
+                basic_iterator operator++(int) noexcept { auto copy = *this; ++*this; return copy; }
+                template<bool other_const>
+                bool operator==(const basic_iterator<other_const>& other) const noexcept { return m_index == other.m_index; }
+                template<bool other_const>
+                bool operator!=(const basic_iterator<other_const>& other) const noexcept { return m_index != other.m_index; }
+            private:
+                friend class open_addressing_table;
+                template<bool> friend class basic_iterator;
+
+                void skip() noexcept {
+                    while (m_index < m_table->m_capacity && m_table->m_state[m_index] != slot_state::full) ++m_index;
+                }
+
+                table_pointer m_table = nullptr;
+                size_t m_index = 0;
+            };
+        public:
+            using value_type = entry_type;
+            using allocator_type = entry_allocator;
+            using iterator = basic_iterator<false>;
+            using const_iterator = basic_iterator<true>;
+
+            open_addressing_table() = default;
+            explicit open_addressing_table(const allocator_type& entries) noexcept : entry_allocator(entries) {}
+            open_addressing_table(const open_addressing_table& other)
+                : entry_allocator(entry_traits::select_on_container_copy_construction(other.get_allocator())) { *this = other; }
+            open_addressing_table(const open_addressing_table& other, const allocator_type& entries) : entry_allocator(entries) { *this = other; }
+            open_addressing_table(open_addressing_table&& other) noexcept : entry_allocator(other.get_allocator()) { swap_slots(other); }
+            open_addressing_table(open_addressing_table&& other, const allocator_type& entries) : entry_allocator(entries) { move_from(other); }
+            ~open_addressing_table() { release(); }
+
+            open_addressing_table& operator=(const open_addressing_table& other);
+            open_addressing_table& operator=(open_addressing_table&& other)
+                noexcept(entry_traits::propagate_on_container_move_assignment::value || entry_traits::is_always_equal::value);
+
+            allocator_type get_allocator() const noexcept { return *this; } /**< @brief Returns the allocator of the slots. */
+
+            bool empty() const noexcept { return m_size == 0; } /**< @brief Checks if the table is empty. */
+            size_t size() const noexcept { return m_size; } /**< @brief Counts the number of entries. */
+            size_t capacity() const noexcept { return m_capacity; } /**< @brief Counts the number of slots. */
+            /** @brief Counts the bytes of the slots and their states. */
+            size_t memory_bytes() const noexcept { return m_capacity * (sizeof(entry_type) + sizeof(slot_state)); }
+            /** @brief Counts the slots a lookup of the entry at the given position probes, the entry's own included. */
+            size_t probe_length(const_iterator position) const noexcept {
+                return ((position.m_index - index_of(key_of{}(m_slots[position.m_index]))) & (m_capacity - 1)) + 1;
+            }
+
+            iterator begin() noexcept { return iterator(this, 0); }
+            iterator end() noexcept { return iterator(this, m_capacity); }
+            const_iterator begin() const noexcept { return const_iterator(this, 0); }
+            const_iterator end() const noexcept { return const_iterator(this, m_capacity); }
+            const_iterator cbegin() const noexcept { return begin(); }
+            const_iterator cend() const noexcept { return end(); }
+
+            iterator find(const key_type& key) noexcept { return iterator(this, locate(key)); }
+            const_iterator find(const key_type& key) const noexcept { return const_iterator(this, locate(key)); }
+            size_t count(const key_type& key) const noexcept { return locate(key) != m_capacity; }
+            /** @brief Starts loading the home slot of the key into the cache, so that a find of it soon after does not wait for memory. */
+            void prefetch(const key_type& key) const noexcept {
+                if (m_capacity == 0) return;
+                size_t index = index_of(key);
+                prefetch_address(m_state + index);
+                prefetch_address(m_slots + index);
+            }
+
+            std::pair<iterator, bool> insert(const entry_type& entry) { return emplace_key(key_of{}(entry), entry); }
+            std::pair<iterator, bool> insert(entry_type&& entry) { return emplace_key(key_of{}(entry), std::move(entry)); }
+
+            iterator erase(const_iterator position) noexcept;
+            size_t erase(const key_type& key) noexcept;
+            void clear() noexcept;
+            void reserve(size_t count);
+            void swap(open_addressing_table& other) noexcept;
+        protected:
+            template<typename... Args>
+            std::pair<iterator, bool> emplace_key(const key_type& key, Args&&... args);
+        private:
+            size_t index_of(const key_type& key) const noexcept {
+                return static_cast<size_t>((static_cast<std::uint64_t>(hash{}(key)) * 0x9E3779B97F4A7C15ull) >> m_shift);
+            }
+            size_t locate(const key_type& key) const noexcept;
+            void rehash(size_t capacity);
+            void release() noexcept;
+            void swap_slots(open_addressing_table& other) noexcept;
+            void move_from(open_addressing_table& other);
+            entry_allocator& entries() noexcept { return *this; }
+
+            entry_type* m_slots = nullptr; /**< @brief The entries; only the slots marked full are constructed. */
+            slot_state* m_state = nullptr; /**< @brief The state of every slot. */
+            size_t m_capacity = 0; /**< @brief The number of slots, zero or a power of two. */
+            size_t m_size = 0; /**< @brief The number of full slots. */
+            size_t m_deleted = 0; /**< @brief The number of tombstones. */
+            unsigned m_shift = 64; /**< @brief 64 minus the log2 of the capacity, used by the multiplicative hash. */
+        };
+
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>&
+        open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::operator=(const open_addressing_table& other) {
+            if (this == &other) return *this;
+            clear();
+            reserve(other.m_size);
+            for (auto const &entry: other) insert(entry);
+            return *this;
+        }
+
+        /** @details Takes over the allocator and the slots if the allocator propagates, otherwise see move_from. */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>&
+        open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::operator=(open_addressing_table&& other)
+            noexcept(entry_traits::propagate_on_container_move_assignment::value || entry_traits::is_always_equal::value) {
+            if (this == &other) return *this;
+            release();
+            if constexpr (entry_traits::propagate_on_container_move_assignment::value) {
+                entries() = other.get_allocator();
+                swap_slots(other);
+            } else {
+                move_from(other);
+            }
+            return *this;
+        }
+
+        /**
+         * @details Expects an empty table. Takes over the slots of the other table if both allocators are equal,
+         * otherwise moves its entries one by one into slots from this table's allocator, as the standard containers do.
+         */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        void open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::move_from(open_addressing_table& other) {
+            if constexpr (!entry_traits::is_always_equal::value) {
+                if (get_allocator() != other.get_allocator()) {
+                    reserve(other.m_size);
+                    for (auto &entry: other) emplace_key(key_of{}(entry), std::move(entry));
+                    other.clear();
+                    return;
+                }
+            }
+            swap_slots(other);
+        }
+
+        /** @details Returns the capacity if the key is not present. */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        size_t open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::locate(const key_type& key) const noexcept {
+            if (m_capacity == 0) return 0;
+            size_t mask = m_capacity - 1;
+            for (size_t index = index_of(key);; index = (index + 1) & mask) {
+                if (m_state[index] == slot_state::empty) return m_capacity;
+                if (m_state[index] == slot_state::full && key_equal{}(key_of{}(m_slots[index]), key)) return index;
+            }
+        }
+
+        /**
+         * @details Constructs the entry from args only if the key is not present yet. Grows the table first if the
+         * new entry would push it past the load factor, so the returned iterator stays valid.
+         */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        template<typename... Args>
+        std::pair<typename open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::iterator, bool>
+        open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::emplace_key(const key_type& key, Args&&... args) {
+            size_t found = locate(key);
+            if (found != m_capacity) return {iterator(this, found), false};
+            if ((m_size + m_deleted + 1) * 4 > m_capacity * 3) rehash(m_size + 1 > m_capacity / 2 ? std::max<size_t>(m_capacity * 2, 8) : m_capacity);
+
+            size_t mask = m_capacity - 1;
+            size_t index = index_of(key);
+            while (m_state[index] == slot_state::full) index = (index + 1) & mask;
+            entry_traits::construct(entries(), m_slots + index, std::forward<Args>(args)...);
+            if (m_state[index] == slot_state::deleted) --m_deleted;
+            m_state[index] = slot_state::full;
+            ++m_size;
+            return {iterator(this, index), true};
+        }
+
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        typename open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::iterator
+        open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::erase(const_iterator position) noexcept {
+            entry_traits::destroy(entries(), m_slots + position.m_index);
+            m_state[position.m_index] = slot_state::deleted;
+            --m_size;
+            ++m_deleted;
+            return iterator(this, position.m_index + 1);
+        }
+
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        size_t open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::erase(const key_type& key) noexcept {
+            size_t index = locate(key);
+            if (index == m_capacity) return 0;
+            erase(const_iterator(this, index));
+            return 1;
+        }
+
+        /** @details Destroys the entries but keeps the slots. */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        void open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::clear() noexcept {
+            for (size_t index = 0; index < m_capacity; ++index) {
+                if (m_state[index] == slot_state::full) entry_traits::destroy(entries(), m_slots + index);
+                m_state[index] = slot_state::empty;
+            }
+            m_size = 0;
+            m_deleted = 0;
+        }
+
+        /** @details Makes room for count entries without another rehash. */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        void open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::reserve(size_t count) {
+            if ((count + m_deleted) * 4 <= m_capacity * 3) return;
+            size_t capacity = 8;
+            while (capacity * 3 < count * 4) capacity *= 2;
+            rehash(std::max(capacity, m_capacity));
+        }
+
+        /**
+         * @details Fills a new array of the given capacity, a power of two, with every entry, dropping the
+         * tombstones, and only then swaps it in. As std::vector does, the entries are moved if that cannot throw and
+         * copied otherwise, so a throw leaves the table as it was; entries that can only be moved are moved without
+         * that guarantee.
+         */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        void open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::rehash(size_t capacity) {
+            constexpr bool move_entries = std::is_nothrow_move_constructible_v<entry_type> || !std::is_copy_constructible_v<entry_type>;
+            unsigned shift = 64;
+            for (size_t bits = capacity; bits > 1; bits >>= 1) --shift;
+
+            state_allocator states(entries());
+            entry_type* slots = entry_traits::allocate(entries(), capacity);
+            slot_state* state = nullptr;
+            try {
+                state = std::allocator_traits<state_allocator>::allocate(states, capacity);
+            } catch (...) {
+                entry_traits::deallocate(entries(), slots, capacity);
+                throw;
+            }
+            std::uninitialized_fill_n(state, capacity, slot_state::empty);
+
+            size_t mask = capacity - 1;
+            try {
+                for (size_t old = 0; old < m_capacity; ++old) {
+                    if (m_state[old] != slot_state::full) continue;
+                    size_t index = static_cast<size_t>((static_cast<std::uint64_t>(hash{}(key_of{}(m_slots[old]))) * 0x9E3779B97F4A7C15ull) >> shift);
+                    while (state[index] == slot_state::full) index = (index + 1) & mask;
+                    if constexpr (move_entries) entry_traits::construct(entries(), slots + index, std::move(m_slots[old]));
+                    else entry_traits::construct(entries(), slots + index, static_cast<const entry_type&>(m_slots[old]));
+                    state[index] = slot_state::full;
+                }
+            } catch (...) {
+                for (size_t index = 0; index < capacity; ++index) {
+                    if (state[index] == slot_state::full) entry_traits::destroy(entries(), slots + index);
+                }
+                entry_traits::deallocate(entries(), slots, capacity);
+                std::allocator_traits<state_allocator>::deallocate(states, state, capacity);
+                throw;
+            }
+
+            size_t size = m_size;
+            release();
+            m_slots = slots;
+            m_state = state;
+            m_capacity = capacity;
+            m_shift = shift;
+            m_size = size;
+        }
+
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        void open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::release() noexcept {
+            if (m_capacity == 0) return;
+            clear();
+            state_allocator states(entries());
+            entry_traits::deallocate(entries(), m_slots, m_capacity);
+            std::allocator_traits<state_allocator>::deallocate(states, m_state, m_capacity);
+            m_slots = nullptr;
+            m_state = nullptr;
+            m_capacity = 0;
+            m_shift = 64;
+        }
+
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        void open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::swap(open_addressing_table& other) noexcept {
+            if constexpr (entry_traits::propagate_on_container_swap::value) {
+                using std::swap;
+                swap(entries(), other.entries());
+            }
+            swap_slots(other);
+        }
+
+        /** @details Swaps the slots but not the allocators. */
+        template<typename key_type, typename entry_type, typename key_of, typename hash, typename key_equal, typename allocator>
+        void open_addressing_table<key_type, entry_type, key_of, hash, key_equal, allocator>::swap_slots(open_addressing_table& other) noexcept {
+            std::swap(m_slots, other.m_slots);
+            std::swap(m_state, other.m_state);
+            std::swap(m_capacity, other.m_capacity);
+            std::swap(m_size, other.m_size);
+            std::swap(m_deleted, other.m_deleted);
+            std::swap(m_shift, other.m_shift);
+        }
+
+        /**
+         * @ingroup Storage
+         * @brief Vector kept sorted by key
+         *
+         * @details Lookups are a binary search and iteration is a linear walk over contiguous memory. Insertion and
+         * erasure shift the tail of the vector, so this is meant for small collections such as the edges of a
+         * low-degree node.
+         */
+        template<typename key_type, typename entry_type, typename key_of, typename compare, typename allocator>
+        class sorted_vector {
+            using vector_type = std::vector<entry_type, typename std::allocator_traits<allocator>::template rebind_alloc<entry_type>>;
+        public:
+            using value_type = entry_type;
+            using allocator_type = typename vector_type::allocator_type;
+            using iterator = typename vector_type::iterator;
+            using const_iterator = typename vector_type::const_iterator;
+
+            sorted_vector() = default;
+            explicit sorted_vector(const allocator_type& entries) noexcept : m_entries(entries) {}
+            sorted_vector(const sorted_vector& other, const allocator_type& entries) : m_entries(other.m_entries, entries) {}
+            sorted_vector(sorted_vector&& other, const allocator_type& entries) : m_entries(std::move(other.m_entries), entries) {}
+
+            allocator_type get_allocator() const noexcept { return m_entries.get_allocator(); } /**< @brief Returns the allocator of the entries. */
+
+            bool empty() const noexcept { return m_entries.empty(); } /**< @brief Checks if the vector is empty. */
+            size_t size() const noexcept { return m_entries.size(); } /**< @brief Counts the number of entries. */
+            size_t capacity() const noexcept { return m_entries.capacity(); } /**< @brief Counts the allocated entries. */
+            size_t memory_bytes() const noexcept { return m_entries.capacity() * sizeof(entry_type); } /**< @brief Counts the bytes of the allocated entries. */
+
+            iterator begin() noexcept { return m_entries.begin(); }
+            iterator end() noexcept { return m_entries.end(); }
+            const_iterator begin() const noexcept { return m_entries.begin(); }
+            const_iterator end() const noexcept { return m_entries.end(); }
+            const_iterator cbegin() const noexcept { return m_entries.cbegin(); }
+            const_iterator cend() const noexcept { return m_entries.cend(); }
+
+            iterator find(const key_type& key) noexcept { return m_entries.begin() + (locate(key) - m_entries.cbegin()); }
+            const_iterator find(const key_type& key) const noexcept { return locate(key); }
+            size_t count(const key_type& key) const noexcept { return locate(key) != m_entries.cend(); }
+            /** @brief Starts loading the middle entry, where the binary search of any key begins. */
+            void prefetch(const key_type&) const noexcept {
+                if (!m_entries.empty()) prefetch_address(m_entries.data() + m_entries.size() / 2);
+            }
+
+            std::pair<iterator, bool> insert(const entry_type& entry) { return emplace_key(key_of{}(entry), entry); }
+            std::pair<iterator, bool> insert(entry_type&& entry) { return emplace_key(key_of{}(entry), std::move(entry)); }
+
+            iterator erase(const_iterator position) { return m_entries.erase(position); }
+            size_t erase(const key_type& key);
+            void clear() noexcept { m_entries.clear(); }
+            void reserve(size_t count) { m_entries.reserve(count); }
+            void swap(sorted_vector& other) noexcept { m_entries.swap(other.m_entries); }
+        protected:
+            template<typename... Args>
+            std::pair<iterator, bool> emplace_key(const key_type& key, Args&&... args);
+        private:
+            const_iterator lower_bound(const key_type& key) const noexcept {
+                return std::lower_bound(m_entries.cbegin(), m_entries.cend(), key,
+                                        [](const entry_type& entry, const key_type& value) { return compare{}(key_of{}(entry), value); });
+            }
+            const_iterator locate(const key_type& key) const noexcept {
+                auto found = lower_bound(key);
+                if (found != m_entries.cend() && !compare{}(key, key_of{}(*found))) return found;
+                return m_entries.cend();
+            }
+
+            vector_type m_entries; /**< @brief The entries, sorted by key. */
+        };
+
+        template<typename key_type, typename entry_type, typename key_of, typename compare, typename allocator>
+        template<typename... Args>
+        std::pair<typename sorted_vector<key_type, entry_type, key_of, compare, allocator>::iterator, bool>
+        sorted_vector<key_type, entry_type, key_of, compare, allocator>::emplace_key(const key_type& key, Args&&... args) {
+            auto found = lower_bound(key);
+            auto index = found - m_entries.cbegin();
+            if (found != m_entries.cend() && !compare{}(key, key_of{}(*found))) return {m_entries.begin() + index, false};
+            return {m_entries.emplace(found, std::forward<Args>(args)...), true};
+        }
+
+        template<typename key_type, typename entry_type, typename key_of, typename compare, typename allocator>
+        size_t sorted_vector<key_type, entry_type, key_of, compare, allocator>::erase(const key_type& key) {
+            auto found = locate(key);
+            if (found == m_entries.cend()) return 0;
+            m_entries.erase(found);
+            return 1;
+        }
+
+        /** @brief Adds the map-specific part of the std::unordered_map interface to a table of pairs. */
+        template<typename base, typename key_type, typename mapped_type>
+        class map_interface : public base {
+        public:
+            using base::base;
+            using base::insert;
+
+            /** @brief Inserts a value if the key is not present; the args are only used if it is inserted. */
+            template<typename... Args>
+            std::pair<typename base::iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+                return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+            }
+            /** @brief Inserts a value if the key is not present; the key is moved from only if it is inserted. */
+            template<typename... Args>
+            std::pair<typename base::iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+                return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+            }
+
+            /** @brief Inserts a value, or assigns it if the key is already present. */
+            template<typename M>
+            std::pair<typename base::iterator, bool> insert_or_assign(const key_type& key, M&& value) {
+                auto found = this->find(key);
+                if (found == this->end()) return try_emplace(key, std::forward<M>(value));
+                if constexpr (!std::is_same_v<mapped_type, empty>) found->second = std::forward<M>(value);
+                return {found, false};
+            }
+            template<typename M>
+            std::pair<typename base::iterator, bool> insert_or_assign(key_type&& key, M&& value) {
+                auto found = this->find(key);
+                if (found == this->end()) return try_emplace(std::move(key), std::forward<M>(value));
+                if constexpr (!std::is_same_v<mapped_type, empty>) found->second = std::forward<M>(value);
+                return {found, false};
+            }
+
+            mapped_type& operator[](const key_type& key) { return try_emplace(key).first->second; }
+        };
+    }
+
+    /**
+     * @ingroup Storage
+     * @brief Open-addressing hash map, a drop-in for std::unordered_map
+     *
+     * @details Entries live in one flat array, so there is no allocation per entry. Iterators are invalidated by
+     * insertion (a rehash may move every entry) but not by erasure of other entries.
+     */
+    template<typename key_type, typename mapped_type, typename hash = std::hash<key_type>, typename key_equal = std::equal_to<key_type>,
+             typename allocator = std::allocator<std::pair<const key_type, mapped_type>>>
+    class flat_hash_map : public detail::map_interface<
+            detail::open_addressing_table<key_type, std::pair<const key_type, mapped_type>, detail::pair_key, hash, key_equal, allocator>,
+            key_type, mapped_type> {
+    public:
+        using flat_hash_map::map_interface::map_interface;
+    };
+
+    /** @ingroup Storage @brief flat_hash_map without mapped values; each entry is just the key. */
+    template<typename key_type, typename hash, typename key_equal, typename allocator>
+    class flat_hash_map<key_type, empty, hash, key_equal, allocator> : public detail::map_interface<
+            detail::open_addressing_table<key_type, detail::key_entry<key_type>, detail::pair_key, hash, key_equal, allocator>,
+            key_type, empty> {
+    public:
+        using flat_hash_map::map_interface::map_interface;
+    };
+
+    /** @ingroup Storage @brief Open-addressing hash set, a drop-in for std::unordered_set */
+    template<typename key_type, typename hash = std::hash<key_type>, typename key_equal = std::equal_to<key_type>, typename allocator = std::allocator<key_type>>
+    class flat_hash_set : public detail::open_addressing_table<key_type, key_type, detail::identity_key, hash, key_equal, allocator> {
+    public:
+        using flat_hash_set::open_addressing_table::open_addressing_table;
+    };
+
+    /**
+     * @ingroup Storage
+     * @brief Map kept as a vector sorted by key
+     *
+     * @details The entries are std::pair<key_type, mapped_type>; modifying a key while iterating breaks the order.
+     */
+    template<typename key_type, typename mapped_type, typename compare = std::less<key_type>, typename allocator = std::allocator<std::pair<key_type, mapped_type>>>
+    class sorted_vector_map : public detail::map_interface<
+            detail::sorted_vector<key_type, std::pair<key_type, mapped_type>, detail::pair_key, compare, allocator>,
+            key_type, mapped_type> {
+    public:
+        using sorted_vector_map::map_interface::map_interface;
+    };
+
+    /** @ingroup Storage @brief sorted_vector_map without mapped values; each entry is just the key. */
+    template<typename key_type, typename compare, typename allocator>
+    class sorted_vector_map<key_type, empty, compare, allocator> : public detail::map_interface<
+            detail::sorted_vector<key_type, detail::key_entry<key_type>, detail::pair_key, compare, allocator>,
+            key_type, empty> {
+    public:
+        using sorted_vector_map::map_interface::map_interface;
+    };
+
+    /** @ingroup Storage @brief Set kept as a vector sorted by key */
+    template<typename key_type, typename compare = std::less<key_type>, typename allocator = std::allocator<key_type>>
+    class sorted_vector_set : public detail::sorted_vector<key_type, key_type, detail::identity_key, compare, allocator> {
+    public:
+        using sorted_vector_set::sorted_vector::sorted_vector;
+    };
+
+    namespace detail {
+        /** @brief Shorthand for the allocator rebound to another value type. */
+        template<typename allocator, typename T>
+        using rebind_alloc = typename std::allocator_traits<allocator>::template rebind_alloc<T>;
+
+        /** @brief The allocator_type of a storage policy, or std::allocator for policies that do not declare one. */
+        template<typename storage, typename = void>
+        struct storage_allocator {
+            using type = std::allocator<std::byte>;
+        };
+
+        template<typename storage>
+        struct storage_allocator<storage, std::void_t<typename storage::allocator_type>> {
+            using type = typename storage::allocator_type;
+        };
+
+        /**
+         * @brief Checks if the allocator's construct performs uses-allocator construction, so that allocator-aware
+         * elements receive the allocator without being passed it
+         */
+        template<typename allocator>
+        struct constructs_with_allocator : std::false_type {};
+
+        template<typename T>
+        struct constructs_with_allocator<std::pmr::polymorphic_allocator<T>> : std::true_type {};
+
+        /** @brief Checks if a container chains its entries in buckets, as the std unordered containers do. */
+        template<typename table, typename = void>
+        struct has_buckets : std::false_type {};
+
+        template<typename table>
+        struct has_buckets<table, std::void_t<decltype(std::declval<const table&>().bucket_size(0))>> : std::true_type {};
+
+        /** @brief Checks if a container is one of the open-addressing tables above. */
+        template<typename table, typename = void>
+        struct has_probes : std::false_type {};
+
+        template<typename table>
+        struct has_probes<table, std::void_t<decltype(std::declval<const table&>().probe_length(std::declval<const table&>().cbegin()))>> : std::true_type {};
+
+        template<typename table, typename = void>
+        struct has_memory_bytes : std::false_type {};
+
+        template<typename table>
+        struct has_memory_bytes<table, std::void_t<decltype(std::declval<const table&>().memory_bytes())>> : std::true_type {};
+
+        template<typename table, typename = void>
+        struct has_capacity : std::false_type {};
+
+        template<typename table>
+        struct has_capacity<table, std::void_t<decltype(std::declval<const table&>().capacity())>> : std::true_type {};
+
+        template<typename table, typename key_type, typename = void>
+        struct has_prefetch : std::false_type {};
+
+        template<typename table, typename key_type>
+        struct has_prefetch<table, key_type, std::void_t<decltype(std::declval<const table&>().prefetch(std::declval<const key_type&>()))>> : std::true_type {};
+
+        /**
+         * @brief Prefetches where a lookup of the key will go
+         * @details The open-addressing tables prefetch the home slot and the sorted vectors their middle entry. The
+         * std unordered containers do not expose the address of a bucket, so the first entry of the key's bucket is
+         * found, which reads the bucket array, and that entry, usually the one the lookup wants, is prefetched.
+         */
+        template<typename table, typename key_type>
+        void prefetch_lookup(const table& container, const key_type& key) noexcept {
+            if constexpr (has_prefetch<table, key_type>::value) {
+                container.prefetch(key);
+            } else if constexpr (has_buckets<table>::value) {
+                auto bucket = container.bucket(key);
+                auto entry = container.begin(bucket);
+                if (entry != container.end(bucket)) prefetch_address(&*entry);
+            }
+        }
+
+        /** @brief Counts the buckets, slots or allocated entries of a container; a change means it rehashed or grew. */
+        template<typename table>
+        size_t table_slots(const table& container) noexcept {
+            if constexpr (has_buckets<table>::value) return container.bucket_count();
+            else if constexpr (has_capacity<table>::value) return container.capacity();
+            else return container.size();
+        }
+
+        /**
+         * @brief Estimates the bytes a container holds, without what its entries allocate themselves
+         * @details Exact for the containers above. For the std unordered containers, a pointer per bucket and a
+         * list node of the entry, a next pointer and a cached hash per entry.
+         */
+        template<typename table>
+        size_t table_bytes(const table& container) noexcept {
+            if constexpr (has_memory_bytes<table>::value) return container.memory_bytes();
+            else if constexpr (has_buckets<table>::value) {
+                return container.bucket_count() * sizeof(void*) + container.size() * (sizeof(typename table::value_type) + sizeof(void*) + sizeof(size_t));
+            } else {
+                return container.size() * sizeof(typename table::value_type);
+            }
+        }
+
+        /**
+         * @brief Adds the probe length of every entry of a hash container to a histogram
+         * @details histogram[i] counts the entries a lookup finds with i + 1 probes: the position of the entry in
+         * its bucket for chained containers, the distance from its home slot plus one for open addressing. Sorted
+         * vectors are searched, not probed, and add nothing.
+         */
+        template<typename table>
+        void add_probe_lengths(const table& container, std::vector<size_t>& histogram) {
+            auto add = [&](size_t length) {
+                if (histogram.size() < length) histogram.resize(length, 0);
+                ++histogram[length - 1];
+            };
+            if constexpr (has_buckets<table>::value) {
+                for (size_t bucket = 0; bucket < container.bucket_count(); ++bucket) {
+                    for (size_t length = 1; length <= container.bucket_size(bucket); ++length) add(length);
+                }
+            } else if constexpr (has_probes<table>::value) {
+                for (auto position = container.cbegin(); position != container.cend(); ++position) add(container.probe_length(position));
+            }
+        }
+    }
+
+    /**
+     * @ingroup Storage
+     * @brief Default storage policy: std::unordered_map and std::unordered_set everywhere
+     */
+    template<typename allocator = std::allocator<std::byte>>
+    struct basic_hash_storage {
+        using allocator_type = allocator;
+        template<typename key_type, typename mapped_type> using node_map =
+            std::unordered_map<key_type, mapped_type, std::hash<key_type>, std::equal_to<key_type>, detail::rebind_alloc<allocator, std::pair<const key_type, mapped_type>>>;
+        template<typename key_type, typename mapped_type> using edge_map =
+            std::unordered_map<key_type, mapped_type, std::hash<key_type>, std::equal_to<key_type>, detail::rebind_alloc<allocator, std::pair<const key_type, mapped_type>>>;
+        template<typename key_type> using key_set =
+            std::unordered_set<key_type, std::hash<key_type>, std::equal_to<key_type>, detail::rebind_alloc<allocator, key_type>>;
+    };
+
+    /**
+     * @ingroup Storage
+     * @brief Open-addressing flat maps for nodes, edges and the reverse index
+     *
+     * @note Insertion of a node may move every other node, so references to nodes are invalidated by insert_node.
+     */
+    template<typename allocator = std::allocator<std::byte>>
+    struct basic_flat_storage {
+        using allocator_type = allocator;
+        template<typename key_type, typename mapped_type> using node_map =
+            flat_hash_map<key_type, mapped_type, std::hash<key_type>, std::equal_to<key_type>, detail::rebind_alloc<allocator, std::pair<const key_type, mapped_type>>>;
+        template<typename key_type, typename mapped_type> using edge_map =
+            flat_hash_map<key_type, mapped_type, std::hash<key_type>, std::equal_to<key_type>, detail::rebind_alloc<allocator, std::pair<const key_type, mapped_type>>>;
+        template<typename key_type> using key_set =
+            flat_hash_set<key_type, std::hash<key_type>, std::equal_to<key_type>, detail::rebind_alloc<allocator, key_type>>;
+    };
+
+    /**
+     * @ingroup Storage
+     * @brief Sorted vectors for edges and the reverse index, std::unordered_map for nodes
+     *
+     * @details Suited to graphs where most nodes have a handful of edges: each edge costs only its key and weight,
+     * and iterating a node walks contiguous memory in key order. Inserting into a node with degree d costs O(d).
+     */
+    template<typename allocator = std::allocator<std::byte>>
+    struct basic_sorted_vector_storage {
+        using allocator_type = allocator;
+        template<typename key_type, typename mapped_type> using node_map =
+            std::unordered_map<key_type, mapped_type, std::hash<key_type>, std::equal_to<key_type>, detail::rebind_alloc<allocator, std::pair<const key_type, mapped_type>>>;
+        template<typename key_type, typename mapped_type> using edge_map =
+            sorted_vector_map<key_type, mapped_type, std::less<key_type>, detail::rebind_alloc<allocator, std::pair<key_type, mapped_type>>>;
+        template<typename key_type> using key_set =
+            sorted_vector_set<key_type, std::less<key_type>, detail::rebind_alloc<allocator, key_type>>;
+    };
+
+    /**
+     * @ingroup Storage
+     * @brief Any storage policy with the operation counters of the graph turned on
+     *
+     * @details Uses the containers and the allocator of base. A Graph with this policy counts its lookups,
+     * insertions, erasures and the rehashes of its node and edge maps (see Graph::operations). The counters are
+     * relaxed atomics, so concurrent const lookups stay safe. With any other policy the counting compiles to
+     * nothing.
+     */
+    template<typename base>
+    struct instrumented_storage : base {
+        static constexpr bool instrumented = true;
+    };
+
+    namespace detail {
+        /** @brief Checks if a storage policy turns the operation counters on. */
+        template<typename storage, typename = void>
+        struct storage_instrumented : std::false_type {};
+
+        template<typename storage>
+        struct storage_instrumented<storage, std::void_t<decltype(storage::instrumented)>> : std::bool_constant<storage::instrumented> {};
+    }
+
+    using hash_storage = basic_hash_storage<>; /**< @ingroup Storage @brief basic_hash_storage with std::allocator. */
+    using flat_storage = basic_flat_storage<>; /**< @ingroup Storage @brief basic_flat_storage with std::allocator. */
+    using sorted_vector_storage = basic_sorted_vector_storage<>; /**< @ingroup Storage @brief basic_sorted_vector_storage with std::allocator. */
+
+    /**
+     * @ingroup Storage
+     * @brief Storage policies that allocate from a std::pmr::memory_resource
+     *
+     * @details Construct the graph with the resource, for example `Graph<int, int, int, true, pmr::hash_storage>
+     * graph(&arena)` with a std::pmr::monotonic_buffer_resource arena, which frees the whole graph at once, or a
+     * std::pmr::unsynchronized_pool_resource owned by a single builder thread.
+     */
+    namespace pmr {
+        using hash_storage = basic_hash_storage<std::pmr::polymorphic_allocator<std::byte>>;
+        using flat_storage = basic_flat_storage<std::pmr::polymorphic_allocator<std::byte>>;
+        using sorted_vector_storage = basic_sorted_vector_storage<std::pmr::polymorphic_allocator<std::byte>>;
+    }
+}
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "Graph.h"
+
+namespace graph {
+    /**
+     * @defgroup Subgraphs Subgraphs and neighborhoods
+     *
+     * @brief Looking at part of a graph without copying it
+     *
+     * @details A SubgraphView is a Graph or CsrGraph seen through a mask of its nodes and, on a CsrGraph, of its
+     * edges; nothing of the graph is copied, and ids stay those of the graph. A KHopExtractor collects the k-hop
+     * neighborhood of a node with scratch memory it keeps between calls, so one extraction costs in the size of the
+     * neighborhood rather than of the graph. Both can materialize what they select as a SubgraphCsr, a compact CSR
+     * renumbered from 0.
+     */
+
+    /**
+     * @ingroup Subgraphs
+     * @brief A compact CSR of a subgraph, renumbered from 0, with the ids the nodes had in the source graph
+     *
+     * @tparam weight_type - type of the weight of the edge
+     */
+    template<typename weight_type>
+    struct SubgraphCsr {
+        std::vector<vertex_id> vertices; /**< @brief The id in the source graph of every node; local node i is vertices[i]. */
+        std::vector<size_t> offsets{0}; /**< @brief Row starts; the edges of local node i occupy [offsets[i], offsets[i + 1]). */
+        std::vector<vertex_id> neighbors; /**< @brief Local target ids of all edges, every row sorted. */
+        std::vector<weight_type> weights; /**< @brief Weights of all edges, parallel to neighbors. */
+
+        size_t size() const noexcept { return vertices.size(); } /**< @brief Counts the nodes. */
+        size_t edge_count() const noexcept { return neighbors.size(); } /**< @brief Counts the edges. */
+        size_t degree_out(vertex_id id) const noexcept { return offsets[id + 1] - offsets[id]; } /**< @brief Counts the edges of a local node. */
+    };
+
+    namespace detail {
+        /**
+         * @brief How a subgraph reads the rows of a graph type
+         *
+         * @details for_each_edge(graph, source, visit) calls visit(target, weight, position) for every edge of the
+         * source, where position is the index of the edge in the CSR arrays, or 0 where there are none.
+         */
+        template<typename graph_type>
+        struct subgraph_traits;
+
+        template<typename key_type, typename value_type, typename weight_type>
+        struct subgraph_traits<CsrGraph<key_type, value_type, weight_type>> {
+            using weight = weight_type;
+            static constexpr bool edge_positions = true;
+
+            template<typename function_type>
+            static void for_each_edge(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id source, function_type&& visit) {
+                auto const &offsets = graph.offsets();
+                auto const &neighbors = graph.neighbors();
+                auto const &weights = graph.weights();
+                for (size_t edge = offsets[source]; edge < offsets[source + 1]; ++edge) visit(neighbors[edge], weights[edge], edge);
+            }
+        };
+
+        /** @details Every target key is translated to its interned id with a lookup. */
+        template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+        struct subgraph_traits<Graph<key_type, value_type, weight_type, reverse_index, storage>> {
+            using weight = weight_type;
+            static constexpr bool edge_positions = false;
+
+            template<typename function_type>
+            static void for_each_edge(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, vertex_id source, function_type&& visit) {
+                for (auto const &edge: graph.at(graph.key_of(source)).getedges()) visit(graph.id_of(edge.first), edge.second, size_t{0});
+            }
+        };
+
+        /** @brief Sorts the row of every local node of a SubgraphCsr by target. */
+        template<typename weight_type>
+        void sort_rows(SubgraphCsr<weight_type>& result, std::vector<std::pair<vertex_id, weight_type>>& row) {
+            for (size_t node = 0; node < result.size(); ++node) {
+                size_t begin = result.offsets[node];
+                size_t end = result.offsets[node + 1];
+                if (end - begin < 2) continue;
+                row.clear();
+                for (size_t edge = begin; edge < end; ++edge) row.emplace_back(result.neighbors[edge], std::move(result.weights[edge]));
+                std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+                for (size_t edge = begin; edge < end; ++edge) {
+                    result.neighbors[edge] = row[edge - begin].first;
+                    result.weights[edge] = std::move(row[edge - begin].second);
+                }
+            }
+        }
+    }
+
+    /**
+     * @ingroup Subgraphs
+     * @brief A Graph or CsrGraph restricted to the nodes and edges of bit masks, without copying it
+     *
+     * @details
+     * The view refers to the graph and holds a bit per node, and on a CsrGraph optionally a bit per edge, indexed
+     * by the position of the edge in neighbors(). An edge is in the view if its bit is set, or there is no edge
+     * mask, and both of its ends are. Ids are those of the graph, so results computed on the view index the same
+     * arrays.
+     *
+     * The view stays valid as long as the graph is alive and not modified.
+     *
+     * @tparam graph_type - Graph or CsrGraph
+     */
+    template<typename graph_type>
+    class SubgraphView {
+    public:
+        using weight_type = typename detail::subgraph_traits<graph_type>::weight;
+
+        SubgraphView(const graph_type& graph, detail::bit_vector vertices);
+        SubgraphView(const graph_type& graph, detail::bit_vector vertices, detail::bit_vector edges);
+
+        const graph_type& graph() const noexcept { return *m_graph; } /**< @brief Returns the viewed graph. */
+        size_t size() const noexcept { return m_graph->size(); } /**< @brief Counts the ids of the graph, in the view or not. */
+        size_t node_count() const noexcept { return m_nodes; } /**< @brief Counts the nodes in the view. */
+        bool contains(vertex_id id) const noexcept { return id < size() && m_vertices.test(id); } /**< @brief Checks if the node is in the view. */
+        bool contains_edge(size_t position) const noexcept { return m_edges.size() == 0 || m_edges.test(position); } /**< @brief Checks the edge mask. */
+
+        /** @brief Calls visit(id) for every node in the view, in id order. */
+        template<typename function_type>
+        void for_each_node(function_type&& visit) const { m_vertices.for_each_set(visit); }
+        /** @brief Calls visit(target, weight) for every edge of the source in the view; the source must be in the view. */
+        template<typename function_type>
+        void for_each_edge(vertex_id source, function_type&& visit) const;
+        size_t degree_out(vertex_id id) const; /**< @brief Counts the edges of the node in the view, in O(degree). */
+
+        /** @brief Returns the nodes of the view, in id order. */
+        std::vector<vertex_id> nodes() const;
+        /** @brief Copies the view into a compact CSR; local ids follow the order of the ids in the graph. */
+        SubgraphCsr<weight_type> materialize() const;
+    private:
+        const graph_type* m_graph;
+        detail::bit_vector m_vertices; /**< @brief One bit per id of the graph, set if the node is in the view. */
+        detail::bit_vector m_edges; /**< @brief One bit per edge of a CsrGraph, set if the edge is in the view; empty for all edges. */
+        size_t m_nodes = 0;
+    };
+
+    namespace detail {
+        template<typename graph_type>
+        struct subgraph_traits<SubgraphView<graph_type>> {
+            using weight = typename subgraph_traits<graph_type>::weight;
+            static constexpr bool edge_positions = false;
+
+            template<typename function_type>
+            static void for_each_edge(const SubgraphView<graph_type>& view, vertex_id source, function_type&& visit) {
+                if (!view.contains(source)) return;
+                view.for_each_edge(source, [&](vertex_id target, const weight& value) { visit(target, value, size_t{0}); });
+            }
+        };
+    }
+
+    /** @throws If the mask does not have one bit per id, throws GraphException. */
+    template<typename graph_type>
+    SubgraphView<graph_type>::SubgraphView(const graph_type& graph, detail::bit_vector vertices)
+        : m_graph(&graph), m_vertices(std::move(vertices)) {
+        if (m_vertices.size() != graph.size()) throw GraphException("Size mismatch");
+        m_vertices.for_each_set([&](size_t) { ++m_nodes; });
+    }
+
+    /**
+     * @details Only for a CsrGraph, whose edges have positions.
+     * @throws If a mask does not have one bit per id or per edge, throws GraphException.
+     */
+    template<typename graph_type>
+    SubgraphView<graph_type>::SubgraphView(const graph_type& graph, detail::bit_vector vertices, detail::bit_vector edges)
+        : SubgraphView(graph, std::move(vertices)) {
+        static_assert(detail::subgraph_traits<graph_type>::edge_positions, "Edge masks need a graph with edge positions");
+        if (edges.size() != graph.edge_count()) throw GraphException("Size mismatch");
+        m_edges = std::move(edges);
+    }
+
+    template<typename graph_type>
+    template<typename function_type>
+    void SubgraphView<graph_type>::for_each_edge(vertex_id source, function_type&& visit) const {
+        detail::subgraph_traits<graph_type>::for_each_edge(*m_graph, source, [&](vertex_id target, const weight_type& weight, size_t position) {
+            if (m_vertices.test(target) && contains_edge(position)) visit(target, weight);
+        });
+    }
+
+    template<typename graph_type>
+    size_t SubgraphView<graph_type>::degree_out(vertex_id id) const {
+        size_t degree = 0;
+        for_each_edge(id, [&](vertex_id, const weight_type&) { ++degree; });
+        return degree;
+    }
+
+    template<typename graph_type>
+    std::vector<vertex_id> SubgraphView<graph_type>::nodes() const {
+        std::vector<vertex_id> result;
+        result.reserve(m_nodes);
+        for_each_node([&](size_t id) { result.push_back(static_cast<vertex_id>(id)); });
+        return result;
+    }
+
+    /** @details The rows of a CsrGraph keep their order, since its rows are sorted and the renumbering is monotone. */
+    template<typename graph_type>
+    SubgraphCsr<typename SubgraphView<graph_type>::weight_type> SubgraphView<graph_type>::materialize() const {
+        SubgraphCsr<weight_type> result;
+        result.vertices = nodes();
+        std::vector<vertex_id> local(size(), no_vertex);
+        for (size_t id = 0; id < result.size(); ++id) local[result.vertices[id]] = static_cast<vertex_id>(id);
+        result.offsets.reserve(result.size() + 1);
+        for (auto source: result.vertices) {
+            for_each_edge(source, [&](vertex_id target, const weight_type& weight) {
+                result.neighbors.push_back(local[target]);
+                result.weights.push_back(weight);
+            });
+            result.offsets.push_back(result.neighbors.size());
+        }
+        if constexpr (!detail::subgraph_traits<graph_type>::edge_positions) {
+            std::vector<std::pair<vertex_id, weight_type>> row;
+            detail::sort_rows(result, row);
+        }
+        return result;
+    }
+
+    /**
+     * @ingroup Subgraphs
+     * @brief Returns the view of the subgraph induced by the given nodes: the nodes, and every edge between two of them
+     * @throws If an id is out of range, throws GraphException.
+     */
+    template<typename graph_type>
+    SubgraphView<graph_type> induced_subgraph(const graph_type& graph, const std::vector<vertex_id>& nodes) {
+        detail::bit_vector mask(graph.size());
+        for (auto id: nodes) {
+            if (id >= graph.size()) throw GraphException("Vertex not found");
+            mask.set(id);
+        }
+        return SubgraphView<graph_type>(graph, std::move(mask));
+    }
+
+    /**
+     * @ingroup Subgraphs
+     * @brief Returns the view of the nodes for which keep_node(id) is true, and the edges between them
+     */
+    template<typename graph_type, typename predicate_type>
+    SubgraphView<graph_type> filter_subgraph(const graph_type& graph, predicate_type&& keep_node) {
+        detail::bit_vector mask(graph.size());
+        for (size_t id = 0; id < graph.size(); ++id) {
+            if (keep_node(static_cast<vertex_id>(id))) mask.set(id);
+        }
+        return SubgraphView<graph_type>(graph, std::move(mask));
+    }
+
+    /**
+     * @ingroup Subgraphs
+     * @brief Returns the view of the nodes for which keep_node(id) is true, and the edges between them for which
+     * keep_edge(position) is true
+     *
+     * @details As in CsrGraph::filter_edges, position is the index of the edge into neighbors() and weights().
+     */
+    template<typename key_type, typename value_type, typename weight_type, typename node_predicate, typename edge_predicate>
+    SubgraphView<CsrGraph<key_type, value_type, weight_type>> filter_subgraph(const CsrGraph<key_type, value_type, weight_type>& graph,
+                                                                           node_predicate&& keep_node, edge_predicate&& keep_edge) {
+        detail::bit_vector nodes(graph.size());
+        for (size_t id = 0; id < graph.size(); ++id) {
+            if (keep_node(static_cast<vertex_id>(id))) nodes.set(id);
+        }
+        detail::bit_vector edges(graph.edge_count());
+        for (size_t edge = 0; edge < graph.edge_count(); ++edge) {
+            if (keep_edge(edge)) edges.set(edge);
+        }
+        return SubgraphView<CsrGraph<key_type, value_type, weight_type>>(graph, std::move(nodes), std::move(edges));
+    }
+
+    /**
+     * @ingroup Subgraphs
+     * @brief Collects the nodes within k hops of a node, over and over, in time proportional to the neighborhood
+     *
+     * @details
+     * The extractor keeps an array of one local id per node of the graph, allocated once and cleared after every
+     * extraction only where it was written, so each call only touches the neighborhood it returns. Nodes are
+     * collected breadth-first over the out-edges, and with a transposed graph over the in-edges as well, which
+     * gives the egocentric neighborhood of a directed graph. A limit on the number of nodes keeps the neighborhood
+     * of a hub from growing to the whole graph: the search stops once it is reached, part way through a level.
+     *
+     * An extractor is not thread-safe; give every thread its own. It refers to its graphs, which must outlive it
+     * and not change. graph_type can also be a SubgraphView, to extract within a filtered graph.
+     *
+     * @tparam graph_type - Graph, CsrGraph or SubgraphView
+     */
+    template<typename graph_type>
+    class KHopExtractor {
+    public:
+        using weight_type = typename detail::subgraph_traits<graph_type>::weight;
+
+        explicit KHopExtractor(const graph_type& graph);
+        KHopExtractor(const graph_type& graph, const graph_type& transposed);
+
+        const std::vector<vertex_id>& collect(vertex_id center, size_t hops, size_t max_nodes = 0);
+        /** @brief Returns where every level of the last collect ends: the nodes at distance h are [level_ends()[h - 1], level_ends()[h]), level 0 is the center. */
+        const std::vector<size_t>& level_ends() const noexcept { return m_level_ends; }
+        SubgraphCsr<weight_type> extract(vertex_id center, size_t hops, size_t max_nodes = 0);
+    private:
+        template<typename function_type>
+        void for_each_neighbor(vertex_id node, function_type&& visit) const;
+
+        const graph_type* m_graph;
+        const graph_type* m_transposed = nullptr;
+        std::vector<vertex_id> m_local; /**< @brief The local id of every node of the last neighborhood; no_vertex elsewhere. */
+        std::vector<vertex_id> m_nodes; /**< @brief The last neighborhood, in breadth-first order. */
+        std::vector<size_t> m_level_ends;
+        std::vector<std::pair<vertex_id, weight_type>> m_row; /**< @brief Scratch for sorting rows. */
+    };
+
+    template<typename graph_type>
+    KHopExtractor<graph_type>::KHopExtractor(const graph_type& graph) : m_graph(&graph), m_local(graph.size(), no_vertex) {}
+
+    /** @throws If the graphs do not have the same number of nodes, throws GraphException. */
+    template<typename graph_type>
+    KHopExtractor<graph_type>::KHopExtractor(const graph_type& graph, const graph_type& transposed) : KHopExtractor(graph) {
+        if (transposed.size() != graph.size()) throw GraphException("Size mismatch");
+        m_transposed = &transposed;
+    }
+
+    template<typename graph_type>
+    template<typename function_type>
+    void KHopExtractor<graph_type>::for_each_neighbor(vertex_id node, function_type&& visit) const {
+        auto forward = [&](vertex_id target, const weight_type&, size_t) { visit(target); };
+        detail::subgraph_traits<graph_type>::for_each_edge(*m_graph, node, forward);
+        if (m_transposed) detail::subgraph_traits<graph_type>::for_each_edge(*m_transposed, node, forward);
+    }
+
+    /**
+     * @brief Collects the nodes within hops hops of center in breadth-first order, center first
+     *
+     * @details The result stays valid until the next call. Nodes outside a SubgraphView are never reached; a
+     * center outside it is returned alone.
+     *
+     * @param[in] max_nodes The largest number of nodes to collect; 0 means no limit
+     * @throws If the id is out of range, throws GraphException.
+     */
+    template<typename graph_type>
+    const std::vector<vertex_id>& KHopExtractor<graph_type>::collect(vertex_id center, size_t hops, size_t max_nodes) {
+        if (center >= m_local.size()) throw GraphException("Vertex not found");
+        for (auto node: m_nodes) m_local[node] = no_vertex;
+        m_nodes.clear();
+        m_level_ends.clear();
+        if (max_nodes == 0) max_nodes = m_local.size();
+
+        m_local[center] = 0;
+        m_nodes.push_back(center);
+        m_level_ends.push_back(1);
+        size_t head = 0;
+        for (size_t level = 1; level <= hops && head < m_nodes.size() && m_nodes.size() < max_nodes; ++level) {
+            size_t end = m_nodes.size();
+            for (; head < end && m_nodes.size() < max_nodes; ++head) {
+                for_each_neighbor(m_nodes[head], [&](vertex_id neighbor) {
+                    if (m_local[neighbor] != no_vertex || m_nodes.size() >= max_nodes) return;
+                    m_local[neighbor] = static_cast<vertex_id>(m_nodes.size());
+                    m_nodes.push_back(neighbor);
+                });
+            }
+            head = end;
+            m_level_ends.push_back(m_nodes.size());
+        }
+        return m_nodes;
+    }
+
+    /**
+     * @brief Collects the neighborhood as collect does, and copies the subgraph it induces into a compact CSR
+     *
+     * @details Local ids follow the breadth-first order, so level_ends() applies to them too. Only the out-edges
+     * of the graph are copied, also with a transposed graph.
+     *
+     * @throws If the id is out of range, throws GraphException.
+     */
+    template<typename graph_type>
+    SubgraphCsr<typename KHopExtractor<graph_type>::weight_type> KHopExtractor<graph_type>::extract(vertex_id center, size_t hops, size_t max_nodes) {
+        collect(center, hops, max_nodes);
+        SubgraphCsr<weight_type> result;
+        result.vertices = m_nodes;
+        result.offsets.reserve(m_nodes.size() + 1);
+        for (auto source: m_nodes) {
+            detail::subgraph_traits<graph_type>::for_each_edge(*m_graph, source, [&](vertex_id target, const weight_type& weight, size_t) {
+                if (m_local[target] == no_vertex) return;
+                result.neighbors.push_back(m_local[target]);
+                result.weights.push_back(weight);
+            });
+            result.offsets.push_back(result.neighbors.size());
+        }
+        detail::sort_rows(result, m_row);
+        return result;
+    }
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "Parallel.h"
+
+namespace graph {
+    /** @defgroup Traversal Traversal */
+
+    /** @ingroup Traversal @brief Distance of a node that the traversal did not reach. */
+    constexpr size_t unreachable = std::numeric_limits<size_t>::max();
+
+    /**
+     * @ingroup Traversal
+     * @brief Result of a traversal, as dense arrays indexed by vertex id
+     */
+    struct TraversalResult {
+        std::vector<size_t> distance; /**< @brief Depth of every node in the traversal tree, or unreachable. */
+        std::vector<vertex_id> parent; /**< @brief Parent of every node in the traversal tree; the source is its own parent, unreached nodes have no_vertex. */
+        std::vector<vertex_id> order; /**< @brief The reached nodes in the order they were visited. */
+
+        bool reached(vertex_id id) const noexcept { return parent[id] != no_vertex; } /**< @brief Checks if the node was reached. */
+    };
+
+    /**
+     * @ingroup Traversal
+     * @brief Tuning knobs of the direction-optimizing BFS
+     *
+     * @details The search switches from top-down to bottom-up when the frontier has more than 1/alpha of the
+     * unexplored edges, and back when the frontier has fewer than 1/beta of the nodes.
+     */
+    struct BfsOptions {
+        size_t threads = 0; /**< @brief The number of workers; 0 means default_threads(). */
+        size_t alpha = 14; /**< @brief Edge ratio that switches a top-down search to bottom-up. */
+        size_t beta = 24; /**< @brief Node ratio that switches a bottom-up search back to top-down. */
+    };
+
+    namespace detail {
+        /** @brief Breadth-first search over nodes [0, size); for_each_neighbor(u, f) calls f(v) for every edge u -> v. */
+        template<typename neighbors_type>
+        TraversalResult serial_bfs(size_t size, vertex_id source, neighbors_type&& for_each_neighbor) {
+            if (source >= size) throw GraphException("Vertex not found");
+            TraversalResult result{std::vector<size_t>(size, unreachable), std::vector<vertex_id>(size, no_vertex), {}};
+            result.order.reserve(size);
+            result.distance[source] = 0;
+            result.parent[source] = source;
+            result.order.push_back(source);
+            for (size_t head = 0; head < result.order.size(); ++head) {
+                vertex_id node = result.order[head];
+                for_each_neighbor(node, [&](vertex_id neighbor) {
+                    if (result.parent[neighbor] != no_vertex) return;
+                    result.parent[neighbor] = node;
+                    result.distance[neighbor] = result.distance[node] + 1;
+                    result.order.push_back(neighbor);
+                });
+            }
+            return result;
+        }
+
+        /**
+         * @brief Depth-first search over nodes [0, size), iterative so deep graphs cannot overflow the call stack
+         *
+         * @details Nodes are marked when they are popped, and neighbors are pushed in reverse, so the visit order is
+         * the same as a recursive DFS that follows edges in iteration order.
+         */
+        template<typename neighbors_type>
+        TraversalResult serial_dfs(size_t size, vertex_id source, neighbors_type&& for_each_neighbor) {
+            if (source >= size) throw GraphException("Vertex not found");
+            TraversalResult result{std::vector<size_t>(size, unreachable), std::vector<vertex_id>(size, no_vertex), {}};
+            result.order.reserve(size);
+            std::vector<std::pair<vertex_id, vertex_id>> stack{{source, source}};
+            std::vector<vertex_id> children;
+            while (!stack.empty()) {
+                auto [node, parent] = stack.back();
+                stack.pop_back();
+                if (result.parent[node] != no_vertex) continue;
+                result.parent[node] = parent;
+                result.distance[node] = node == source ? 0 : result.distance[parent] + 1;
+                result.order.push_back(node);
+
+                children.clear();
+                for_each_neighbor(node, [&](vertex_id neighbor) {
+                    if (result.parent[neighbor] == no_vertex) children.push_back(neighbor);
+                });
+                for (auto child = children.rbegin(); child != children.rend(); ++child) stack.emplace_back(*child, node);
+            }
+            return result;
+        }
+
+        /** @brief Calls f(v) for every edge u -> v of a Graph, translating keys to interned ids. */
+        template<typename graph_type>
+        auto graph_neighbors(const graph_type& graph) {
+            return [&graph](vertex_id node, auto&& visit) {
+                for (auto const &edge: graph.at(graph.key_of(node)).getedges()) visit(graph.id_of(edge.first));
+            };
+        }
+
+        /** @brief Calls f(v) for every edge u -> v of a CsrGraph. */
+        template<typename csr_type>
+        auto csr_neighbors(const csr_type& graph) {
+            return [&graph](vertex_id node, auto&& visit) {
+                for (auto neighbor: graph[node].neighbors()) visit(neighbor);
+            };
+        }
+    }
+
+    /**
+     * @ingroup Traversal
+     * @brief Breadth-first search from the node with the given id
+     * @throws If the id is out of range, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    TraversalResult bfs(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id source) {
+        return detail::serial_bfs(graph.size(), source, detail::csr_neighbors(graph));
+    }
+
+    /**
+     * @ingroup Traversal
+     * @brief Breadth-first search from the node with the given key; the result is indexed by interned id
+     * @throws If the key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    TraversalResult bfs(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, const key_type& source) {
+        return detail::serial_bfs(graph.size(), graph.id_of(source), detail::graph_neighbors(graph));
+    }
+
+    /**
+     * @ingroup Traversal
+     * @brief Depth-first search from the node with the given id
+     * @throws If the id is out of range, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    TraversalResult dfs(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id source) {
+        return detail::serial_dfs(graph.size(), source, detail::csr_neighbors(graph));
+    }
+
+    /**
+     * @ingroup Traversal
+     * @brief Depth-first search from the node with the given key; the result is indexed by interned id
+     * @throws If the key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, bool reverse_index, typename storage>
+    TraversalResult dfs(const Graph<key_type, value_type, weight_type, reverse_index, storage>& graph, const key_type& source) {
+        return detail::serial_dfs(graph.size(), graph.id_of(source), detail::graph_neighbors(graph));
+    }
+
+    /**
+     * @ingroup Traversal
+     * @brief Parallel direction-optimizing breadth-first search
+     *
+     * @details
+     * Expands the search level by level. Top-down steps scan the out-edges of the frontier and claim unvisited
+     * neighbors with a compare-and-swap on their parent. Bottom-up steps scan the in-edges of every unvisited
+     * node and stop at the first parent found in the frontier, which is much cheaper once the frontier covers a
+     * large part of the graph. See BfsOptions for the switching rule.
+     *
+     * The order of the result lists the nodes level by level; the order within a level, and which of several
+     * frontier nodes becomes the parent, depend on scheduling.
+     *
+     * @param[in] graph The graph to search
+     * @param[in] transposed graph.transpose(), used by the bottom-up steps
+     * @param[in] source The id of the node to start from
+     * @throws If the id is out of range, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    TraversalResult parallel_bfs(const CsrGraph<key_type, value_type, weight_type>& graph,
+                                 const CsrGraph<key_type, value_type, weight_type>& transposed,
+                                 vertex_id source, const BfsOptions& options = {}) {
+        size_t size = graph.size();
+        if (source >= size) throw GraphException("Vertex not found");
+        size_t threads = options.threads == 0 ? default_threads() : options.threads;
+        auto const &offsets = graph.offsets();
+        auto const &neighbors = graph.neighbors();
+        auto const &in_offsets = transposed.offsets();
+        auto const &in_neighbors = transposed.neighbors();
+
+        std::vector<std::atomic<vertex_id>> parent(size);
+        TraversalResult result{std::vector<size_t>(size, unreachable), {}, {}};
+        parallel_for(0, size, [&](size_t first, size_t last, size_t) {
+            for (size_t node = first; node < last; ++node) parent[node].store(no_vertex, std::memory_order_relaxed);
+        }, threads);
+        parent[source].store(source, std::memory_order_relaxed);
+        result.distance[source] = 0;
+        result.order.reserve(size);
+        result.order.push_back(source);
+
+        std::vector<std::vector<vertex_id>> buffers(threads);
+        std::vector<std::uint8_t> in_frontier(size, 0);
+        size_t frontier_begin = 0;
+        size_t unexplored_edges = graph.edge_count() - graph.degree_out_by_id(source);
+        bool bottom_up = false;
+
+        for (size_t level = 1; frontier_begin < result.order.size(); ++level) {
+            size_t frontier_end = result.order.size();
+            size_t frontier_size = frontier_end - frontier_begin;
+            size_t frontier_edges = 0;
+            for (size_t index = frontier_begin; index < frontier_end; ++index) frontier_edges += graph.degree_out_by_id(result.order[index]);
+
+            if (!bottom_up && frontier_edges * options.alpha > unexplored_edges) bottom_up = true;
+            else if (bottom_up && frontier_size * options.beta < size) bottom_up = false;
+
+            if (bottom_up) {
+                std::fill(in_frontier.begin(), in_frontier.end(), 0);
+                for (size_t index = frontier_begin; index < frontier_end; ++index) in_frontier[result.order[index]] = 1;
+                parallel_for(0, size, [&](size_t first, size_t last, size_t worker) {
+                    auto &found = buffers[worker];
+                    for (size_t node = first; node < last; ++node) {
+                        if (parent[node].load(std::memory_order_relaxed) != no_vertex) continue;
+                        for (size_t edge = in_offsets[node]; edge < in_offsets[node + 1]; ++edge) {
+                            if (!in_frontier[in_neighbors[edge]]) continue;
+                            parent[node].store(in_neighbors[edge], std::memory_order_relaxed);
+                            result.distance[node] = level;
+                            found.push_back(static_cast<vertex_id>(node));
+                            break;
+                        }
+                    }
+                }, threads);
+            } else {
+                parallel_for(frontier_begin, frontier_end, [&](size_t first, size_t last, size_t worker) {
+                    auto &found = buffers[worker];
+                    for (size_t index = first; index < last; ++index) {
+                        vertex_id node = result.order[index];
+                        for (size_t edge = offsets[node]; edge < offsets[node + 1]; ++edge) {
+                            vertex_id neighbor = neighbors[edge];
+                            vertex_id expected = no_vertex;
+                            if (parent[neighbor].load(std::memory_order_relaxed) != no_vertex) continue;
+                            if (!parent[neighbor].compare_exchange_strong(expected, node, std::memory_order_relaxed)) continue;
+                            result.distance[neighbor] = level;
+                            found.push_back(neighbor);
+                        }
+                    }
+                }, threads);
+            }
+
+            frontier_begin = frontier_end;
+            for (auto &found: buffers) {
+                for (auto node: found) unexplored_edges -= graph.degree_out_by_id(node);
+                result.order.insert(result.order.end(), found.begin(), found.end());
+                found.clear();
+            }
+        }
+
+        result.parent.resize(size);
+        for (size_t node = 0; node < size; ++node) result.parent[node] = parent[node].load(std::memory_order_relaxed);
+        return result;
+    }
+
+    /** @ingroup Traversal @brief Parallel direction-optimizing BFS; computes the transposed graph itself. */
+    template<typename key_type, typename value_type, typename weight_type>
+    TraversalResult parallel_bfs(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id source, const BfsOptions& options = {}) {
+        if (source >= graph.size()) throw GraphException("Vertex not found");
+        return parallel_bfs(graph, graph.transpose(), source, options);
+    }
+}
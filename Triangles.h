@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "CsrGraph.h"
+#include "Graph.h"
+#include "Parallel.h"
+
+namespace graph {
+    /** @defgroup Triangles Triangles and common neighbors */
+
+    namespace detail {
+        /** @brief Intersections switch from merging to galloping when one list is this many times longer than the other. */
+        constexpr size_t gallop_ratio = 32;
+
+        /**
+         * @brief Intersects two sorted lists of distinct ids by merging them
+         *
+         * @details With AVX-512 or AVX2, whichever the compiler targets, compares blocks of 16 or 8 ids of the first
+         * list against every id of a block of the second list, and then drops the block whose last id is smaller.
+         * The rest is merged scalar.
+         *
+         * @tparam output - if true, the common ids are written to out in ascending order
+         * @return The number of common ids
+         */
+        template<bool output>
+        size_t intersect_merge(const vertex_id* first, size_t first_size, const vertex_id* second, size_t second_size, vertex_id* out) noexcept {
+            size_t i = 0;
+            size_t j = 0;
+            size_t count = 0;
+#if defined(__AVX512F__)
+            while (i + 16 <= first_size && j + 16 <= second_size) {
+                __m512i block = _mm512_loadu_si512(first + i);
+                __mmask16 match = 0;
+                for (size_t lane = 0; lane < 16; ++lane) {
+                    match |= _mm512_cmpeq_epi32_mask(block, _mm512_set1_epi32(static_cast<int>(second[j + lane])));
+                }
+                if constexpr (output) _mm512_mask_compressstoreu_epi32(out + count, match, block);
+                count += static_cast<size_t>(__builtin_popcount(match));
+                vertex_id first_last = first[i + 15];
+                vertex_id second_last = second[j + 15];
+                if (first_last <= second_last) i += 16;
+                if (second_last <= first_last) j += 16;
+            }
+#elif defined(__AVX2__)
+            while (i + 8 <= first_size && j + 8 <= second_size) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + i));
+                __m256i match = _mm256_setzero_si256();
+                for (size_t lane = 0; lane < 8; ++lane) {
+                    match = _mm256_or_si256(match, _mm256_cmpeq_epi32(block, _mm256_set1_epi32(static_cast<int>(second[j + lane]))));
+                }
+                auto mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(match)));
+                if constexpr (output) {
+                    for (unsigned bits = mask; bits != 0; bits &= bits - 1) out[count++] = first[i + static_cast<size_t>(__builtin_ctz(bits))];
+                } else {
+                    count += static_cast<size_t>(__builtin_popcount(mask));
+                }
+                vertex_id first_last = first[i + 7];
+                vertex_id second_last = second[j + 7];
+                if (first_last <= second_last) i += 8;
+                if (second_last <= first_last) j += 8;
+            }
+#endif
+            while (i < first_size && j < second_size) {
+                vertex_id a = first[i];
+                vertex_id b = second[j];
+                if constexpr (output) out[count] = a;
+                count += a == b;
+                i += a <= b;
+                j += b <= a;
+            }
+            return count;
+        }
+
+        /**
+         * @brief Intersects a short sorted list with a much longer one by galloping through the long one
+         * @details Every id of the short list is found with an exponential search from the last match, so the cost
+         * is O(short * log(long / short)) instead of O(short + long).
+         */
+        template<bool output>
+        size_t intersect_gallop(const vertex_id* small, size_t small_size, const vertex_id* large, size_t large_size, vertex_id* out) noexcept {
+            size_t position = 0;
+            size_t count = 0;
+            for (size_t i = 0; i < small_size && position < large_size; ++i) {
+                vertex_id id = small[i];
+                size_t bound = 1;
+                while (position + bound < large_size && large[position + bound] < id) bound *= 2;
+                position = static_cast<size_t>(std::lower_bound(large + position + bound / 2, large + std::min(large_size, position + bound + 1), id) - large);
+                if (position < large_size && large[position] == id) {
+                    if constexpr (output) out[count] = id;
+                    ++count;
+                    ++position;
+                }
+            }
+            return count;
+        }
+
+        /** @brief Intersects two sorted lists of distinct ids, merging or galloping depending on their sizes. */
+        template<bool output>
+        size_t intersect(const vertex_id* first, size_t first_size, const vertex_id* second, size_t second_size, vertex_id* out) noexcept {
+            if (first_size > second_size) {
+                std::swap(first, second);
+                std::swap(first_size, second_size);
+            }
+            if (first_size == 0) return 0;
+            if (second_size / first_size >= gallop_ratio) return intersect_gallop<output>(first, first_size, second, second_size, out);
+            return intersect_merge<output>(first, first_size, second, second_size, out);
+        }
+
+        /**
+         * @brief The undirected simple graph under a CsrGraph, relabeled by degree, with every edge kept only at its
+         * lower end
+         *
+         * @details Nodes are renumbered in order of undirected degree, ties broken by id, with a counting sort, and
+         * u keeps v if u < v. Every triangle then appears exactly once, at its lowest node, no row is longer than
+         * O(sqrt(edges)), and the rows of the hubs, which most intersections read, end up next to each other. Rows
+         * are sorted.
+         */
+        struct oriented_rows {
+            std::vector<size_t> offsets;
+            std::vector<vertex_id> neighbors;
+        };
+
+        template<typename csr_type>
+        oriented_rows orient_by_degree(const csr_type& graph, const csr_type& transposed, size_t threads) {
+            size_t size = graph.size();
+            auto const &out_offsets = graph.offsets();
+            auto const &in_offsets = transposed.offsets();
+            const vertex_id* out = graph.neighbors().data();
+            const vertex_id* in = transposed.neighbors().data();
+            auto row = [&](size_t node, auto&& visit) {
+                for_each_union(out + out_offsets[node], out_offsets[node + 1] - out_offsets[node],
+                               in + in_offsets[node], in_offsets[node + 1] - in_offsets[node], [&](vertex_id neighbor) {
+                    if (neighbor != node) visit(neighbor);
+                });
+            };
+
+            std::vector<size_t> degree(size, 0);
+            parallel_for_edges(out_offsets, [&](size_t first, size_t last, size_t) {
+                for (size_t node = first; node < last; ++node) row(node, [&](vertex_id) { ++degree[node]; });
+            }, threads);
+            std::vector<size_t> start(*std::max_element(degree.begin(), degree.end()) + 2, 0);
+            for (auto value: degree) ++start[value + 1];
+            for (size_t value = 1; value < start.size(); ++value) start[value] += start[value - 1];
+            std::vector<vertex_id> rank(size);
+            for (size_t node = 0; node < size; ++node) rank[node] = static_cast<vertex_id>(start[degree[node]]++);
+
+            oriented_rows result;
+            result.offsets.assign(size + 1, 0);
+            parallel_for_edges(out_offsets, [&](size_t first, size_t last, size_t) {
+                for (size_t node = first; node < last; ++node) {
+                    row(node, [&](vertex_id neighbor) { result.offsets[rank[node] + 1] += rank[node] < rank[neighbor]; });
+                }
+            }, threads);
+            for (size_t node = 0; node < size; ++node) result.offsets[node + 1] += result.offsets[node];
+            result.neighbors.resize(result.offsets.back());
+            parallel_for_edges(out_offsets, [&](size_t first, size_t last, size_t) {
+                for (size_t node = first; node < last; ++node) {
+                    auto begin = result.neighbors.begin() + static_cast<std::ptrdiff_t>(result.offsets[rank[node]]);
+                    auto next = begin;
+                    row(node, [&](vertex_id neighbor) {
+                        if (rank[node] < rank[neighbor]) *next++ = rank[neighbor];
+                    });
+                    std::sort(begin, next);
+                }
+            }, threads);
+            return result;
+        }
+    }
+
+    /**
+     * @ingroup Triangles
+     * @brief Returns the ids of the nodes that both u and v have an edge to, in ascending order
+     *
+     * @details The rows of a CsrGraph are sorted, so this is a merge, vectorized with AVX2 or AVX-512 when the
+     * compiler targets them, or a galloping search when one node has 32 times the degree of the other.
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    std::vector<vertex_id> common_neighbors(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id u, vertex_id v) {
+        auto first = graph[u].neighbors();
+        auto second = graph[v].neighbors();
+        std::vector<vertex_id> result(std::min(first.size(), second.size()));
+        result.resize(detail::intersect<true>(first.begin(), first.size(), second.begin(), second.size(), result.data()));
+        return result;
+    }
+
+    /** @ingroup Triangles @brief Counts the nodes that both u and v have an edge to, without materializing them. */
+    template<typename key_type, typename value_type, typename weight_type>
+    size_t common_neighbor_count(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id u, vertex_id v) noexcept {
+        auto first = graph[u].neighbors();
+        auto second = graph[v].neighbors();
+        return detail::intersect<false>(first.begin(), first.size(), second.begin(), second.size(), nullptr);
+    }
+
+    /**
+     * @ingroup Triangles
+     * @brief Jaccard similarity of the out-neighborhoods of u and v: common neighbors over all neighbors
+     * @return A value in [0, 1]; 0 if neither node has an edge
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    double jaccard_similarity(const CsrGraph<key_type, value_type, weight_type>& graph, vertex_id u, vertex_id v) noexcept {
+        size_t common = common_neighbor_count(graph, u, v);
+        size_t all = graph.degree_out_by_id(u) + graph.degree_out_by_id(v) - common;
+        return all == 0 ? 0.0 : static_cast<double>(common) / static_cast<double>(all);
+    }
+
+    /**
+     * @ingroup Triangles
+     * @brief Counts the triangles of the undirected simple graph under the given graph
+     *
+     * @details
+     * Edge directions, duplicates in both directions and self-loops are ignored. The edges are oriented from the
+     * lower- to the higher-degree end (see detail::oriented_rows), and every oriented edge u -> v adds the number of
+     * common neighbors of u and v above v: the part of the row of u after v, intersected with the row of v. The
+     * rows are split into edge-balanced chunks, which idle workers steal.
+     *
+     * @param[in] transposed graph.transpose(), which supplies the incoming edges
+     * @param[in] threads The number of workers; 0 means default_threads()
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    std::uint64_t triangle_count(const CsrGraph<key_type, value_type, weight_type>& graph, const CsrGraph<key_type, value_type, weight_type>& transposed, size_t threads = 0) {
+        if (transposed.size() != graph.size()) throw GraphException("Size mismatch");
+        if (threads == 0) threads = default_threads();
+        if (graph.empty()) return 0;
+        auto oriented = detail::orient_by_degree(graph, transposed, threads);
+        auto const &offsets = oriented.offsets;
+        const vertex_id* neighbors = oriented.neighbors.data();
+        std::vector<std::uint64_t> counts(threads, 0);
+        parallel_for_edges(offsets, [&](size_t first, size_t last, size_t worker) {
+            std::uint64_t count = 0;
+            for (size_t u = first; u < last; ++u) {
+                for (size_t edge = offsets[u]; edge < offsets[u + 1]; ++edge) {
+                    vertex_id v = neighbors[edge];
+                    count += detail::intersect<false>(neighbors + edge + 1, offsets[u + 1] - edge - 1,
+                                                      neighbors + offsets[v], offsets[v + 1] - offsets[v], nullptr);
+                }
+            }
+            counts[worker] += count;
+        }, threads);
+        std::uint64_t total = 0;
+        for (auto count: counts) total += count;
+        return total;
+    }
+
+    /** @ingroup Triangles @brief Counts the triangles; computes the transposed graph itself. */
+    template<typename key_type, typename value_type, typename weight_type>
+    std::uint64_t triangle_count(const CsrGraph<key_type, value_type, weight_type>& graph, size_t threads = 0) {
+        return triangle_count(graph, graph.transpose(), threads);
+    }
+}
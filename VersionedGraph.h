@@ -0,0 +1,486 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Graph.h"
+
+namespace graph {
+    namespace detail {
+        /**
+         * @brief Vector split into shared chunks, copied on the first write after a snapshot
+         *
+         * @details
+         * The vector is a root table of pointers to fixed-size chunks. Copying it copies one pointer, so copies share
+         * every chunk. Every root and chunk is stamped with the epoch it was created in, and write(position, epoch)
+         * changes it in place only if the stamp matches; otherwise it copies the root and the chunk first and stamps
+         * the copies. A writer that moves to a new epoch whenever it hands out a copy therefore never changes what a
+         * copy sees, and copies each root and chunk at most once per epoch. Only the owner calls write and push_back,
+         * so the check needs no synchronization.
+         */
+        template<typename item_type, size_t chunk_size>
+        class cow_vector {
+        public:
+            size_t size() const noexcept { return m_size; } /**< @brief Returns the number of items. */
+            const item_type& operator[](size_t position) const noexcept { return m_root->chunks[position / chunk_size]->items[position % chunk_size]; }
+            item_type& write(size_t position, std::uint64_t epoch);
+            void push_back(item_type item, std::uint64_t epoch);
+        private:
+            struct chunk {
+                std::uint64_t epoch;
+                std::array<item_type, chunk_size> items;
+            };
+            struct root {
+                std::uint64_t epoch;
+                std::vector<std::shared_ptr<chunk>> chunks;
+            };
+
+            root& own_root(std::uint64_t epoch);
+
+            std::shared_ptr<root> m_root = std::make_shared<root>(root{0, {}});
+            size_t m_size = 0;
+        };
+
+        template<typename item_type, size_t chunk_size>
+        typename cow_vector<item_type, chunk_size>::root& cow_vector<item_type, chunk_size>::own_root(std::uint64_t epoch) {
+            if (m_root->epoch != epoch) m_root = std::make_shared<root>(root{epoch, m_root->chunks});
+            return *m_root;
+        }
+
+        /** @brief Returns the item at the given position for writing, copying its chunk if an older epoch shares it. */
+        template<typename item_type, size_t chunk_size>
+        item_type& cow_vector<item_type, chunk_size>::write(size_t position, std::uint64_t epoch) {
+            auto &slot = own_root(epoch).chunks[position / chunk_size];
+            if (slot->epoch != epoch) {
+                slot = std::make_shared<chunk>(*slot);
+                slot->epoch = epoch;
+            }
+            return slot->items[position % chunk_size];
+        }
+
+        template<typename item_type, size_t chunk_size>
+        void cow_vector<item_type, chunk_size>::push_back(item_type item, std::uint64_t epoch) {
+            if (m_size % chunk_size == 0) own_root(epoch).chunks.push_back(std::make_shared<chunk>(chunk{epoch, {}}));
+            write(m_size, epoch) = std::move(item);
+            ++m_size;
+        }
+    }
+
+    /**
+     * @ingroup Graph
+     * @brief Graph for one writer whose snapshots are O(1) and stay consistent while it keeps writing
+     *
+     * @details
+     * Nodes live in copy-on-write chunks (detail::cow_vector) indexed by an internal id, and so do the in-degrees
+     * and the key index, which is split over shard_count maps by the hash of the key. A snapshot copies three root
+     * pointers and moves the writer to a new version. After that the writer copies whatever it changes: the root
+     * tables once, each touched chunk of 64 nodes, 512 in-degrees or one index shard once, and each touched node
+     * with its edges once. Untouched nodes stay shared between the graph and all of its snapshots, so memory grows
+     * with what changed, not with the graph. A snapshot keeps its version of the nodes alive until it is destroyed.
+     *
+     * Only one thread may write, take snapshots or publish; a Snapshot never changes and can be read from any number
+     * of threads. publish() stores a snapshot that readers on other threads pick up with latest().
+     *
+     * The interface follows ConcurrentGraph. Erasing a node scans the nodes for incoming edges, as Graph does without
+     * its reverse index, and its id is reused by the next inserted node.
+     *
+     * @tparam key_type - type of the key of the node
+     * @tparam value_type - type of the value of the node
+     * @tparam weight_type - type of the weight of the edge
+     * @tparam shard_count - the number of shared maps the key index is split into
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count = 256>
+    class VersionedGraph {
+        static_assert(shard_count > 0, "VersionedGraph needs at least one shard");
+    public:
+        class Node;
+        class Snapshot;
+
+        VersionedGraph() = default;
+        VersionedGraph(const VersionedGraph&) = delete;
+        VersionedGraph& operator=(const VersionedGraph&) = delete;
+
+        bool empty() const noexcept { return m_head.empty(); } /**< @brief Checks if the graph is empty. */
+        size_t size() const noexcept { return m_head.size(); } /**< @brief Counts the number of nodes in the graph. */
+        size_t edge_count() const noexcept { return m_head.edge_count(); } /**< @brief Counts the number of edges in the graph. */
+        std::uint64_t version() const noexcept { return m_head.version(); } /**< @brief Returns the version the next snapshot will have. */
+
+        bool contains(const key_type& key) const { return m_head.contains(key); } /**< @brief Checks if a node with the given key exists. */
+        std::optional<value_type> find(const key_type& key) const { return m_head.find(key); } /**< @brief Returns a copy of the value of the node, or nothing. */
+        size_t degree_in(const key_type& key) const { return m_head.degree_in(key); } /**< @brief Counts the number of edges that end in the node with the given key. */
+        size_t degree_out(const key_type& key) const { return m_head.degree_out(key); } /**< @brief Counts the number of edges that start in the node with the given key. */
+        bool has_edge(const key_type& source, const key_type& target) const { return m_head.has_edge(source, target); } /**< @brief Checks if there is an edge from source to target. */
+        const Snapshot& head() const noexcept { return m_head; } /**< @brief Returns the current state for reading on the writer thread; it changes with every write. */
+
+        /** @brief Inserts a node with the given key and value. */
+        bool insert_node(const key_type& key, const value_type& value);
+        /** @brief Inserts or assigns a node with the given key and value. */
+        bool insert_or_assign_node(const key_type& key, const value_type& value);
+        /** @brief Inserts an edge. */
+        bool insert_edge(const std::pair<key_type, key_type>& end_points, const weight_type& weight);
+        /** @brief Inserts or assigns an edge. */
+        bool insert_or_assign_edge(const std::pair<key_type, key_type>& end_points, const weight_type& weight);
+        bool erase_edge(const key_type& source, const key_type& target);
+        bool erase_node(const key_type& key);
+
+        Snapshot snapshot();
+        void publish();
+        std::shared_ptr<const Snapshot> latest() const;
+    private:
+        Node& own_node(vertex_id id);
+        template<bool assign>
+        bool insert_edge_impl(const std::pair<key_type, key_type>& end_points, const weight_type& weight);
+
+        Snapshot m_head;
+        std::vector<vertex_id> m_free; /**< @brief Ids of erased nodes, reused by the next insertions. */
+        mutable std::mutex m_published_mutex;
+        std::shared_ptr<const Snapshot> m_published;
+    };
+
+    /**
+     * @ingroup Graph
+     * @brief Node of a VersionedGraph
+     *
+     * @details Never changes once a snapshot can see it; the writer changes a copy instead.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    class VersionedGraph<key_type, value_type, weight_type, shard_count>::Node {
+        friend class VersionedGraph;
+    public:
+        Node(key_type key, value_type value, std::uint64_t epoch) : m_key(std::move(key)), m_value(std::move(value)), m_epoch(epoch) {}
+
+        size_t size() const noexcept { return m_edge.size(); } /**< @brief Returns the number of edges in the node. */
+        const key_type &getkey() const noexcept { return m_key; } /**< @brief Returns the key of the node. */
+        const value_type &getvalue() const noexcept { return m_value; } /**< @brief Returns the value of the node. */
+        const std::unordered_map<key_type, weight_type> &getedges() const noexcept { return m_edge; } /**< @brief Returns the map of edges. */
+    private:
+        key_type m_key; /**< @brief The key of the node. */
+        value_type m_value; /**< @brief The value of the node. */
+        std::unordered_map<key_type, weight_type> m_edge; /**< @brief The edges of the node. */
+        std::uint64_t m_epoch; /**< @brief The version the node was copied in; the writer changes it in place only within that version. */
+    };
+
+    /**
+     * @ingroup Graph
+     * @brief Immutable version of a VersionedGraph
+     *
+     * @details Cheap to copy, since copies share everything. References it hands out stay valid while it lives.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    class VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot {
+        friend class VersionedGraph;
+    public:
+        bool empty() const noexcept { return m_size == 0; } /**< @brief Checks if the graph is empty. */
+        size_t size() const noexcept { return m_size; } /**< @brief Counts the number of nodes in the graph. */
+        size_t edge_count() const noexcept { return m_edges; } /**< @brief Counts the number of edges in the graph. */
+        std::uint64_t version() const noexcept { return m_version; } /**< @brief Returns the version of the snapshot. */
+
+        bool contains(const key_type& key) const { return locate(key) != no_vertex; } /**< @brief Checks if a node with the given key exists. */
+        std::optional<value_type> find(const key_type& key) const;
+        const Node& at(const key_type& key) const;
+        template<typename function_type>
+        bool visit(const key_type& key, function_type&& function) const;
+        template<typename function_type>
+        void for_each_node(function_type&& function) const;
+
+        size_t degree_in(const key_type& key) const; /**< @brief Counts the number of edges that end in the node with the given key. */
+        size_t degree_out(const key_type& key) const { return at(key).size(); } /**< @brief Counts the number of edges that start in the node with the given key. */
+        bool has_edge(const key_type& source, const key_type& target) const;
+        std::optional<weight_type> edge_weight(const key_type& source, const key_type& target) const;
+
+        Graph<key_type, value_type, weight_type> to_graph() const;
+    private:
+        Snapshot();
+
+        static size_t shard_of(const key_type& key) noexcept { return std::hash<key_type>{}(key) % shard_count; }
+        vertex_id locate(const key_type& key) const;
+
+        detail::cow_vector<std::unordered_map<key_type, vertex_id>, 1> m_index; /**< @brief The ids of the keys, one map per shard. */
+        detail::cow_vector<std::shared_ptr<Node>, 64> m_nodes; /**< @brief The nodes by id; null for erased ids. */
+        detail::cow_vector<size_t, 512> m_in; /**< @brief The in-degrees by id. */
+        size_t m_size = 0;
+        size_t m_edges = 0;
+        std::uint64_t m_version = 0;
+    };
+
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::Snapshot() {
+        for (size_t shard = 0; shard < shard_count; ++shard) m_index.push_back({}, m_version);
+    }
+
+    /** @details Returns no_vertex if the key is not found. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    vertex_id VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::locate(const key_type &key) const {
+        auto const &shard = m_index[shard_of(key)];
+        auto find = shard.find(key);
+        return find == shard.end() ? no_vertex : find->second;
+    }
+
+    /** @brief Returns a copy of the value of the node with the given key, or nothing if it does not exist. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    std::optional<value_type> VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::find(const key_type &key) const {
+        vertex_id id = locate(key);
+        if (id == no_vertex) return std::nullopt;
+        return m_nodes[id]->m_value;
+    }
+
+    /**
+     * @brief Returns the node with the given key.
+     * @throws If the key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    const typename VersionedGraph<key_type, value_type, weight_type, shard_count>::Node&
+    VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::at(const key_type &key) const {
+        vertex_id id = locate(key);
+        if (id == no_vertex) throw GraphException("Key not found");
+        return *m_nodes[id];
+    }
+
+    /**
+     * @brief Calls function(const Node&) on the node with the given key.
+     * @return False if the node does not exist, true otherwise
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    template<typename function_type>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::visit(const key_type &key, function_type&& function) const {
+        vertex_id id = locate(key);
+        if (id == no_vertex) return false;
+        function(static_cast<const Node&>(*m_nodes[id]));
+        return true;
+    }
+
+    /** @brief Calls function(const Node&) on every node, in no particular order. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    template<typename function_type>
+    void VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::for_each_node(function_type&& function) const {
+        for (size_t id = 0; id < m_nodes.size(); ++id) {
+            if (m_nodes[id]) function(static_cast<const Node&>(*m_nodes[id]));
+        }
+    }
+
+    /** @throws If the key is not found, throws GraphException. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    size_t VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::degree_in(const key_type &key) const {
+        vertex_id id = locate(key);
+        if (id == no_vertex) throw GraphException("Key not found");
+        return m_in[id];
+    }
+
+    /**
+     * @brief Checks if there is an edge from source to target.
+     * @throws If the source key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::has_edge(const key_type &source, const key_type &target) const {
+        auto const &edges = at(source).m_edge;
+        return edges.find(target) != edges.end();
+    }
+
+    /**
+     * @brief Returns the weight of the edge from source to target, or nothing if there is no such edge.
+     * @throws If the source key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    std::optional<weight_type> VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::edge_weight(const key_type &source, const key_type &target) const {
+        auto const &edges = at(source).m_edge;
+        auto find = edges.find(target);
+        if (find == edges.end()) return std::nullopt;
+        return find->second;
+    }
+
+    /** @brief Copies the snapshot into a Graph. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    Graph<key_type, value_type, weight_type> VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot::to_graph() const {
+        Graph<key_type, value_type, weight_type> graph;
+        graph.reserve(size());
+        std::vector<std::pair<std::pair<key_type, key_type>, weight_type>> edges;
+        edges.reserve(edge_count());
+        for_each_node([&](const Node &node) {
+            graph.insert_node(node.m_key, node.m_value);
+            for (auto const &edge: node.m_edge) edges.push_back({{node.m_key, edge.first}, edge.second});
+        });
+        graph.insert_edges(edges);
+        return graph;
+    }
+
+    /** @details Copies the node, and the chunk and the root table that hold it, unless this version already did. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    typename VersionedGraph<key_type, value_type, weight_type, shard_count>::Node&
+    VersionedGraph<key_type, value_type, weight_type, shard_count>::own_node(vertex_id id) {
+        auto &slot = m_head.m_nodes.write(id, version());
+        if (slot->m_epoch != version()) {
+            slot = std::make_shared<Node>(*slot);
+            slot->m_epoch = version();
+        }
+        return *slot;
+    }
+
+    /**
+     * @return True if the node was inserted, false if the key already existed
+     * @throws If the graph already holds no_vertex nodes, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::insert_node(const key_type &key, const value_type &value) {
+        if (m_head.contains(key)) return false;
+        auto node = std::make_shared<Node>(key, value, version());
+        vertex_id id;
+        if (!m_free.empty()) {
+            id = m_free.back();
+            m_free.pop_back();
+            m_head.m_nodes.write(id, version()) = std::move(node);
+        } else {
+            if (m_head.m_nodes.size() >= no_vertex) throw GraphException("Too many nodes");
+            id = static_cast<vertex_id>(m_head.m_nodes.size());
+            m_head.m_nodes.push_back(std::move(node), version());
+            m_head.m_in.push_back(0, version());
+        }
+        m_head.m_index.write(Snapshot::shard_of(key), version()).emplace(key, id);
+        ++m_head.m_size;
+        return true;
+    }
+
+    /**
+     * @details Like Graph::insert_or_assign_node, a replaced node loses its outgoing edges and keeps the incoming ones.
+     * @return True if the node was inserted, false if it was assigned
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::insert_or_assign_node(const key_type &key, const value_type &value) {
+        if (insert_node(key, value)) return true;
+        Node &node = own_node(m_head.locate(key));
+        node.m_value = value;
+        for (auto const &edge: node.m_edge) --m_head.m_in.write(m_head.locate(edge.first), version());
+        m_head.m_edges -= node.m_edge.size();
+        node.m_edge.clear();
+        return false;
+    }
+
+    /**
+     * @details A failed insert_edge does not copy the source node.
+     * @throws If a key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    template<bool assign>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::insert_edge_impl(const std::pair<key_type, key_type> &end_points, const weight_type &weight) {
+        vertex_id source = m_head.locate(end_points.first);
+        vertex_id target = m_head.locate(end_points.second);
+        if (source == no_vertex || target == no_vertex) throw GraphException("Key not found");
+        if constexpr (!assign) {
+            auto const &edges = m_head.m_nodes[source]->m_edge;
+            if (edges.find(end_points.second) != edges.end()) return false;
+        }
+        Node &node = own_node(source);
+        bool inserted;
+        if constexpr (assign) inserted = node.m_edge.insert_or_assign(end_points.second, weight).second;
+        else inserted = node.m_edge.insert({end_points.second, weight}).second;
+        if (inserted) {
+            ++m_head.m_in.write(target, version());
+            ++m_head.m_edges;
+        }
+        return inserted;
+    }
+
+    /**
+     * @return True if the edge was inserted, false if it already existed
+     * @throws If a key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::insert_edge(const std::pair<key_type, key_type> &end_points, const weight_type &weight) {
+        return insert_edge_impl<false>(end_points, weight);
+    }
+
+    /**
+     * @return True if the edge was inserted, false if it was assigned
+     * @throws If a key is not found, throws GraphException.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::insert_or_assign_edge(const std::pair<key_type, key_type> &end_points, const weight_type &weight) {
+        return insert_edge_impl<true>(end_points, weight);
+    }
+
+    /**
+     * @brief Erases the edge from source to target.
+     * @return True if the edge was erased, false if it did not exist
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::erase_edge(const key_type &source, const key_type &target) {
+        vertex_id id = m_head.locate(source);
+        if (id == no_vertex) return false;
+        auto const &edges = m_head.m_nodes[id]->m_edge;
+        if (edges.find(target) == edges.end()) return false;
+        own_node(id).m_edge.erase(target);
+        --m_head.m_in.write(m_head.locate(target), version());
+        --m_head.m_edges;
+        return true;
+    }
+
+    /**
+     * @brief Erases the node with the given key and every edge that starts or ends in it.
+     * @details The scan for incoming edges stops once it has found as many as the in-degree of the node, and copies
+     * only the nodes that had one.
+     * @return True if the node was erased, false if it did not exist
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    bool VersionedGraph<key_type, value_type, weight_type, shard_count>::erase_node(const key_type &key) {
+        vertex_id id = m_head.locate(key);
+        if (id == no_vertex) return false;
+        std::shared_ptr<Node> node = m_head.m_nodes[id];
+        size_t incoming = m_head.m_in[id];
+        for (auto const &edge: node->m_edge) {
+            vertex_id target = m_head.locate(edge.first);
+            if (target == id) --incoming;
+            else --m_head.m_in.write(target, version());
+        }
+        m_head.m_edges -= node->m_edge.size();
+        for (size_t other = 0; other < m_head.m_nodes.size() && incoming > 0; ++other) {
+            auto const &origin = m_head.m_nodes[other];
+            if (other == id || !origin || origin->m_edge.find(key) == origin->m_edge.end()) continue;
+            own_node(static_cast<vertex_id>(other)).m_edge.erase(key);
+            --m_head.m_edges;
+            --incoming;
+        }
+        m_head.m_nodes.write(id, version()) = nullptr;
+        m_head.m_in.write(id, version()) = 0;
+        m_head.m_index.write(Snapshot::shard_of(key), version()).erase(key);
+        m_free.push_back(id);
+        --m_head.m_size;
+        return true;
+    }
+
+    /**
+     * @brief Returns the current version of the graph and moves the writer to the next one.
+     * @details O(1): the snapshot shares every node with the graph, and later writes copy what they change.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    typename VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot
+    VersionedGraph<key_type, value_type, weight_type, shard_count>::snapshot() {
+        Snapshot snapshot = m_head;
+        ++m_head.m_version;
+        return snapshot;
+    }
+
+    /** @brief Takes a snapshot and makes it the one latest() returns. */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    void VersionedGraph<key_type, value_type, weight_type, shard_count>::publish() {
+        auto published = std::make_shared<const Snapshot>(snapshot());
+        std::lock_guard lock(m_published_mutex);
+        m_published.swap(published);
+    }
+
+    /**
+     * @brief Returns the last published snapshot, or nullptr if nothing was published yet.
+     * @details Safe to call from any thread while the writer writes.
+     */
+    template<typename key_type, typename value_type, typename weight_type, size_t shard_count>
+    std::shared_ptr<const typename VersionedGraph<key_type, value_type, weight_type, shard_count>::Snapshot>
+    VersionedGraph<key_type, value_type, weight_type, shard_count>::latest() const {
+        std::lock_guard lock(m_published_mutex);
+        return m_published;
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * @file
+ * @brief Benchmarks of the Graph operations on seeded synthetic graphs
+ *
+ * @details
+ * Build from the repository root:
+ *
+ *     g++ -std=c++17 -O2 -pthread -I. bench/graph_bench.cpp -o graph_bench
+ *     ./graph_bench [max_nodes] [seed]
+ *
+ * For every generator and size, prints one line per operation: the mean time per call, the number of heap
+ * allocations per call, and for the building steps the heap bytes they added per node or per edge. Allocations
+ * are counted by replacing the global operator new, so the numbers are exact for this binary.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../CsrGraph.h"
+#include "../Generators.h"
+#include "../Graph.h"
+#include "../VersionedGraph.h"
+
+namespace {
+    size_t allocations = 0;
+    size_t bytes_in_use = 0;
+
+    /** @brief Every block is prefixed with its size so operator delete can keep bytes_in_use exact. */
+    constexpr size_t header = alignof(std::max_align_t);
+}
+
+void* operator new(size_t size) {
+    auto block = static_cast<char*>(std::malloc(size + header));
+    if (block == nullptr) throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(block) = size;
+    ++allocations;
+    bytes_in_use += size;
+    return block + header;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (pointer == nullptr) return;
+    auto block = reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(pointer) - header);
+    bytes_in_use -= *static_cast<size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept { operator delete(pointer); }
+
+namespace {
+    using key_type = std::uint32_t;
+    using weight_type = double;
+    using graph_type = graph::Graph<key_type, key_type, weight_type>;
+    using edge_list = graph::EdgeList<key_type, weight_type>;
+
+    volatile size_t sink = 0; /**< @brief Keeps the compiler from discarding the measured work. */
+
+    struct Measurement {
+        double nanoseconds = 0;
+        double allocations = 0;
+        double bytes = 0;
+    };
+
+    /** @brief Runs body once and divides the cost by the number of operations it performed. */
+    Measurement measure(size_t operations, const std::function<void()>& body) {
+        size_t allocations_before = allocations;
+        size_t bytes_before = bytes_in_use;
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto stop = std::chrono::steady_clock::now();
+        double count = static_cast<double>(operations == 0 ? 1 : operations);
+        return {std::chrono::duration<double, std::nano>(stop - start).count() / count,
+                static_cast<double>(allocations - allocations_before) / count,
+                (static_cast<double>(bytes_in_use) - static_cast<double>(bytes_before)) / count};
+    }
+
+    void report(const char* generator, size_t nodes, size_t edges, const char* operation, const Measurement& measurement, bool memory = false) {
+        std::printf("%-12s %10zu %10zu  %-22s %12.1f %10.2f", generator, nodes, edges, operation, measurement.nanoseconds, measurement.allocations);
+        if (memory) std::printf(" %10.1f", measurement.bytes);
+        std::printf("\n");
+    }
+
+    void run(const char* generator, size_t nodes, const edge_list& edges) {
+        graph_type graph;
+        report(generator, nodes, edges.size(), "insert_node", measure(nodes, [&] {
+            for (key_type key = 0; key < nodes; ++key) graph.insert_node(key, key);
+        }), true);
+        report(generator, nodes, edges.size(), "insert_edge", measure(edges.size(), [&] {
+            for (auto const &edge: edges) graph.insert_edge(edge.first, edge.second);
+        }), true);
+        report(generator, nodes, edges.size(), "insert_or_assign_edge", measure(edges.size(), [&] {
+            for (auto const &edge: edges) graph.insert_or_assign_edge(edge.first, edge.second + 1);
+        }));
+
+        graph_type bulk;
+        report(generator, nodes, edges.size(), "insert_edges (bulk)", measure(edges.size(), [&] {
+            bulk.reserve(nodes);
+            for (key_type key = 0; key < nodes; ++key) bulk.insert_node(key, key);
+            bulk.insert_edges(edges);
+        }), true);
+
+        const graph_type &query = graph;
+        report(generator, nodes, edges.size(), "find", measure(nodes, [&] {
+            for (key_type key = 0; key < nodes; ++key) sink = sink + (query.find(key) != query.end());
+        }));
+        report(generator, nodes, edges.size(), "degree_in", measure(nodes, [&] {
+            for (key_type key = 0; key < nodes; ++key) sink = sink + query.degree_in(key);
+        }));
+        report(generator, nodes, edges.size(), "degree_out", measure(nodes, [&] {
+            for (key_type key = 0; key < nodes; ++key) sink = sink + query.degree_out(key);
+        }));
+        report(generator, nodes, edges.size(), "loop", measure(nodes, [&] {
+            for (key_type key = 0; key < nodes; ++key) sink = sink + query.loop(key);
+        }));
+        report(generator, nodes, edges.size(), "has_edge", measure(edges.size(), [&] {
+            for (auto const &edge: edges) sink = sink + query.has_edge(edge.first.first, edge.first.second);
+        }));
+        report(generator, nodes, edges.size(), "stats", measure(1, [&] { sink = sink + query.stats().edges; }));
+        report(generator, nodes, edges.size(), "degree_histogram", measure(1, [&] { sink = sink + query.degree_histogram().out.size(); }));
+        report(generator, nodes, edges.size(), "iteration (per edge)", measure(edges.size(), [&] {
+            weight_type total = 0;
+            for (auto const &node: query) {
+                for (auto const &edge: node.second) total += edge.second;
+            }
+            sink = sink + static_cast<size_t>(total);
+        }));
+
+        graph::CsrGraph<key_type, key_type, weight_type> frozen;
+        report(generator, nodes, edges.size(), "freeze", measure(edges.size(), [&] { frozen = graph::freeze(query); }), true);
+        report(generator, nodes, edges.size(), "csr iteration", measure(edges.size(), [&] {
+            weight_type total = 0;
+            for (auto const &node: frozen) {
+                for (auto const &edge: node.second) total += edge.second;
+            }
+            sink = sink + static_cast<size_t>(total);
+        }));
+
+        report(generator, nodes, edges.size(), "copy", measure(1, [&] { graph_type copy = query; sink = sink + copy.size(); }));
+        graph::VersionedGraph<key_type, key_type, weight_type> versioned;
+        for (key_type key = 0; key < nodes; ++key) versioned.insert_node(key, key);
+        for (auto const &edge: edges) versioned.insert_edge(edge.first, edge.second);
+        std::vector<graph::VersionedGraph<key_type, key_type, weight_type>::Snapshot> snapshots;
+        report(generator, nodes, edges.size(), "snapshot", measure(1, [&] { snapshots.push_back(versioned.snapshot()); }), true);
+        report(generator, nodes, edges.size(), "write after snapshot", measure(nodes / 64, [&] {
+            for (key_type key = 0; key < nodes; key += 64) versioned.insert_or_assign_edge({key, key}, 1);
+        }), true);
+        sink = sink + snapshots.front().edge_count();
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t max_nodes = argc > 1 ? std::stoul(argv[1]) : size_t{1} << 16;
+    std::uint64_t seed = argc > 2 ? std::stoull(argv[2]) : 1;
+    constexpr size_t edge_factor = 8;
+
+    std::printf("%-12s %10s %10s  %-22s %12s %10s %10s\n", "generator", "nodes", "edges", "operation", "ns/op", "allocs/op", "bytes/op");
+    for (size_t nodes = 1024; nodes <= max_nodes; nodes *= 8) {
+        run("erdos-renyi", nodes, graph::erdos_renyi<key_type, weight_type>(nodes, nodes * edge_factor, seed));
+        run("rmat", nodes, graph::rmat<key_type, weight_type>(nodes, nodes * edge_factor, seed));
+        size_t side = 1;
+        while (side * side < nodes) ++side;
+        run("grid", side * side, graph::grid<key_type, weight_type>(side, side, seed));
+    }
+    return 0;
+}
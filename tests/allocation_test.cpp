@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @brief Checks that the read-only queries of Graph make no heap allocations
+ *
+ * @details
+ * Build and run from the repository root:
+ *
+ *     g++ -std=c++17 -O2 -pthread -I. tests/allocation_test.cpp -o allocation_test
+ *     ./allocation_test
+ *
+ * Replaces the global operator new with one that counts its calls, then runs has_edge, edge_weight, loop,
+ * degree_in and degree_out on graphs with std::string keys, for every storage policy, with and without the
+ * reverse index. The keys are longer than any small string buffer, so a copied key would allocate. Prints one
+ * line per failing query and exits with a nonzero status if any query allocated.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../Graph.h"
+#include "../Storage.h"
+
+namespace {
+    size_t allocations = 0;
+    int failures = 0;
+}
+
+void* operator new(size_t size) {
+    void* block = std::malloc(size == 0 ? 1 : size);
+    if (block == nullptr) throw std::bad_alloc();
+    ++allocations;
+    return block;
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+
+namespace {
+    /** @brief Runs the query and reports it if the number of allocations changed. */
+    template<typename function_type>
+    void expect_no_allocations(const char* graph_name, const char* query, function_type&& function) {
+        size_t before = allocations;
+        function();
+        size_t count = allocations - before;
+        if (count == 0) return;
+        std::printf("FAIL %-32s %-12s %zu allocations\n", graph_name, query, count);
+        ++failures;
+    }
+
+    /** @brief Builds a ring with chords and a loop over long string keys, then checks every query on it. */
+    template<typename graph_type>
+    void check(const char* graph_name) {
+        constexpr size_t nodes = 64;
+        std::vector<std::string> keys;
+        for (size_t node = 0; node < nodes; ++node) keys.push_back("a key longer than the small string buffer " + std::to_string(node));
+        graph_type graph;
+        for (auto const &key: keys) graph.insert_node(key, 0);
+        for (size_t node = 0; node < nodes; ++node) {
+            graph.insert_edge({keys[node], keys[(node + 1) % nodes]}, 1.0);
+            graph.insert_edge({keys[node], keys[(node * 7 + 3) % nodes]}, 2.0);
+        }
+        graph.insert_edge({keys[0], keys[0]}, 3.0);
+
+        const graph_type& view = graph;
+        size_t sink = 0;
+        expect_no_allocations(graph_name, "has_edge", [&] {
+            for (size_t node = 0; node < nodes; ++node) {
+                sink += view.has_edge(keys[node], keys[(node + 1) % nodes]);
+                sink += view.has_edge(keys[node], keys[(node + 2) % nodes]);
+            }
+        });
+        expect_no_allocations(graph_name, "edge_weight", [&] {
+            for (size_t node = 0; node < nodes; ++node) sink += static_cast<size_t>(view.edge_weight(keys[node], keys[(node + 1) % nodes]));
+        });
+        expect_no_allocations(graph_name, "loop", [&] {
+            for (auto const &key: keys) sink += view.loop(key);
+        });
+        expect_no_allocations(graph_name, "degree_in", [&] {
+            for (auto const &key: keys) sink += view.degree_in(key);
+        });
+        expect_no_allocations(graph_name, "degree_out", [&] {
+            for (auto const &key: keys) sink += view.degree_out(key);
+        });
+        if (sink == 0) std::printf("unexpected empty graph %s\n", graph_name);
+    }
+}
+
+int main() {
+    check<graph::Graph<std::string, int, double>>("hash_storage");
+    check<graph::Graph<std::string, int, double, false>>("hash_storage, no index");
+    check<graph::Graph<std::string, int, double, true, graph::flat_storage>>("flat_storage");
+    check<graph::Graph<std::string, int, double, false, graph::flat_storage>>("flat_storage, no index");
+    check<graph::Graph<std::string, int, double, true, graph::sorted_vector_storage>>("sorted_vector_storage");
+    check<graph::Graph<std::string, int, double, false, graph::sorted_vector_storage>>("sorted_vector_storage, no index");
+    if (failures > 0) {
+        std::printf("%d queries allocated\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("all queries are allocation-free\n");
+    return EXIT_SUCCESS;
+}